@@ -1,11 +1,21 @@
 ////////////////////////////////////////////////////////////////////
 // File includes:
 #include "ARDrawingContext.hpp"
+#include "SceneGeometry.hpp"
+#include "GlBufferFunctions.hpp"
 
 ////////////////////////////////////////////////////////////////////
 // Standard includes:
 #include <gl/gl.h>
 #include <gl/glu.h>
+#include <algorithm>
+
+namespace
+{
+  // Overlay text layout (pixels)
+  const int kOverlayLineHeight = 15;
+  const int kOverlayMargin     = 10;
+}
 
 void ARDrawingContextDrawCallback(void* param)
 {
@@ -17,10 +27,36 @@ void ARDrawingContextDrawCallback(void* param)
 }
 
 ARDrawingContext::ARDrawingContext(std::string windowName, cv::Size frameSize, const CameraCalibration& c)
-  : m_isTextureInitialized(false)
+  : m_backgroundTextureId(0)
+  , m_usePixelBuffers(false)
+  , m_writeBuffer(0)
+  , m_hasPendingUpload(false)
   , m_calibration(c)
   , m_windowName(windowName)
+  , m_isOverlayChanged(false)
+  , m_overlayTextureId(0)
 {
+  m_pixelBuffers[0] = m_pixelBuffers[1] = 0;
+
+  // Default scene: the coordinate axis and the translucent cube with the outlined faces
+  SceneLayer::Model axis(m_scene.addMesh(Mesh::createCoordinateAxis()));
+  axis.lit       = false;
+  axis.lineWidth = SceneGeometry::axisLineWidth;
+  m_scene.addModel(axis);
+
+  SceneLayer::Model cubeFaces(m_scene.addMesh(Mesh::createCubeFaces()));
+  cubeFaces.anchor  = SceneGeometry::getCubeAnchor();
+  cubeFaces.blended = true;
+  std::copy(SceneGeometry::cubeFillColor, SceneGeometry::cubeFillColor + 4, cubeFaces.color);
+  m_scene.addModel(cubeFaces);
+
+  SceneLayer::Model cubeEdges(m_scene.addMesh(Mesh::createCubeEdges()));
+  cubeEdges.anchor    = SceneGeometry::getCubeAnchor();
+  cubeEdges.blended   = true;
+  cubeEdges.lineWidth = SceneGeometry::axisLineWidth;
+  std::copy(SceneGeometry::cubeEdgeColor, SceneGeometry::cubeEdgeColor + 4, cubeEdges.color);
+  m_scene.addModel(cubeEdges);
+
 	// Create window with OpenGL support
 	cv::namedWindow(windowName, cv::WINDOW_OPENGL);
 
@@ -35,11 +71,75 @@ ARDrawingContext::ARDrawingContext(std::string windowName, cv::Size frameSize, c
 ARDrawingContext::~ARDrawingContext()
 {
 	cv::setOpenGlDrawCallback(m_windowName, 0, 0);
+
+  cv::setOpenGlContext(m_windowName);
+
+  m_scene.releaseBuffers();
+
+  if (m_pixelBuffers[0])
+    glDeleteBuffersPtr(2, m_pixelBuffers);
+
+  if (m_backgroundTextureId)
+    glDeleteTextures(1, &m_backgroundTextureId);
+
+  if (m_overlayTextureId)
+    glDeleteTextures(1, &m_overlayTextureId);
+}
+
+void ARDrawingContext::updateBackground(const FrameView& frame)
+{
+  cv::setOpenGlContext(m_windowName);
+
+  if (frame.size() != m_backgroundSize)
+    initBackground(frame.size());
+
+  if (!m_usePixelBuffers)
+  {
+    const cv::Mat bgr = frame.getBgr(m_backgroundImage);
+    if (bgr.data != m_backgroundImage.data)
+      bgr.copyTo(m_backgroundImage);
+
+    m_hasPendingUpload = true;
+    return;
+  }
+
+  glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffers[m_writeBuffer]);
+
+  // New storage (orphaning) lets the driver map the buffer without waiting for an upload that still reads the old one
+  const size_t bufferSize = m_backgroundSize.area() * 3;
+  glBufferDataPtr(GL_PIXEL_UNPACK_BUFFER, bufferSize, 0, GL_STREAM_DRAW);
+
+  // Orphaning dropped a frame that was not uploaded yet, there is nothing to upload until the new one is written
+  m_hasPendingUpload = false;
+
+  // Frame is converted (or copied) straight to the mapped buffer
+  void* data = glMapBufferPtr(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+  if (data)
+  {
+    cv::Mat mapped(m_backgroundSize, CV_8UC3, data);
+    const cv::Mat bgr = frame.getBgr(mapped);
+    if (bgr.data != mapped.data)
+      bgr.copyTo(mapped);
+
+    // Contents are lost if the buffer was corrupted while mapped, the frame is skipped then
+    m_hasPendingUpload = glUnmapBufferPtr(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+  }
+
+  glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER, 0);
 }
 
-void ARDrawingContext::updateBackground(const cv::Mat& frame)
+void ARDrawingContext::setOverlayText(const std::vector<std::string>& lines)
 {
-  frame.copyTo(m_backgroundImage);
+  if (lines == m_overlayText)
+    return;
+
+  m_overlayText = lines;
+  m_isOverlayChanged = true;
+}
+
+SceneLayer& ARDrawingContext::getScene()
+{
+  return m_scene;
 }
 
 void ARDrawingContext::updateWindow()
@@ -52,14 +152,15 @@ void ARDrawingContext::draw()
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // Clear entire screen:
   drawCameraFrame();                                  // Render background
   drawAugmentedScene();                               // Draw AR
+  drawOverlay();                                      // Draw text
   glFlush();
 }
 
 
-void ARDrawingContext::drawCameraFrame()
+void ARDrawingContext::initBackground(cv::Size size)
 {
   // Initialize texture for background image
-  if (!m_isTextureInitialized)
+  if (!m_backgroundTextureId)
   {
     glGenTextures(1, &m_backgroundTextureId);
     glBindTexture(GL_TEXTURE_2D, m_backgroundTextureId);
@@ -67,22 +168,46 @@ void ARDrawingContext::drawCameraFrame()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    m_isTextureInitialized = true;
+    m_usePixelBuffers = loadGlPixelBufferFunctions();
+    if (m_usePixelBuffers)
+      glGenBuffersPtr(2, m_pixelBuffers);
   }
 
-  int w = m_backgroundImage.cols;
-  int h = m_backgroundImage.rows;
+  // Storage is allocated once, frames only replace its contents
+  glBindTexture(GL_TEXTURE_2D, m_backgroundTextureId);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size.width, size.height, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, 0);
+
+  m_backgroundSize   = size;
+  m_hasPendingUpload = false;
+}
+
+void ARDrawingContext::drawCameraFrame()
+{
+  if (!m_backgroundTextureId)
+    return;
+
+  int w = m_backgroundSize.width;
+  int h = m_backgroundSize.height;
 
-  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   glBindTexture(GL_TEXTURE_2D, m_backgroundTextureId);
 
   // Upload new texture data:
-  if (m_backgroundImage.channels() == 3)
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, m_backgroundImage.data);
-  else if(m_backgroundImage.channels() == 4)
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, m_backgroundImage.data);
-  else if (m_backgroundImage.channels()==1)
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, m_backgroundImage.data);
+  if (m_hasPendingUpload && m_usePixelBuffers)
+  {
+    // Copy from the bound pixel buffer returns immediately, the next frame is written to the other buffer meanwhile
+    glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffers[m_writeBuffer]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_BGR_EXT, GL_UNSIGNED_BYTE, 0);
+    glBindBufferPtr(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_writeBuffer = 1 - m_writeBuffer;
+  }
+  else if (m_hasPendingUpload)
+  {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_BGR_EXT, GL_UNSIGNED_BYTE, m_backgroundImage.data);
+  }
+
+  m_hasPendingUpload = false;
 
   const GLfloat bgTextureVertices[] = { 0, 0, w, 0, 0, h, w, h };
   const GLfloat bgTextureCoords[]   = { 1, 0, 1, 1, 0, 0, 0, 1 };
@@ -114,14 +239,19 @@ void ARDrawingContext::drawCameraFrame()
 
 void ARDrawingContext::drawAugmentedScene()
 {
-  // Init augmentation projection
-  Matrix44 projectionMatrix;
-  int w = m_backgroundImage.cols;
-  int h = m_backgroundImage.rows;
-  buildProjectionMatrix(m_calibration, w, h, projectionMatrix);
+  // No frame yet
+  if (m_backgroundSize.area() == 0)
+    return;
+
+  // Init augmentation projection (calibration doesn't change, so only a new frame size needs a new matrix)
+  if (m_projectionSize != m_backgroundSize)
+  {
+    SceneGeometry::buildProjectionMatrix(m_calibration, m_backgroundSize.width, m_backgroundSize.height, m_projectionMatrix);
+    m_projectionSize = m_backgroundSize;
+  }
 
   glMatrixMode(GL_PROJECTION);
-  glLoadMatrixf(projectionMatrix.data);
+  glLoadMatrixf(m_projectionMatrix.data);
 
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
@@ -132,175 +262,94 @@ void ARDrawingContext::drawAugmentedScene()
     Matrix44 glMatrix = patternPose.getMat44();
     glLoadMatrixf(reinterpret_cast<const GLfloat*>(&glMatrix.data[0]));
 
-    // Render model
-    drawCoordinateAxis();
-    drawCubeModel();
+    // Render models
+    m_scene.draw();
   }
 }
 
-void ARDrawingContext::buildProjectionMatrix(const CameraCalibration& calibration, int screen_width, int screen_height, Matrix44& projectionMatrix)
+void ARDrawingContext::drawOverlay()
 {
-  float nearPlane = 0.01f;  // Near clipping distance
-  float farPlane  = 100.0f;  // Far clipping distance
-
-  // Camera parameters
-  float f_x = calibration.fx(); // Focal length in x axis
-  float f_y = calibration.fy(); // Focal length in y axis (usually the same?)
-  float c_x = calibration.cx(); // Camera primary point x
-  float c_y = calibration.cy(); // Camera primary point y
-
-  projectionMatrix.data[0] = -2.0f * f_x / screen_width;
-  projectionMatrix.data[1] = 0.0f;
-  projectionMatrix.data[2] = 0.0f;
-  projectionMatrix.data[3] = 0.0f;
-
-  projectionMatrix.data[4] = 0.0f;
-  projectionMatrix.data[5] = 2.0f * f_y / screen_height;
-  projectionMatrix.data[6] = 0.0f;
-  projectionMatrix.data[7] = 0.0f;
-
-  projectionMatrix.data[8] = 2.0f * c_x / screen_width - 1.0f;
-  projectionMatrix.data[9] = 2.0f * c_y / screen_height - 1.0f;	
-  projectionMatrix.data[10] = -( farPlane + nearPlane) / ( farPlane - nearPlane );
-  projectionMatrix.data[11] = -1.0f;
-
-  projectionMatrix.data[12] = 0.0f;
-  projectionMatrix.data[13] = 0.0f;
-  projectionMatrix.data[14] = -2.0f * farPlane * nearPlane / ( farPlane - nearPlane );		
-  projectionMatrix.data[15] = 0.0f;
-}
+  if (m_isOverlayChanged)
+  {
+    updateOverlayTexture();
+    m_isOverlayChanged = false;
+  }
 
+  if (!m_overlayTextureId || m_overlayImage.empty() || m_backgroundSize.area() == 0)
+    return;
 
-void ARDrawingContext::drawCoordinateAxis()
-{
-  static float lineX[] = {0,0,0,1,0,0};
-  static float lineY[] = {0,0,0,0,1,0};
-  static float lineZ[] = {0,0,0,0,0,1};
+  const GLfloat w = static_cast<GLfloat>(m_overlayImage.cols);
+  const GLfloat h = static_cast<GLfloat>(m_overlayImage.rows);
+  const GLfloat overlayVertices[] = { 0, 0, w, 0, 0, h, w, h };
+  const GLfloat overlayCoords[]   = { 0, 0, 1, 0, 0, 1, 1, 1 };
 
-  glLineWidth(2);
+  // Window coordinates with the origin in the top left corner
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(0, m_backgroundSize.width, m_backgroundSize.height, 0, -1, 1);
+
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
 
-  glBegin(GL_LINES);
+  glPushAttrib(GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT);
+
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_LIGHTING);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, m_overlayTextureId);
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 
-  glColor3f(1.0f, 0.0f, 0.0f);
-  glVertex3fv(lineX);
-  glVertex3fv(lineX + 3);
+  glVertexPointer(2, GL_FLOAT, 0, overlayVertices);
+  glTexCoordPointer(2, GL_FLOAT, 0, overlayCoords);
 
-  glColor3f(0.0f, 1.0f, 0.0f);
-  glVertex3fv(lineY);
-  glVertex3fv(lineY + 3);
+  glColor4f(1,1,1,1);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-  glColor3f(0.0f, 0.0f, 1.0f);
-  glVertex3fv(lineZ);
-  glVertex3fv(lineZ + 3);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 
-  glEnd();
+  glPopAttrib();
 }
 
-void ARDrawingContext::drawCubeModel()
+void ARDrawingContext::updateOverlayTexture()
 {
-  static const GLfloat LightAmbient[]=  { 0.25f, 0.25f, 0.25f, 1.0f };    // Ambient Light Values
-  static const GLfloat LightDiffuse[]=  { 0.1f, 0.1f, 0.1f, 1.0f };    // Diffuse Light Values
-  static const GLfloat LightPosition[]= { 0.0f, 0.0f, 2.0f, 1.0f };    // Light Position
-  
-  glPushAttrib(GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_POLYGON_BIT);
-
-  glColor4f(0.2f,0.35f,0.3f,0.75f);         // Full Brightness, 50% Alpha ( NEW )
-  glBlendFunc(GL_ONE,GL_ONE_MINUS_SRC_ALPHA);       // Blending Function For Translucency Based On Source Alpha 
-  glEnable(GL_BLEND); 
-
-  glShadeModel(GL_SMOOTH);
-
-  glEnable(GL_LIGHTING);
-  glDisable(GL_LIGHT0);
-  glEnable(GL_LIGHT1);
-  glLightfv(GL_LIGHT1, GL_AMBIENT, LightAmbient);
-  glLightfv(GL_LIGHT1, GL_DIFFUSE, LightDiffuse);
-  glLightfv(GL_LIGHT1, GL_POSITION, LightPosition);
-  glEnable(GL_COLOR_MATERIAL);
-
-  glScalef(0.25,0.25, 0.25);
-  glTranslatef(0,0, 1);
-
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  glBegin(GL_QUADS); 
-  // Front Face
-  glNormal3f( 0.0f, 0.0f, 1.0f);    // Normal Pointing Towards Viewer
-  glVertex3f(-1.0f, -1.0f,  1.0f);  // Point 1 (Front)
-  glVertex3f( 1.0f, -1.0f,  1.0f);  // Point 2 (Front)
-  glVertex3f( 1.0f,  1.0f,  1.0f);  // Point 3 (Front)
-  glVertex3f(-1.0f,  1.0f,  1.0f);  // Point 4 (Front)
-  // Back Face
-  glNormal3f( 0.0f, 0.0f,-1.0f);    // Normal Pointing Away From Viewer
-  glVertex3f(-1.0f, -1.0f, -1.0f);  // Point 1 (Back)
-  glVertex3f(-1.0f,  1.0f, -1.0f);  // Point 2 (Back)
-  glVertex3f( 1.0f,  1.0f, -1.0f);  // Point 3 (Back)
-  glVertex3f( 1.0f, -1.0f, -1.0f);  // Point 4 (Back)
-  // Top Face
-  glNormal3f( 0.0f, 1.0f, 0.0f);    // Normal Pointing Up
-  glVertex3f(-1.0f,  1.0f, -1.0f);  // Point 1 (Top)
-  glVertex3f(-1.0f,  1.0f,  1.0f);  // Point 2 (Top)
-  glVertex3f( 1.0f,  1.0f,  1.0f);  // Point 3 (Top)
-  glVertex3f( 1.0f,  1.0f, -1.0f);  // Point 4 (Top)
-  // Bottom Face
-  glNormal3f( 0.0f,-1.0f, 0.0f);    // Normal Pointing Down
-  glVertex3f(-1.0f, -1.0f, -1.0f);  // Point 1 (Bottom)
-  glVertex3f( 1.0f, -1.0f, -1.0f);  // Point 2 (Bottom)
-  glVertex3f( 1.0f, -1.0f,  1.0f);  // Point 3 (Bottom)
-  glVertex3f(-1.0f, -1.0f,  1.0f);  // Point 4 (Bottom)
-  // Right face
-  glNormal3f( 1.0f, 0.0f, 0.0f);    // Normal Pointing Right
-  glVertex3f( 1.0f, -1.0f, -1.0f);  // Point 1 (Right)
-  glVertex3f( 1.0f,  1.0f, -1.0f);  // Point 2 (Right)
-  glVertex3f( 1.0f,  1.0f,  1.0f);  // Point 3 (Right)
-  glVertex3f( 1.0f, -1.0f,  1.0f);  // Point 4 (Right)
-  // Left Face
-  glNormal3f(-1.0f, 0.0f, 0.0f);    // Normal Pointing Left
-  glVertex3f(-1.0f, -1.0f, -1.0f);  // Point 1 (Left)
-  glVertex3f(-1.0f, -1.0f,  1.0f);  // Point 2 (Left)
-  glVertex3f(-1.0f,  1.0f,  1.0f);  // Point 3 (Left)
-  glVertex3f(-1.0f,  1.0f, -1.0f);  // Point 4 (Left)
-  glEnd();
-  
-  glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-  glColor4f(0.2f,0.65f,0.3f,0.35f); // Full Brightness, 50% Alpha ( NEW )
-  glBegin(GL_QUADS); 
-  // Front Face
-  glNormal3f( 0.0f, 0.0f, 1.0f);    // Normal Pointing Towards Viewer
-  glVertex3f(-1.0f, -1.0f,  1.0f);  // Point 1 (Front)
-  glVertex3f( 1.0f, -1.0f,  1.0f);  // Point 2 (Front)
-  glVertex3f( 1.0f,  1.0f,  1.0f);  // Point 3 (Front)
-  glVertex3f(-1.0f,  1.0f,  1.0f);  // Point 4 (Front)
-  // Back Face
-  glNormal3f( 0.0f, 0.0f,-1.0f);    // Normal Pointing Away From Viewer
-  glVertex3f(-1.0f, -1.0f, -1.0f);  // Point 1 (Back)
-  glVertex3f(-1.0f,  1.0f, -1.0f);  // Point 2 (Back)
-  glVertex3f( 1.0f,  1.0f, -1.0f);  // Point 3 (Back)
-  glVertex3f( 1.0f, -1.0f, -1.0f);  // Point 4 (Back)
-  // Top Face
-  glNormal3f( 0.0f, 1.0f, 0.0f);    // Normal Pointing Up
-  glVertex3f(-1.0f,  1.0f, -1.0f);  // Point 1 (Top)
-  glVertex3f(-1.0f,  1.0f,  1.0f);  // Point 2 (Top)
-  glVertex3f( 1.0f,  1.0f,  1.0f);  // Point 3 (Top)
-  glVertex3f( 1.0f,  1.0f, -1.0f);  // Point 4 (Top)
-  // Bottom Face
-  glNormal3f( 0.0f,-1.0f, 0.0f);    // Normal Pointing Down
-  glVertex3f(-1.0f, -1.0f, -1.0f);  // Point 1 (Bottom)
-  glVertex3f( 1.0f, -1.0f, -1.0f);  // Point 2 (Bottom)
-  glVertex3f( 1.0f, -1.0f,  1.0f);  // Point 3 (Bottom)
-  glVertex3f(-1.0f, -1.0f,  1.0f);  // Point 4 (Bottom)
-  // Right face
-  glNormal3f( 1.0f, 0.0f, 0.0f);    // Normal Pointing Right
-  glVertex3f( 1.0f, -1.0f, -1.0f);  // Point 1 (Right)
-  glVertex3f( 1.0f,  1.0f, -1.0f);  // Point 2 (Right)
-  glVertex3f( 1.0f,  1.0f,  1.0f);  // Point 3 (Right)
-  glVertex3f( 1.0f, -1.0f,  1.0f);  // Point 4 (Right)
-  // Left Face
-  glNormal3f(-1.0f, 0.0f, 0.0f);    // Normal Pointing Left
-  glVertex3f(-1.0f, -1.0f, -1.0f);  // Point 1 (Left)
-  glVertex3f(-1.0f, -1.0f,  1.0f);  // Point 2 (Left)
-  glVertex3f(-1.0f,  1.0f,  1.0f);  // Point 3 (Left)
-  glVertex3f(-1.0f,  1.0f, -1.0f);  // Point 4 (Left)
-  glEnd();
- 
-  glPopAttrib();
+  if (m_overlayText.empty())
+  {
+    m_overlayImage.release();
+    return;
+  }
+
+  // Only the text area is rendered, the rest of the texture is transparent
+  int width = 0;
+  for (size_t i = 0; i < m_overlayText.size(); i++)
+  {
+    int baseline = 0;
+    width = std::max(width, cv::getTextSize(m_overlayText[i], CV_FONT_HERSHEY_PLAIN, 1, 1, &baseline).width);
+  }
+
+  m_overlayImage.create(static_cast<int>(m_overlayText.size() + 1) * kOverlayLineHeight, width + 2 * kOverlayMargin, CV_8UC4);
+  m_overlayImage.setTo(cv::Scalar::all(0));
+
+  for (size_t i = 0; i < m_overlayText.size(); i++)
+  {
+    const cv::Point origin(kOverlayMargin, static_cast<int>(i + 1) * kOverlayLineHeight);
+    cv::putText(m_overlayImage, m_overlayText[i], origin, CV_FONT_HERSHEY_PLAIN, 1, cv::Scalar(0,200,0,255));
+  }
+
+  if (!m_overlayTextureId)
+  {
+    glGenTextures(1, &m_overlayTextureId);
+    glBindTexture(GL_TEXTURE_2D, m_overlayTextureId);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glBindTexture(GL_TEXTURE_2D, m_overlayTextureId);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_overlayImage.cols, m_overlayImage.rows, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, m_overlayImage.data);
 }
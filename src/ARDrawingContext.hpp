@@ -5,10 +5,14 @@
 // File includes:
 #include "GeometryTypes.hpp"
 #include "CameraCalibration.hpp"
+#include "FrameView.hpp"
+#include "SceneLayer.hpp"
 
 ////////////////////////////////////////////////////////////////////
 // Standard includes:
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
 
 void ARDrawingContextDrawCallback(void* param);
 
@@ -23,8 +27,15 @@ public:
   Transformation      patternPose;
 
 
-  //! Set the new frame for the background
-  void updateBackground(const cv::Mat& frame);
+  //! Set the new frame for the background (YUV frames are converted to BGR here, only for display).
+  //! The frame is written to a pixel buffer, the texture is updated from it asynchronously on the next draw
+  void updateBackground(const FrameView& frame);
+
+  //! Set the text drawn over the scene, one line per entry. Overlay texture is rendered only when the text changes
+  void setOverlayText(const std::vector<std::string>& lines);
+
+  //! Models drawn on the pattern, initially the coordinate axis and the cube. Meshes are uploaded on the next draw
+  SceneLayer& getScene();
 
   void updateWindow();
 
@@ -33,27 +44,40 @@ private:
 	//! Render entire scene in the OpenGl window
 	void draw();
 
+  //! Allocates the background texture storage and the pixel buffers for frames of @size
+  void initBackground(cv::Size size);
+
   //! Draws the background with video
   void drawCameraFrame();
 
+  //! Draws the overlay text in the window coordinates
+  void drawOverlay();
+
+  //! Renders the overlay text to the overlay texture
+  void updateOverlayTexture();
+
   //! Draws the AR
   void drawAugmentedScene();
 
-  //! Builds the right projection matrix from the camera calibration for AR
-  void buildProjectionMatrix(const CameraCalibration& calibration, int w, int h, Matrix44& result);
-  
-  //! Draws the coordinate axis 
-  void drawCoordinateAxis();
-  
-  //! Draw the cube model
-  void drawCubeModel();
-
 private:
-  bool               m_isTextureInitialized;
+  cv::Size           m_backgroundSize;       // Size of the allocated texture storage, empty before the first frame
   unsigned int       m_backgroundTextureId;
+  bool               m_usePixelBuffers;      // Pixel buffer objects are supported by the context
+  unsigned int       m_pixelBuffers[2];      // A frame is written to one buffer while the other one is uploaded
+  int                m_writeBuffer;          // Buffer the next frame is written to
+  bool               m_hasPendingUpload;     // Frame in m_pixelBuffers[m_writeBuffer] (or m_backgroundImage) is not uploaded yet
   CameraCalibration  m_calibration;
-  cv::Mat            m_backgroundImage;
+  cv::Mat            m_backgroundImage;      // Copy of the frame when pixel buffers are not supported
   std::string        m_windowName;
+
+  std::vector<std::string> m_overlayText;
+  bool               m_isOverlayChanged;
+  unsigned int       m_overlayTextureId;
+  cv::Mat            m_overlayImage;         // BGRA rendering of the overlay text
+
+  SceneLayer         m_scene;
+  cv::Size           m_projectionSize;       // Frame size m_projectionMatrix is built for
+  Matrix44           m_projectionMatrix;
 };
 
 #endif
\ No newline at end of file
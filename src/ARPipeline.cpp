@@ -2,26 +2,389 @@
 // File includes:
 #include "ARPipeline.hpp"
 
+namespace
+{
+  // Number of frames the pose is extrapolated with the motion model when optical flow fails
+  const int kMaxPredictedFrames = 5;
+
+  // Minimal number of tracked points consistent with the homography
+  const size_t kMinTrackedPoints = 8;
+
+  // Maximal number of pattern points followed from the detection frame to the current one
+  const size_t kMaxMergedPoints = 300;
+}
+
 ARPipeline::ARPipeline(const cv::Mat& patternImage, const CameraCalibration& calibration)
   : m_calibration(calibration)
+  , m_detectionState(DetectionIdle)
+  , m_stopDetection(false)
+  , m_detectionFound(false)
+  , m_hasPose(false)
+  , m_predictedFrames(0)
+  , m_homography(cv::Matx33d::eye())
+  , m_motion(cv::Matx33d::eye())
+{
+  Pattern pattern;
+  m_patternDetector.buildPatternFromImage(patternImage, pattern);
+  m_patternDetector.train(pattern);
+}
+
+ARPipeline::ARPipeline(const Pattern& pattern, const CameraCalibration& calibration)
+  : m_calibration(calibration)
+  , m_detectionState(DetectionIdle)
+  , m_stopDetection(false)
+  , m_detectionFound(false)
+  , m_hasPose(false)
+  , m_predictedFrames(0)
+  , m_homography(cv::Matx33d::eye())
+  , m_motion(cv::Matx33d::eye())
+{
+  m_patternDetector.train(pattern);
+}
+
+ARPipeline::ARPipeline(cv::Ptr<const PatternModel> model, const CameraCalibration& calibration)
+  : m_patternDetector(model)
+  , m_calibration(calibration)
+  , m_detectionState(DetectionIdle)
+  , m_stopDetection(false)
+  , m_detectionFound(false)
+  , m_hasPose(false)
+  , m_predictedFrames(0)
+  , m_homography(cv::Matx33d::eye())
+  , m_motion(cv::Matx33d::eye())
+{
+}
+
+ARPipeline::~ARPipeline()
+{
+  setAsyncDetection(false);
+}
+
+const Pattern& ARPipeline::getPattern() const
+{
+  return m_patternDetector.getModel()->getPattern(0);
+}
+
+bool ARPipeline::processFrame(const FrameView& inputFrame)
 {
-  m_patternDetector.buildPatternFromImage(patternImage, m_pattern);
-  m_patternDetector.train(m_pattern);
+  return processFrame(inputFrame, PoseFilter::now());
 }
 
-bool ARPipeline::processFrame(const cv::Mat& inputFrame)
+bool ARPipeline::processFrame(const FrameView& inputFrame, double timestamp)
 {
-  bool patternFound = m_patternDetector.findPattern(inputFrame, m_patternInfo);
+  const bool patternFound = estimatePose(inputFrame);
+  FRAME_STATS(m_statsHistory.push(m_patternInfo.stats));
 
   if (patternFound)
+    m_poseFilter.update(m_patternInfo.pose3d, timestamp);
+  else
+    m_poseFilter.reset();
+
+  return patternFound;
+}
+
+bool ARPipeline::estimatePose(const FrameView& inputFrame)
+{
+  if (!isAsyncDetection())
   {
-    m_patternInfo.computePose(m_pattern, m_calibration);
+    // Detector fills the statistics of the frame
+    bool patternFound = m_patternDetector.findPattern(inputFrame, m_patternInfo);
+
+    // Pose of the previous frame is the initial guess for the next one
+    ScopedStageTimer poseTimer(&m_patternInfo.stats.timings, StagePose);
+    if (patternFound)
+      m_poseEstimator.estimate(getPattern(), m_calibration, m_patternInfo);
+    else
+      m_patternInfo.hasPose = false;
+
+    return patternFound;
   }
 
-  return patternFound;
+  FrameStats& stats = m_patternInfo.stats;
+  stats.reset();
+
+  // The gray image is kept for the next frame, so a view of the caller's frame is copied
+  ScopedStageTimer grayTimer(&stats.timings, StageGray);
+  const cv::Mat gray = inputFrame.getGray(m_gray);
+  if (gray.data != m_gray.data)
+    gray.copyTo(m_gray);
+  grayTimer.stop();
+
+  // Take the finished detection and start the detection on the current frame
+  bool hasDetection = false;
+  {
+    std::lock_guard<std::mutex> lock(m_detectionMutex);
+
+    if (m_detectionState == DetectionDone)
+    {
+      hasDetection = m_detectionFound;
+      if (hasDetection)
+      {
+        // The detection frame is no longer used by the detection thread
+        cv::swap(m_detectionGray, m_resultGray);
+        m_detectionInfo.homography.copyTo(m_resultHomography);
+      }
+
+      m_detectionState = DetectionIdle;
+    }
+
+    if (m_detectionState == DetectionIdle)
+    {
+      m_gray.copyTo(m_detectionGray);
+      m_detectionState = DetectionRequested;
+      m_detectionCondition.notify_all();
+    }
+  }
+
+  // Cheap per-frame update, then the detection result (more reliable) if it's available
+  ScopedStageTimer trackingTimer(&stats.timings, StageTracking);
+  bool patternFound = propagatePose();
+  FRAME_STATS(stats.tracked = patternFound);
+
+  if (hasDetection && mergeDetection(m_resultGray, m_resultHomography))
+    patternFound = true;
+  trackingTimer.stop();
+
+  cv::swap(m_prevGray, m_gray);
+
+  if (!patternFound)
+  {
+    m_hasPose = false;
+    m_patternInfo.hasPose = false;
+    return false;
+  }
+
+  cv::Mat(m_homography, false).copyTo(m_patternInfo.homography);
+  cv::perspectiveTransform(getPattern().points2d, m_patternInfo.points2d, m_patternInfo.homography);
+
+  // Pose is refined on the tracked points (none when the pose is extrapolated with the motion model)
+  FRAME_STATS(stats.inliersCount = static_cast<int>(m_trackedPoints.size()));
+
+  ScopedStageTimer poseTimer(&stats.timings, StagePose);
+  m_patternInfo.patternInliers = m_trackedPatternPoints;
+  m_patternInfo.frameInliers   = m_trackedPoints;
+  m_poseEstimator.estimate(getPattern(), m_calibration, m_patternInfo);
+
+  return true;
 }
 
 const Transformation& ARPipeline::getPatternLocation() const
 {
   return m_patternInfo.pose3d;
-}
\ No newline at end of file
+}
+
+const PoseFilter& ARPipeline::getPoseFilter() const
+{
+  return m_poseFilter;
+}
+
+const FrameStats& ARPipeline::getFrameStats() const
+{
+  return m_patternInfo.stats;
+}
+
+const FrameStatsHistory& ARPipeline::getStatsHistory() const
+{
+  return m_statsHistory;
+}
+
+void ARPipeline::setAsyncDetection(bool enabled)
+{
+  if (enabled == isAsyncDetection())
+    return;
+
+  if (enabled)
+  {
+    m_stopDetection   = false;
+    m_detectionState  = DetectionIdle;
+    m_hasPose         = false;
+    m_predictedFrames = 0;
+    m_trackedPatternPoints.clear();
+    m_trackedPoints.clear();
+    m_prevGray.release();
+
+    m_detectionThread = std::thread(&ARPipeline::detectionLoop, this);
+  }
+  else
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_detectionMutex);
+      m_stopDetection = true;
+    }
+
+    m_detectionCondition.notify_all();
+    m_detectionThread.join();
+
+    m_detectionState = DetectionIdle;
+  }
+}
+
+bool ARPipeline::isAsyncDetection() const
+{
+  return m_detectionThread.joinable();
+}
+
+void ARPipeline::waitForDetection()
+{
+  std::unique_lock<std::mutex> lock(m_detectionMutex);
+
+  while (m_detectionState == DetectionRequested && !m_stopDetection)
+    m_detectionCondition.wait(lock);
+}
+
+void ARPipeline::detectionLoop()
+{
+  std::unique_lock<std::mutex> lock(m_detectionMutex);
+
+  for (;;)
+  {
+    while (!m_stopDetection && m_detectionState != DetectionRequested)
+      m_detectionCondition.wait(lock);
+
+    if (m_stopDetection)
+      break;
+
+    // The requested frame and the detector belong to this thread until the state changes
+    lock.unlock();
+
+    // Requested frames may be many frames apart and the pattern is followed between them by the per-frame
+    // propagation, so the detector doesn't track from its previous run and every run is a full detection
+    m_patternDetector.resetTracking();
+    const bool found = m_patternDetector.findPattern(m_detectionGray, m_detectionInfo);
+    lock.lock();
+
+    m_detectionFound = found;
+    m_detectionState = DetectionDone;
+    m_detectionCondition.notify_all();
+  }
+}
+
+bool ARPipeline::updateTrackedHomography(std::vector<cv::Point2f>& patternPoints, std::vector<cv::Point2f>& framePoints)
+{
+  if (patternPoints.size() < kMinTrackedPoints)
+    return false;
+
+  const bool homographyFound = m_estimator.estimate(patternPoints, framePoints, m_patternDetector.homographyReprojectionThreshold, m_trackedHomography);
+  FRAME_STATS(m_patternInfo.stats.ransacIterations += m_estimator.getIterationsCount());
+
+  if (!homographyFound)
+    return false;
+
+  const std::vector<unsigned char>& inliersMask = m_estimator.getInliersMask();
+
+  size_t inliersCount = 0;
+  for (size_t i = 0; i < inliersMask.size(); i++)
+    inliersCount += inliersMask[i];
+
+  if (inliersCount < kMinTrackedPoints)
+    return false;
+
+  m_trackedPatternPoints.clear();
+  m_trackedPoints.clear();
+
+  for (size_t i = 0; i < inliersMask.size(); i++)
+  {
+    if (inliersMask[i])
+    {
+      m_trackedPatternPoints.push_back(patternPoints[i]);
+      m_trackedPoints.push_back(framePoints[i]);
+    }
+  }
+
+  m_homography = cv::Matx33d(m_trackedHomography.ptr<double>());
+  m_hasPose = true;
+  return true;
+}
+
+bool ARPipeline::propagatePose()
+{
+  if (!m_hasPose)
+    return false;
+
+  if (!m_trackedPoints.empty() && m_prevGray.size() == m_gray.size())
+  {
+    // Follow the points from the previous frame
+    cv::calcOpticalFlowPyrLK(m_prevGray, m_gray, m_trackedPoints, m_nextPoints, m_status, m_error);
+
+    m_candidatePatternPoints.clear();
+    m_candidatePoints.clear();
+
+    for (size_t i = 0; i < m_status.size(); i++)
+    {
+      if (m_status[i])
+      {
+        m_candidatePatternPoints.push_back(m_trackedPatternPoints[i]);
+        m_candidatePoints.push_back(m_nextPoints[i]);
+      }
+    }
+
+    const cv::Matx33d previous = m_homography;
+    if (updateTrackedHomography(m_candidatePatternPoints, m_candidatePoints))
+    {
+      m_motion = m_homography * previous.inv();
+      m_predictedFrames = 0;
+      return true;
+    }
+  }
+
+  // Optical flow failed, extrapolate the pose with the last frame-to-frame motion for a few frames
+  m_trackedPatternPoints.clear();
+  m_trackedPoints.clear();
+
+  if (m_predictedFrames >= kMaxPredictedFrames)
+  {
+    m_hasPose = false;
+    return false;
+  }
+
+  m_homography = m_motion * m_homography;
+  m_predictedFrames++;
+  return true;
+}
+
+bool ARPipeline::mergeDetection(const cv::Mat& detectionGray, const cv::Mat& detectionHomography)
+{
+  if (detectionGray.size() != m_gray.size())
+    return false;
+
+  // Pattern points as located by the detection on its frame
+  const std::vector<cv::KeyPoint>& keypoints = getPattern().keypoints;
+  const size_t step = std::max<size_t>(1, keypoints.size() / kMaxMergedPoints);
+
+  m_candidatePatternPoints.clear();
+  for (size_t i = 0; i < keypoints.size(); i += step)
+    m_candidatePatternPoints.push_back(keypoints[i].pt);
+
+  if (m_candidatePatternPoints.empty())
+    return false;
+
+  cv::perspectiveTransform(m_candidatePatternPoints, m_candidatePoints, detectionHomography);
+
+  // Follow them from the detection frame to the current one
+  cv::calcOpticalFlowPyrLK(detectionGray, m_gray, m_candidatePoints, m_nextPoints, m_status, m_error);
+
+  size_t trackedCount = 0;
+  for (size_t i = 0; i < m_status.size(); i++)
+  {
+    if (m_status[i])
+    {
+      m_candidatePatternPoints[trackedCount] = m_candidatePatternPoints[i];
+      m_candidatePoints[trackedCount]        = m_nextPoints[i];
+      trackedCount++;
+    }
+  }
+
+  m_candidatePatternPoints.resize(trackedCount);
+  m_candidatePoints.resize(trackedCount);
+
+  const bool hadPose = m_hasPose;
+  if (!updateTrackedHomography(m_candidatePatternPoints, m_candidatePoints))
+    return false;
+
+  // Motion model is kept while the pattern is followed, otherwise it starts from the rest
+  if (!hadPose)
+    m_motion = cv::Matx33d::eye();
+
+  m_predictedFrames = 0;
+  return true;
+}
@@ -6,24 +6,159 @@
 #include "PatternDetector.hpp"
 #include "CameraCalibration.hpp"
 #include "GeometryTypes.hpp"
+#include "HomographyEstimator.hpp"
+#include "PlanarPoseEstimator.hpp"
+#include "PoseFilter.hpp"
+#include "FrameStats.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 class ARPipeline
 {
 public:
   ARPipeline(const cv::Mat& patternImage, const CameraCalibration& calibration);
 
-  bool processFrame(const cv::Mat& inputFrame);
+  /**
+   * Initialize the pipeline with already built pattern (e.g. loaded with PatternFile),
+   * so no feature extraction is needed.
+   */
+  ARPipeline(const Pattern& pattern, const CameraCalibration& calibration);
+
+  /**
+   * Initialize the pipeline with the first pattern of the trained @model, which may be shared with other pipelines
+   * (e.g. one per camera stream) so the pattern data and the trained matcher exist only once.
+   */
+  ARPipeline(cv::Ptr<const PatternModel> model, const CameraCalibration& calibration);
+
+  ~ARPipeline();
+
+  /**
+   * Find the pattern on the frame and compute its pose. Only the gray image of the frame is used,
+   * so the luma of YUV frames is read in place (see FrameView).
+   */
+  bool processFrame(const FrameView& inputFrame);
 
+  /**
+   * Same as above for the frame captured at @timestamp (seconds, see PoseFilter::now), which is used to
+   * update the pose filter.
+   */
+  bool processFrame(const FrameView& inputFrame, double timestamp);
+
+  /**
+   * Raw pose of the pattern on the last processed frame.
+   */
   const Transformation& getPatternLocation() const;
 
+  /**
+   * Pose filter updated with the pattern poses of the processed frames (empty while the pattern is not found).
+   * Use PoseFilter::predict to get the smoothed pose at the render time.
+   */
+  const PoseFilter& getPoseFilter() const;
+
+  /**
+   * Statistics of the last processed frame, including the pose estimation. In asynchronous mode only the per-frame
+   * work is included, the background detection runs concurrently.
+   */
+  const FrameStats& getFrameStats() const;
+
+  /**
+   * Statistics of the recent processed frames.
+   */
+  const FrameStatsHistory& getStatsHistory() const;
+
+  /**
+   * In asynchronous mode full detection runs on a background thread at the rate it can sustain, while each
+   * processed frame only propagates the last homography with sparse optical flow (or with the last frame-to-frame
+   * motion for a few frames if the flow fails). A detection result is merged at the frame it was computed on:
+   * pattern points located on that frame are followed to the current frame with optical flow.
+   * Background runs are always full detections: the tracking state of m_patternDetector is reset before each of them,
+   * so its enableTracking setting only applies to the synchronous mode.
+   */
+  void setAsyncDetection(bool enabled);
+  bool isAsyncDetection() const;
+
+  /**
+   * Block until the background detection (if any) is finished.
+   * Settings of m_patternDetector may only be changed when no detection is running.
+   */
+  void waitForDetection();
+
   PatternDetector     m_patternDetector;
 private:
+  enum DetectionState
+  {
+    DetectionIdle,
+    DetectionRequested,
+    DetectionDone
+  };
+
+  void detectionLoop();
+
+  /**
+   * The tracked pattern (the first one of the model).
+   */
+  const Pattern& getPattern() const;
+
+  /**
+   * Find the pattern and compute its pose on the frame.
+   */
+  bool estimatePose(const FrameView& inputFrame);
+
+  /**
+   * Follow the tracked points from the previous frame, falls back to the motion model.
+   */
+  bool propagatePose();
+
+  /**
+   * Bring the detection result computed on an older frame to the current one.
+   */
+  bool mergeDetection(const cv::Mat& detectionGray, const cv::Mat& detectionHomography);
+
+  /**
+   * Estimate the homography from the point correspondences and keep only inliers in m_trackedPatternPoints/m_trackedPoints.
+   */
+  bool updateTrackedHomography(std::vector<cv::Point2f>& patternPoints, std::vector<cv::Point2f>& framePoints);
 
 private:
   CameraCalibration   m_calibration;
-  Pattern             m_pattern;
   PatternTrackingInfo m_patternInfo;
+  PlanarPoseEstimator m_poseEstimator;
+  PoseFilter          m_poseFilter;
+  FrameStatsHistory   m_statsHistory;
   //PatternDetector     m_patternDetector;
+
+  // Background detection
+  std::thread             m_detectionThread;
+  std::mutex              m_detectionMutex;
+  std::condition_variable m_detectionCondition;
+  DetectionState          m_detectionState;
+  bool                    m_stopDetection;
+  cv::Mat                 m_detectionGray;
+  bool                    m_detectionFound;
+  PatternTrackingInfo     m_detectionInfo;
+  cv::Mat                 m_resultGray;
+  cv::Mat                 m_resultHomography;
+
+  // Per-frame pose propagation
+  bool                     m_hasPose;
+  int                      m_predictedFrames;
+  cv::Mat                  m_gray;
+  cv::Mat                  m_prevGray;
+  cv::Matx33d              m_homography;
+  cv::Matx33d              m_motion;
+  HomographyEstimator      m_estimator;
+  cv::Mat                  m_trackedHomography;   // Estimator output, keeps its buffer between frames
+  std::vector<cv::Point2f> m_trackedPatternPoints;
+  std::vector<cv::Point2f> m_trackedPoints;
+  std::vector<cv::Point2f> m_candidatePatternPoints;
+  std::vector<cv::Point2f> m_candidatePoints;
+  std::vector<cv::Point2f> m_nextPoints;
+  std::vector<unsigned char> m_status;
+  std::vector<float>       m_error;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "AllocationCounter.hpp"
+
+#ifdef EXAMPLE_MARKERLESS_AR_COUNT_ALLOCATIONS
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Per-thread counter is not shared, so counting doesn't add contention between detector threads
+    thread_local size_t     threadAllocations = 0;
+    std::atomic<size_t>     totalAllocations(0);
+
+    inline void* allocate(std::size_t size)
+    {
+        threadAllocations++;
+        totalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        return std::malloc(size ? size : 1);
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    void* p = allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* p = allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+bool AllocationCounter::isEnabled()
+{
+    return true;
+}
+
+size_t AllocationCounter::getThreadCount()
+{
+    return threadAllocations;
+}
+
+size_t AllocationCounter::getTotalCount()
+{
+    return totalAllocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationCounter::isEnabled()
+{
+    return false;
+}
+
+size_t AllocationCounter::getThreadCount()
+{
+    return 0;
+}
+
+size_t AllocationCounter::getTotalCount()
+{
+    return 0;
+}
+
+#endif
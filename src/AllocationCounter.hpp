@@ -0,0 +1,31 @@
+#ifndef EXAMPLE_MARKERLESS_AR_ALLOCATIONCOUNTER_HPP
+#define EXAMPLE_MARKERLESS_AR_ALLOCATIONCOUNTER_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cstddef>
+
+/**
+ * Counts heap allocations made with the global operator new (standard containers, cv::Ptr, strings...).
+ * Counting is compiled in only with the ENABLE_ALLOCATION_COUNTER CMake option, which replaces the global
+ * operator new; otherwise all counters are zero. Buffers of cv::Mat are allocated by cv::fastMalloc and
+ * are not counted.
+ */
+class AllocationCounter
+{
+public:
+    static bool isEnabled();
+
+    /**
+    * Number of allocations made by the calling thread since it was started.
+    * Difference of two values is the number of allocations made in between.
+    */
+    static size_t getThreadCount();
+
+    /**
+    * Number of allocations made by all threads.
+    */
+    static size_t getTotalCount();
+};
+
+#endif
@@ -0,0 +1,448 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "BinaryVocabulary.hpp"
+#include "HammingDistance.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    inline int hammingDistance(const uchar* a, const uchar* b, int length)
+    {
+        return hamming::distance(a, b, length);
+    }
+
+    bool isBetterIndexMatch(const IndexMatch& a, const IndexMatch& b)
+    {
+        return a.score > b.score;
+    }
+}
+
+BinaryVocabulary::BinaryVocabulary(int branchingFactor, int depthLevels)
+    : m_branchingFactor(branchingFactor)
+    , m_depthLevels(depthLevels)
+{
+    CV_Assert(branchingFactor > 1 && depthLevels > 0);
+}
+
+bool BinaryVocabulary::empty() const
+{
+    return m_wordWeights.empty();
+}
+
+int BinaryVocabulary::size() const
+{
+    return static_cast<int>(m_wordWeights.size());
+}
+
+void BinaryVocabulary::create(const std::vector<cv::Mat>& trainDescriptors)
+{
+    m_nodes.clear();
+    m_wordWeights.clear();
+
+    // Put descriptors of all images together
+    cv::Mat descriptors;
+    for (size_t i = 0; i < trainDescriptors.size(); i++)
+    {
+        if (!trainDescriptors[i].empty())
+            descriptors.push_back(trainDescriptors[i]);
+    }
+
+    if (descriptors.empty())
+        return;
+
+    CV_Assert(descriptors.depth() == CV_8U);
+
+    // Root node has no meaningful center, it's stored only to keep node and row indices in sync
+    Node root = { -1, 0, -1 };
+    m_nodes.push_back(root);
+    m_nodeDescriptors = cv::Mat::zeros(1, descriptors.cols, CV_8U);
+
+    std::vector<int> indices(descriptors.rows);
+    for (int i = 0; i < descriptors.rows; i++)
+        indices[i] = i;
+
+    buildNode(0, descriptors, indices, 1);
+
+    // Compute inverse document frequency of each word
+    const int wordsCount = size();
+    std::vector<int> documentsWithWord(wordsCount, 0);
+    std::vector<int> lastDocument(wordsCount, -1);
+    int documentsCount = 0;
+
+    for (size_t i = 0; i < trainDescriptors.size(); i++)
+    {
+        const cv::Mat& imageDescriptors = trainDescriptors[i];
+        if (imageDescriptors.empty())
+            continue;
+
+        documentsCount++;
+        for (int r = 0; r < imageDescriptors.rows; r++)
+        {
+            int word = findWord(imageDescriptors.ptr(r));
+            if (lastDocument[word] != static_cast<int>(i))
+            {
+                lastDocument[word] = static_cast<int>(i);
+                documentsWithWord[word]++;
+            }
+        }
+    }
+
+    for (int w = 0; w < wordsCount; w++)
+    {
+        if (documentsWithWord[w] > 0)
+            m_wordWeights[w] = std::log(static_cast<float>(documentsCount) / documentsWithWord[w]);
+    }
+}
+
+void BinaryVocabulary::buildNode(int nodeIdx, const cv::Mat& descriptors, std::vector<int>& indices, int level)
+{
+    std::vector<cv::Mat> centers;
+    std::vector< std::vector<int> > groups;
+    clusterDescriptors(descriptors, indices, centers, groups);
+
+    // Children of the node are stored contiguously
+    const int firstChild = static_cast<int>(m_nodes.size());
+    m_nodes[nodeIdx].firstChild    = firstChild;
+    m_nodes[nodeIdx].childrenCount = static_cast<int>(centers.size());
+
+    for (size_t c = 0; c < centers.size(); c++)
+    {
+        Node child = { -1, 0, -1 };
+        m_nodes.push_back(child);
+        m_nodeDescriptors.push_back(centers[c]);
+    }
+
+    // Indices are not needed anymore, release the memory before going deeper
+    std::vector<int>().swap(indices);
+
+    for (size_t c = 0; c < groups.size(); c++)
+    {
+        const int childIdx = firstChild + static_cast<int>(c);
+
+        if (level < m_depthLevels && groups[c].size() > 1)
+        {
+            buildNode(childIdx, descriptors, groups[c], level + 1);
+        }
+        else
+        {
+            // Leaf becomes a word
+            m_nodes[childIdx].wordId = static_cast<int>(m_wordWeights.size());
+            m_wordWeights.push_back(0);
+        }
+    }
+}
+
+void BinaryVocabulary::clusterDescriptors(const cv::Mat& descriptors, const std::vector<int>& indices,
+                                          std::vector<cv::Mat>& centers, std::vector< std::vector<int> >& groups) const
+{
+    const int maxIterations = 10;
+    const int count  = static_cast<int>(indices.size());
+    const int length = descriptors.cols;
+    const int bits   = length * 8;
+
+    centers.clear();
+    groups.clear();
+
+    // Not enough descriptors to cluster - each one becomes a cluster
+    if (count <= m_branchingFactor)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            centers.push_back(descriptors.row(indices[i]).clone());
+            groups.push_back(std::vector<int>(1, indices[i]));
+        }
+        return;
+    }
+
+    // Seed the centers with k-means++ (fixed seed keeps the vocabulary reproducible)
+    cv::RNG rng(0x12345);
+    std::vector<double> minDistances(count, std::numeric_limits<double>::max());
+
+    centers.push_back(descriptors.row(indices[rng.uniform(0, count)]).clone());
+    while (static_cast<int>(centers.size()) < m_branchingFactor)
+    {
+        const uchar* lastCenter = centers.back().ptr();
+        double total = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            double d = hammingDistance(descriptors.ptr(indices[i]), lastCenter, length);
+            minDistances[i] = std::min(minDistances[i], d * d);
+            total += minDistances[i];
+        }
+
+        // All remaining descriptors are duplicates of the centers
+        if (total <= 0)
+            break;
+
+        double threshold = rng.uniform(0.0, total);
+        int selected = count - 1;
+        for (int i = 0; i < count; i++)
+        {
+            threshold -= minDistances[i];
+            if (threshold <= 0)
+            {
+                selected = i;
+                break;
+            }
+        }
+
+        centers.push_back(descriptors.row(indices[selected]).clone());
+    }
+
+    const int k = static_cast<int>(centers.size());
+
+    // Refine centers with k-majority iterations: assign to nearest center, then take per-bit majority
+    std::vector<int> assignment(count, -1);
+    std::vector<int> bitCounts(k * bits);
+    std::vector<int> members(k);
+
+    for (int iteration = 0; iteration < maxIterations; iteration++)
+    {
+        bool changed = false;
+
+        for (int i = 0; i < count; i++)
+        {
+            const uchar* d = descriptors.ptr(indices[i]);
+            int bestCenter = 0;
+            int bestDistance = INT_MAX;
+
+            for (int c = 0; c < k; c++)
+            {
+                int distance = hammingDistance(d, centers[c].ptr(), length);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestCenter = c;
+                }
+            }
+
+            if (assignment[i] != bestCenter)
+            {
+                assignment[i] = bestCenter;
+                changed = true;
+            }
+        }
+
+        if (!changed)
+            break;
+
+        std::fill(bitCounts.begin(), bitCounts.end(), 0);
+        std::fill(members.begin(), members.end(), 0);
+
+        for (int i = 0; i < count; i++)
+        {
+            const uchar* d = descriptors.ptr(indices[i]);
+            int* centerBits = &bitCounts[assignment[i] * bits];
+            members[assignment[i]]++;
+
+            for (int b = 0; b < bits; b++)
+            {
+                if (d[b >> 3] & (1 << (b & 7)))
+                    centerBits[b]++;
+            }
+        }
+
+        for (int c = 0; c < k; c++)
+        {
+            // Empty cluster keeps its old center
+            if (members[c] == 0)
+                continue;
+
+            uchar* center = centers[c].ptr();
+            const int* centerBits = &bitCounts[c * bits];
+
+            for (int b = 0; b < length; b++)
+                center[b] = 0;
+
+            for (int b = 0; b < bits; b++)
+            {
+                if (2 * centerBits[b] > members[c])
+                    center[b >> 3] |= static_cast<uchar>(1 << (b & 7));
+            }
+        }
+    }
+
+    // Collect groups and drop empty clusters
+    std::vector< std::vector<int> > allGroups(k);
+    for (int i = 0; i < count; i++)
+    {
+        allGroups[assignment[i]].push_back(indices[i]);
+    }
+
+    std::vector<cv::Mat> allCenters;
+    allCenters.swap(centers);
+
+    for (int c = 0; c < k; c++)
+    {
+        if (allGroups[c].empty())
+            continue;
+
+        centers.push_back(allCenters[c]);
+        groups.push_back(std::vector<int>());
+        groups.back().swap(allGroups[c]);
+    }
+}
+
+int BinaryVocabulary::findWord(const uchar* descriptor) const
+{
+    const int length = m_nodeDescriptors.cols;
+    int nodeIdx = 0;
+
+    // Descend the tree choosing the nearest child on each level
+    while (m_nodes[nodeIdx].childrenCount > 0)
+    {
+        const Node& node = m_nodes[nodeIdx];
+        int bestChild = node.firstChild;
+        int bestDistance = INT_MAX;
+
+        for (int c = node.firstChild; c < node.firstChild + node.childrenCount; c++)
+        {
+            int distance = hammingDistance(descriptor, m_nodeDescriptors.ptr(c), length);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestChild = c;
+            }
+        }
+
+        nodeIdx = bestChild;
+    }
+
+    return m_nodes[nodeIdx].wordId;
+}
+
+void BinaryVocabulary::transform(const cv::Mat& descriptors, BowVector& bow) const
+{
+    std::vector<int> words;
+    transform(descriptors, bow, words);
+}
+
+void BinaryVocabulary::transform(const cv::Mat& descriptors, BowVector& bow, std::vector<int>& words) const
+{
+    bow.clear();
+
+    if (empty() || descriptors.empty())
+        return;
+
+    CV_Assert(descriptors.cols == m_nodeDescriptors.cols);
+
+    words.resize(descriptors.rows);
+    for (int r = 0; r < descriptors.rows; r++)
+    {
+        words[r] = findWord(descriptors.ptr(r));
+    }
+
+    std::sort(words.begin(), words.end());
+
+    // Term frequency multiplied by inverse document frequency
+    float total = 0;
+    for (size_t i = 0; i < words.size(); )
+    {
+        size_t j = i;
+        while (j < words.size() && words[j] == words[i])
+            j++;
+
+        float weight = (j - i) * m_wordWeights[words[i]];
+        if (weight > 0)
+        {
+            bow.push_back(std::make_pair(words[i], weight));
+            total += weight;
+        }
+
+        i = j;
+    }
+
+    // L1 normalization
+    if (total > 0)
+    {
+        for (size_t i = 0; i < bow.size(); i++)
+            bow[i].second /= total;
+    }
+}
+
+InvertedIndex::InvertedIndex()
+    : m_documentsCount(0)
+{
+}
+
+void InvertedIndex::clear(int wordsCount)
+{
+    m_postings.clear();
+    m_postings.resize(wordsCount);
+    m_documentsCount = 0;
+}
+
+int InvertedIndex::size() const
+{
+    return m_documentsCount;
+}
+
+int InvertedIndex::add(const BowVector& bow)
+{
+    const int documentId = m_documentsCount++;
+
+    for (size_t i = 0; i < bow.size(); i++)
+    {
+        Posting posting;
+        posting.documentId = documentId;
+        posting.weight     = bow[i].second;
+        m_postings[bow[i].first].push_back(posting);
+    }
+
+    return documentId;
+}
+
+void InvertedIndex::query(const BowVector& bow, int maxResults, IndexQueryBuffers& buffers, std::vector<IndexMatch>& results) const
+{
+    results.clear();
+
+    if (m_documentsCount == 0 || bow.empty() || maxResults <= 0)
+        return;
+
+    // Scores are zero between queries, so they are allocated once per index size
+    if (buffers.scores.size() < static_cast<size_t>(m_documentsCount))
+        buffers.scores.resize(m_documentsCount, 0);
+
+    std::vector<float>& scores = buffers.scores;
+    std::vector<int>& touched = buffers.touchedDocuments;
+    touched.clear();
+
+    // L1 score of two L1-normalized positive vectors is the sum of per-word minimums,
+    // so only the documents sharing words with the query are touched
+    for (size_t i = 0; i < bow.size(); i++)
+    {
+        const std::vector<Posting>& postings = m_postings[bow[i].first];
+        const float queryWeight = bow[i].second;
+
+        for (size_t j = 0; j < postings.size(); j++)
+        {
+            float& score = scores[postings[j].documentId];
+
+            // All weights are positive, so the zero score marks the first touch
+            if (score == 0)
+                touched.push_back(postings[j].documentId);
+
+            score += std::min(queryWeight, postings[j].weight);
+        }
+    }
+
+    // Collect the touched documents and reset their scores for the next query
+    results.resize(touched.size());
+    for (size_t i = 0; i < touched.size(); i++)
+    {
+        results[i].documentId = touched[i];
+        results[i].score      = scores[touched[i]];
+        scores[touched[i]]    = 0;
+    }
+
+    const size_t resultsCount = std::min(results.size(), static_cast<size_t>(maxResults));
+    std::partial_sort(results.begin(), results.begin() + resultsCount, results.end(), isBetterIndexMatch);
+    results.resize(resultsCount);
+}
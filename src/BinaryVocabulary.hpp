@@ -0,0 +1,140 @@
+#ifndef EXAMPLE_MARKERLESS_AR_BINARYVOCABULARY_HPP
+#define EXAMPLE_MARKERLESS_AR_BINARYVOCABULARY_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <utility>
+
+/**
+ * Sparse bag-of-words vector: pairs of (word id, weight) sorted by word id.
+ */
+typedef std::vector< std::pair<int, float> > BowVector;
+
+/**
+ * Hierarchical vocabulary of binary words built over binary descriptors (ORB, FREAK, BRIEF).
+ * The tree is created with k-majority clustering: every node splits its descriptors into
+ * @branchingFactor clusters and the leaves on the last level become the visual words.
+ * Each word is weighted with the inverse document frequency of the train images.
+ */
+class BinaryVocabulary
+{
+public:
+    BinaryVocabulary(int branchingFactor = 10, int depthLevels = 4);
+
+    /**
+    * Build the vocabulary tree. Each matrix in @trainDescriptors holds the descriptors of one train image (pattern),
+    * they are used to compute the inverse document frequency of words.
+    */
+    void create(const std::vector<cv::Mat>& trainDescriptors);
+
+    /**
+    * Returns true if the vocabulary was not created yet.
+    */
+    bool empty() const;
+
+    /**
+    * Number of words (leaves of the tree).
+    */
+    int size() const;
+
+    /**
+    * Find the word of a single descriptor by descending the tree.
+    */
+    int findWord(const uchar* descriptor) const;
+
+    /**
+    * Convert the set of descriptors to L1-normalized tf-idf bag-of-words vector.
+    */
+    void transform(const cv::Mat& descriptors, BowVector& bow) const;
+
+    /**
+    * Same as above with the word of each descriptor stored in the caller's @words buffer, so the per-frame
+    * conversion allocates nothing once the buffers have grown.
+    */
+    void transform(const cv::Mat& descriptors, BowVector& bow, std::vector<int>& words) const;
+
+private:
+    struct Node
+    {
+        int   firstChild;   // Index of the first child node (children are stored contiguously)
+        int   childrenCount;
+        int   wordId;       // Word index for leaves; -1 for inner nodes
+    };
+
+    void buildNode(int nodeIdx, const cv::Mat& descriptors, std::vector<int>& indices, int level);
+
+    void clusterDescriptors(const cv::Mat& descriptors, const std::vector<int>& indices,
+                            std::vector<cv::Mat>& centers, std::vector< std::vector<int> >& groups) const;
+
+    int                m_branchingFactor;
+    int                m_depthLevels;
+    std::vector<Node>  m_nodes;
+    cv::Mat            m_nodeDescriptors;   // Cluster center of each node (row per node)
+    std::vector<float> m_wordWeights;       // Inverse document frequency of each word
+};
+
+/**
+ * Candidate returned by the inverted index query.
+ */
+struct IndexMatch
+{
+    int   documentId;
+    float score;
+};
+
+/**
+ * Buffers of the inverted index query. The index is shared read-only, so each caller keeps its own buffers,
+ * which are reused by all queries.
+ */
+struct IndexQueryBuffers
+{
+    std::vector<float> scores;             // Score of each document, all zeros between queries
+    std::vector<int>   touchedDocuments;   // Documents with a non-zero score in the current query
+};
+
+/**
+ * Inverted file over bag-of-words vectors. For each word it stores the documents (patterns) containing it,
+ * so the query only touches documents that share at least one word with the query vector.
+ */
+class InvertedIndex
+{
+public:
+    InvertedIndex();
+
+    /**
+    * Remove all documents and prepare the index for the vocabulary with @wordsCount words.
+    */
+    void clear(int wordsCount);
+
+    /**
+    * Add a document to the index. Documents ids are assigned sequentially starting from zero.
+    */
+    int add(const BowVector& bow);
+
+    /**
+    * Number of indexed documents.
+    */
+    int size() const;
+
+    /**
+    * Score all documents against the @bow vector using L1 score and return at most @maxResults best of them
+    * sorted by decreasing score. Documents without common words are never returned.
+    * Only the postings of the query words are visited and only the documents they touch are reset, so the cost is
+    * proportional to the total length of the posting lists of the query words (common words grow with the catalog).
+    */
+    void query(const BowVector& bow, int maxResults, IndexQueryBuffers& buffers, std::vector<IndexMatch>& results) const;
+
+private:
+    struct Posting
+    {
+        int   documentId;
+        float weight;
+    };
+
+    std::vector< std::vector<Posting> > m_postings;
+    int                                 m_documentsCount;
+};
+
+#endif
@@ -42,6 +42,11 @@ CameraCalibration::CameraCalibration(float _fx, float _fy, float _cx, float _cy,
         m_distortion(i) = distorsionCoeff[i];
 }
 
+CameraCalibration CameraCalibration::getDefault()
+{
+    return CameraCalibration(526.58037684199849f, 524.65577209994706f, 318.41744018680112f, 202.96659047014398f);
+}
+
 const cv::Matx33f& CameraCalibration::getIntrinsic() const
 {
     return m_intrinsic;
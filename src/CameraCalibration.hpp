@@ -23,6 +23,11 @@ public:
     CameraCalibration(float fx, float fy, float cx, float cy);
     CameraCalibration(float fx, float fy, float cx, float cy, float distorsionCoeff[5]);
 
+    /**
+    * Calibration used by all applications of the example. Change it to the one of your camera.
+    */
+    static CameraCalibration getDefault();
+
     void getMatrix34(float cparam[3][4]) const;
 
     const cv::Matx33f& getIntrinsic() const;
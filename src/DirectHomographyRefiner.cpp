@@ -0,0 +1,393 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "DirectHomographyRefiner.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    struct GradientSample
+    {
+        float magnitude;
+        int   x;
+        int   y;
+    };
+
+    bool hasStrongerGradient(const GradientSample& a, const GradientSample& b)
+    {
+        return a.magnitude > b.magnitude;
+    }
+
+    inline cv::Matx33d scaleMatrix(double s)
+    {
+        return cv::Matx33d(s, 0, 0, 0, s, 0, 0, 0, 1);
+    }
+}
+
+DirectHomographyRefiner::DirectHomographyRefiner(int pyramidLevels, int maxIterations, int samplesPerLevel)
+    : m_pyramidLevels(pyramidLevels)
+    , m_maxIterations(maxIterations)
+    , m_samplesPerLevel(samplesPerLevel)
+{
+    CV_Assert(pyramidLevels > 0 && maxIterations > 0 && samplesPerLevel >= 8);
+}
+
+bool DirectHomographyRefiner::empty() const
+{
+    return m_levels.empty() || m_levels->empty();
+}
+
+void DirectHomographyRefiner::setTemplate(const cv::Mat& grayTemplate)
+{
+    m_levels.release();
+
+    if (grayTemplate.empty())
+        return;
+
+    CV_Assert(grayTemplate.type() == CV_8UC1);
+
+    std::vector<cv::Mat> pyramid;
+    cv::buildPyramid(grayTemplate, pyramid, m_pyramidLevels - 1);
+
+    // New levels are never modified after they are set, so copies of the refiner may share them
+    cv::Ptr<Levels> levels = new Levels();
+
+    for (size_t l = 0; l < pyramid.size(); l++)
+    {
+        const cv::Mat& img = pyramid[l];
+
+        // Too small levels are useless for alignment
+        if (img.cols < 16 || img.rows < 16)
+            break;
+
+        Level level;
+        initLevel(static_cast<int>(l), img.size(), level);
+
+        const double cx = (img.cols - 1) * 0.5;
+        const double cy = (img.rows - 1) * 0.5;
+        const double d  = std::max(img.cols, img.rows) * 0.5;
+
+        cv::Mat gx, gy;
+        cv::Sobel(img, gx, CV_32F, 1, 0, 3, 1.0 / 8);
+        cv::Sobel(img, gy, CV_32F, 0, 1, 3, 1.0 / 8);
+
+        // Use the pixels with the strongest gradient, flat regions do not constrain the alignment
+        std::vector<GradientSample> candidates;
+        for (int y = 1; y < img.rows - 1; y++)
+        {
+            const float* gxRow = gx.ptr<float>(y);
+            const float* gyRow = gy.ptr<float>(y);
+
+            for (int x = 1; x < img.cols - 1; x++)
+            {
+                GradientSample sample;
+                sample.magnitude = gxRow[x] * gxRow[x] + gyRow[x] * gyRow[x];
+                sample.x = x;
+                sample.y = y;
+
+                if (sample.magnitude > 0)
+                    candidates.push_back(sample);
+            }
+        }
+
+        const size_t samplesCount = std::min(candidates.size(), static_cast<size_t>(m_samplesPerLevel));
+        if (samplesCount < 8)
+            break;
+
+        std::nth_element(candidates.begin(), candidates.begin() + (samplesCount - 1), candidates.end(), hasStrongerGradient);
+        candidates.resize(samplesCount);
+
+        // Intensity statistics of the samples for zero-mean, unit-variance normalization
+        double sum = 0, sumSq = 0;
+        for (size_t i = 0; i < samplesCount; i++)
+        {
+            double v = img.at<uchar>(candidates[i].y, candidates[i].x);
+            sum   += v;
+            sumSq += v * v;
+        }
+
+        const double mean     = sum / samplesCount;
+        const double variance = sumSq / samplesCount - mean * mean;
+        if (variance <= 1e-6)
+            break;
+
+        const double invStd = 1.0 / std::sqrt(variance);
+
+        level.points.resize(samplesCount);
+        level.values.resize(samplesCount);
+        level.steepestDescent.resize(samplesCount * 8);
+
+        for (size_t i = 0; i < samplesCount; i++)
+        {
+            const int x = candidates[i].x;
+            const int y = candidates[i].y;
+
+            const double nx = (x - cx) / d;
+            const double ny = (y - cy) / d;
+
+            // Template gradient with respect to normalized coordinates
+            const double tx = gx.at<float>(y, x) * invStd * d;
+            const double ty = gy.at<float>(y, x) * invStd * d;
+
+            // Steepest descent image: gradient times the Jacobian of homography warp at identity
+            double sd[8] =
+            {
+                tx * nx, tx * ny, tx,
+                ty * nx, ty * ny, ty,
+                -tx * nx * nx - ty * nx * ny,
+                -tx * nx * ny - ty * ny * ny
+            };
+
+            for (int r = 0; r < 8; r++)
+                level.steepestDescent[i * 8 + r] = static_cast<float>(sd[r]);
+
+            level.points[i] = cv::Point2f(static_cast<float>(nx), static_cast<float>(ny));
+            level.values[i] = static_cast<float>((img.at<uchar>(y, x) - mean) * invStd);
+        }
+
+        computeInverseHessian(level);
+        levels->push_back(level);
+    }
+
+    if (!levels->empty())
+        m_levels = levels;
+}
+
+void DirectHomographyRefiner::getTemplateData(std::vector<cv::Mat>& levels) const
+{
+    levels.clear();
+    if (empty())
+        return;
+
+    levels.resize(m_levels->size());
+
+    for (size_t l = 0; l < m_levels->size(); l++)
+    {
+        const Level& level = (*m_levels)[l];
+        const int samplesCount = static_cast<int>(level.points.size());
+
+        levels[l].create(samplesCount, 3 + 8, CV_32F);
+        for (int i = 0; i < samplesCount; i++)
+        {
+            float* row = levels[l].ptr<float>(i);
+            row[0] = level.points[i].x;
+            row[1] = level.points[i].y;
+            row[2] = level.values[i];
+            std::copy(&level.steepestDescent[i * 8], &level.steepestDescent[i * 8] + 8, row + 3);
+        }
+    }
+}
+
+bool DirectHomographyRefiner::setTemplateData(cv::Size templateSize, const std::vector<cv::Mat>& levels)
+{
+    m_levels.release();
+
+    cv::Ptr<Levels> pyramid = new Levels();
+
+    // Level sizes follow cv::buildPyramid
+    cv::Size size = templateSize;
+
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        const cv::Mat& data = levels[l];
+        if (data.type() != CV_32FC1 || data.cols != 3 + 8 || data.rows < 8 || size.width < 16 || size.height < 16)
+            return false;
+
+        Level level;
+        initLevel(static_cast<int>(l), size, level);
+
+        level.points.resize(data.rows);
+        level.values.resize(data.rows);
+        level.steepestDescent.resize(data.rows * 8);
+
+        for (int i = 0; i < data.rows; i++)
+        {
+            const float* row = data.ptr<float>(i);
+            level.points[i] = cv::Point2f(row[0], row[1]);
+            level.values[i] = row[2];
+            std::copy(row + 3, row + 3 + 8, &level.steepestDescent[i * 8]);
+        }
+
+        computeInverseHessian(level);
+        pyramid->push_back(level);
+
+        size = cv::Size((size.width + 1) / 2, (size.height + 1) / 2);
+    }
+
+    if (pyramid->empty())
+        return false;
+
+    m_levels = pyramid;
+    return true;
+}
+
+void DirectHomographyRefiner::initLevel(int index, cv::Size size, Level& level)
+{
+    level.scale = 1.0 / (1 << index);
+
+    // Normalized coordinates are centered and lie in [-1, 1] range, which keeps the Hessian well conditioned
+    const double cx = (size.width - 1) * 0.5;
+    const double cy = (size.height - 1) * 0.5;
+    const double d  = std::max(size.width, size.height) * 0.5;
+    level.normalization = cv::Matx33d(1/d, 0, -cx/d, 0, 1/d, -cy/d, 0, 0, 1);
+}
+
+void DirectHomographyRefiner::computeInverseHessian(Level& level)
+{
+    Matx88d hessian = Matx88d::zeros();
+
+    for (size_t i = 0; i < level.points.size(); i++)
+    {
+        const float* sd = &level.steepestDescent[i * 8];
+
+        for (int r = 0; r < 8; r++)
+        {
+            for (int c = 0; c < 8; c++)
+                hessian(r, c) += static_cast<double>(sd[r]) * sd[c];
+        }
+    }
+
+    level.inverseHessian = hessian.inv(cv::DECOMP_CHOLESKY);
+}
+
+double DirectHomographyRefiner::alignLevel(const Level& level, const cv::Mat& frame, cv::Matx33d& warp, bool iterate)
+{
+    const int samplesCount = static_cast<int>(level.points.size());
+    const int iterations   = iterate ? m_maxIterations : 1;
+
+    std::vector<float>& warped = m_warpedValues;
+    warped.resize(samplesCount);
+    double meanError = -1;
+
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        // Sample the frame at the warped template points
+        int validCount = 0;
+        double sum = 0, sumSq = 0;
+
+        for (int i = 0; i < samplesCount; i++)
+        {
+            const cv::Point2f& p = level.points[i];
+
+            const double w = warp(2,0) * p.x + warp(2,1) * p.y + warp(2,2);
+            const double u = (warp(0,0) * p.x + warp(0,1) * p.y + warp(0,2)) / w;
+            const double v = (warp(1,0) * p.x + warp(1,1) * p.y + warp(1,2)) / w;
+
+            if (w <= 0 || !(u >= 0 && v >= 0 && u < frame.cols - 1 && v < frame.rows - 1))
+            {
+                warped[i] = -1;
+                continue;
+            }
+
+            const int   x0 = static_cast<int>(u);
+            const int   y0 = static_cast<int>(v);
+            const float ax = static_cast<float>(u - x0);
+            const float ay = static_cast<float>(v - y0);
+
+            const uchar* r0 = frame.ptr<uchar>(y0) + x0;
+            const uchar* r1 = frame.ptr<uchar>(y0 + 1) + x0;
+
+            const float value = (1 - ay) * ((1 - ax) * r0[0] + ax * r0[1]) + ay * ((1 - ax) * r1[0] + ax * r1[1]);
+
+            warped[i] = value;
+            sum   += value;
+            sumSq += value * value;
+            validCount++;
+        }
+
+        // Most of the pattern has to be visible
+        if (validCount < samplesCount / 2)
+            return -1;
+
+        const double mean     = sum / validCount;
+        const double variance = sumSq / validCount - mean * mean;
+        if (variance <= 1e-6)
+            return -1;
+
+        const double invStd = 1.0 / std::sqrt(variance);
+
+        Matx81d b = Matx81d::zeros();
+        double errorSum = 0;
+
+        for (int i = 0; i < samplesCount; i++)
+        {
+            if (warped[i] < 0)
+                continue;
+
+            const double e = (warped[i] - mean) * invStd - level.values[i];
+            const float* sd = &level.steepestDescent[i * 8];
+
+            for (int r = 0; r < 8; r++)
+                b(r) += sd[r] * e;
+
+            errorSum += std::fabs(e);
+        }
+
+        meanError = errorSum / validCount;
+
+        if (!iterate)
+            break;
+
+        // Inverse compositional update: W(x; p) <- W(x; p) o W(x; dp)^-1
+        const Matx81d dp = level.inverseHessian * b;
+        const cv::Matx33d update(1 + dp(0), dp(1),     dp(2),
+                                 dp(3),     1 + dp(4), dp(5),
+                                 dp(6),     dp(7),     1);
+
+        warp = warp * update.inv();
+
+        if (cv::norm(dp) < 1e-4)
+            break;
+    }
+
+    return meanError;
+}
+
+bool DirectHomographyRefiner::refine(const cv::Mat& grayFrame, cv::Mat& homography)
+{
+    if (empty() || grayFrame.empty() || homography.empty())
+        return false;
+
+    CV_Assert(grayFrame.type() == CV_8UC1);
+
+    const Levels& levels = *m_levels;
+    cv::buildPyramid(grayFrame, m_framePyramid, static_cast<int>(levels.size()) - 1);
+
+    cv::Matx33d H;
+    cv::Mat hView(3, 3, CV_64F, H.val);
+    homography.convertTo(hView, CV_64F);
+
+    const Level& finest = levels[0];
+
+    // Error of the initial homography to detect divergence
+    cv::Matx33d warp = H * finest.normalization.inv();
+    const double initialError = alignLevel(finest, m_framePyramid[0], warp, false);
+    if (initialError < 0)
+        return false;
+
+    // Coarse-to-fine alignment
+    for (int l = static_cast<int>(levels.size()) - 1; l >= 0; l--)
+    {
+        const Level& level = levels[l];
+        const cv::Matx33d S    = scaleMatrix(level.scale);
+        const cv::Matx33d Sinv = scaleMatrix(1.0 / level.scale);
+
+        warp = S * H * Sinv * level.normalization.inv();
+
+        if (alignLevel(level, m_framePyramid[l], warp, true) < 0)
+            return false;
+
+        H = Sinv * warp * level.normalization * S;
+    }
+
+    warp = H * finest.normalization.inv();
+    const double finalError = alignLevel(finest, m_framePyramid[0], warp, false);
+    if (finalError < 0 || finalError >= initialError)
+        return false;
+
+    cv::Mat(H).convertTo(homography, homography.type());
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef EXAMPLE_MARKERLESS_AR_DIRECTHOMOGRAPHYREFINER_HPP
+#define EXAMPLE_MARKERLESS_AR_DIRECTHOMOGRAPHYREFINER_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Refines the homography between the pattern image and the frame with direct image alignment
+ * (inverse-compositional Lucas-Kanade) instead of second feature detection and matching pass.
+ * Template samples, their steepest descent images and the inverse Hessian are computed once
+ * for each pyramid level in setTemplate, so each iteration costs one pass over the samples.
+ * The alignment goes from the coarse level to the fine one and compares zero-mean, unit-variance
+ * intensities, so it tolerates global brightness and contrast changes.
+ * Copies of the refiner share the template data (it's never modified once set), so a trained refiner
+ * is copied to each detection context cheaply; only the per-frame buffers belong to the copy.
+ */
+class DirectHomographyRefiner
+{
+public:
+    /**
+    * @pyramidLevels   - number of pyramid levels used for coarse-to-fine alignment
+    * @maxIterations   - maximal number of iterations on each level
+    * @samplesPerLevel - number of template pixels (with the strongest gradient) used on each level
+    */
+    DirectHomographyRefiner(int pyramidLevels = 3, int maxIterations = 15, int samplesPerLevel = 1500);
+
+    /**
+    * Precompute the template data from the gray pattern image.
+    */
+    void setTemplate(const cv::Mat& grayTemplate);
+
+    /**
+    * Precomputed template data as one matrix per pyramid level (e.g. to store it in a pattern file).
+    * Each row is a sample: normalized x and y, the template intensity and 8 steepest descent values (CV_32F).
+    */
+    void getTemplateData(std::vector<cv::Mat>& levels) const;
+
+    /**
+    * Set the template data of getTemplateData computed for the pattern image of @templateSize, so no image
+    * processing is needed. Returns false (and leaves the refiner empty) if the data is not valid.
+    */
+    bool setTemplateData(cv::Size templateSize, const std::vector<cv::Mat>& levels);
+
+    /**
+    * Returns true if the template was not set.
+    */
+    bool empty() const;
+
+    /**
+    * Align the template to the @grayFrame starting from @homography (maps template to frame coordinates).
+    * The function returns true and updates @homography if the alignment reduced the photometric error.
+    */
+    bool refine(const cv::Mat& grayFrame, cv::Mat& homography);
+
+private:
+    typedef cv::Matx<double, 8, 8> Matx88d;
+    typedef cv::Matx<double, 8, 1> Matx81d;
+
+    struct Level
+    {
+        double                   scale;          // Level size relative to the full resolution
+        cv::Matx33d              normalization;  // Maps level pixel coordinates to the normalized ones
+        std::vector<cv::Point2f> points;         // Normalized coordinates of samples
+        std::vector<float>       values;         // Zero-mean, unit-variance template intensities
+        std::vector<float>       steepestDescent; // 8 values per sample
+        Matx88d                  inverseHessian;
+    };
+
+    typedef std::vector<Level> Levels;
+
+    /**
+    * Set the scale and normalization of the level @index of the pyramid with the level image of @size.
+    */
+    static void initLevel(int index, cv::Size size, Level& level);
+
+    /**
+    * Compute the inverse Hessian from the steepest descent images of the level.
+    */
+    static void computeInverseHessian(Level& level);
+
+    /**
+    * Run the alignment on one level. @warp maps normalized template coordinates to level frame coordinates.
+    * Returns mean absolute error of the last iteration or negative value if too few samples are visible.
+    */
+    double alignLevel(const Level& level, const cv::Mat& frame, cv::Matx33d& warp, bool iterate);
+
+    int                  m_pyramidLevels;
+    int                  m_maxIterations;
+    int                  m_samplesPerLevel;
+    cv::Ptr<Levels>      m_levels;         // Shared by the copies
+    std::vector<cv::Mat> m_framePyramid;
+    std::vector<float>   m_warpedValues;   // Frame intensities at the warped samples of the current level
+};
+
+#endif
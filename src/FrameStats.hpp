@@ -0,0 +1,110 @@
+#ifndef EXAMPLE_MARKERLESS_AR_FRAMESTATS_HPP
+#define EXAMPLE_MARKERLESS_AR_FRAMESTATS_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "StageTimings.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cstddef>
+
+/**
+ * Statements collecting the frame statistics, removed by the preprocessor unless EXAMPLE_MARKERLESS_AR_FRAME_STATS
+ * is defined (see ENABLE_FRAME_STATS in CMakeLists.txt).
+ */
+#ifdef EXAMPLE_MARKERLESS_AR_FRAME_STATS
+#define FRAME_STATS(...) __VA_ARGS__
+#else
+#define FRAME_STATS(...)
+#endif
+
+/**
+ * What happened on one processed frame: stage times and the amount of work done by each stage.
+ * All fields stay zero when the statistics are disabled.
+ */
+struct FrameStats
+{
+    FrameStats()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        timings.reset();
+        keypointsCount    = 0;
+        matchesCount      = 0;
+        inliersCount      = 0;
+        ransacIterations  = 0;
+        allocationsCount  = 0;
+        tracked           = false;
+        refinementApplied = false;
+    }
+
+    StageTimings timings;
+    int          keypointsCount;    // Frame keypoints of the detection (none when the pattern was tracked)
+    int          matchesCount;      // Matches before the homography verification
+    int          inliersCount;      // Inliers of the final homography (tracked points when the pattern was tracked)
+    int          ransacIterations;  // Hypotheses generated by all the homography estimations of the frame
+    size_t       allocationsCount;  // Heap allocations (see AllocationCounter)
+    bool         tracked;           // Pattern was followed with optical flow instead of the detection
+    bool         refinementApplied; // Homography refinement pass ran
+};
+
+/**
+ * Fixed size ring buffer with the statistics of the recent frames. Adding a frame never allocates.
+ */
+class FrameStatsHistory
+{
+public:
+    static const size_t Capacity = 128;
+
+    FrameStatsHistory()
+        : m_next(0)
+        , m_size(0)
+    {
+    }
+
+    void clear()
+    {
+        m_next = 0;
+        m_size = 0;
+    }
+
+    /**
+    * Add the frame, the oldest one is dropped when the buffer is full.
+    */
+    void push(const FrameStats& stats)
+    {
+        FRAME_STATS(
+            m_frames[m_next] = stats;
+            m_next = (m_next + 1) % Capacity;
+            if (m_size < Capacity)
+                m_size++;
+        )
+    }
+
+    /**
+    * Number of frames in the buffer (always 0 when the statistics are disabled).
+    */
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    /**
+    * Statistics of the frame processed @age frames ago (0 - the last one), @age < size().
+    */
+    const FrameStats& get(size_t age) const
+    {
+        return m_frames[(m_next + Capacity - 1 - age) % Capacity];
+    }
+
+private:
+    FrameStats m_frames[Capacity];
+    size_t     m_next;
+    size_t     m_size;
+};
+
+#endif
@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "FrameView.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cassert>
+
+FrameView::FrameView()
+    : m_format(Gray)
+{
+}
+
+FrameView::FrameView(const cv::Mat& image)
+    : m_format(Gray)
+    , m_size(image.size())
+    , m_data(image)
+{
+    if (image.channels() == 3)
+        m_format = BGR;
+    else if (image.channels() == 4)
+        m_format = BGRA;
+    else
+        assert(image.channels() == 1);
+}
+
+FrameView FrameView::fromNV12(const unsigned char* data, int width, int height, size_t stride)
+{
+    assert(width % 2 == 0 && height % 2 == 0);
+
+    FrameView view;
+    view.m_format = NV12;
+    view.m_size   = cv::Size(width, height);
+    view.m_data   = cv::Mat(height * 3 / 2, width, CV_8UC1, const_cast<unsigned char*>(data), stride ? stride : cv::Mat::AUTO_STEP);
+    return view;
+}
+
+FrameView FrameView::fromI420(const unsigned char* data, int width, int height, size_t stride)
+{
+    assert(width % 2 == 0 && height % 2 == 0);
+
+    FrameView view;
+    view.m_format = I420;
+    view.m_size   = cv::Size(width, height);
+    view.m_data   = cv::Mat(height * 3 / 2, width, CV_8UC1, const_cast<unsigned char*>(data), stride ? stride : cv::Mat::AUTO_STEP);
+    return view;
+}
+
+FrameView FrameView::fromYUYV(const unsigned char* data, int width, int height, size_t stride)
+{
+    assert(width % 2 == 0);
+
+    FrameView view;
+    view.m_format = YUYV;
+    view.m_size   = cv::Size(width, height);
+    view.m_data   = cv::Mat(height, width, CV_8UC2, const_cast<unsigned char*>(data), stride ? stride : cv::Mat::AUTO_STEP);
+    return view;
+}
+
+FrameView::Format FrameView::format() const
+{
+    return m_format;
+}
+
+cv::Size FrameView::size() const
+{
+    return m_size;
+}
+
+bool FrameView::empty() const
+{
+    return m_data.empty();
+}
+
+cv::Mat FrameView::getGray(cv::Mat& buffer) const
+{
+    switch (m_format)
+    {
+    case Gray:
+        return m_data;
+
+    case NV12:
+    case I420:
+        // Luma plane comes first
+        return m_data.rowRange(0, m_size.height);
+
+    case YUYV:
+        // Luma is every other byte, take it without color math
+        cv::extractChannel(m_data, buffer, 0);
+        return buffer;
+
+    case BGR:
+        cv::cvtColor(m_data, buffer, CV_BGR2GRAY);
+        return buffer;
+
+    case BGRA:
+        cv::cvtColor(m_data, buffer, CV_BGRA2GRAY);
+        return buffer;
+    }
+
+    return cv::Mat();
+}
+
+cv::Mat FrameView::getBgr(cv::Mat& buffer) const
+{
+    switch (m_format)
+    {
+    case BGR:
+        return m_data;
+
+    case Gray:
+        cv::cvtColor(m_data, buffer, CV_GRAY2BGR);
+        return buffer;
+
+    case BGRA:
+        cv::cvtColor(m_data, buffer, CV_BGRA2BGR);
+        return buffer;
+
+    case NV12:
+        cv::cvtColor(m_data, buffer, CV_YUV2BGR_NV12);
+        return buffer;
+
+    case I420:
+        cv::cvtColor(m_data, buffer, CV_YUV2BGR_I420);
+        return buffer;
+
+    case YUYV:
+        cv::cvtColor(m_data, buffer, CV_YUV2BGR_YUYV);
+        return buffer;
+    }
+
+    return cv::Mat();
+}
@@ -0,0 +1,64 @@
+#ifndef EXAMPLE_MARKERLESS_AR_FRAMEVIEW_HPP
+#define EXAMPLE_MARKERLESS_AR_FRAMEVIEW_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+
+/**
+ * Non-owning description of a camera frame in one of the common capture formats.
+ * Detection needs only the luma, which is a plane of NV12 and I420 frames, so it's used in place without
+ * color conversion or copying. Full color conversion is done only for display (see getBgr).
+ * The frame memory is owned by the caller and must stay valid while the view is used.
+ */
+class FrameView
+{
+public:
+    enum Format
+    {
+        Gray,
+        BGR,
+        BGRA,
+        NV12,   // Y plane followed by interleaved UV plane of half resolution
+        I420,   // Y plane followed by U and V planes of half resolution
+        YUYV    // Packed Y0 U Y1 V, two pixels in four bytes
+    };
+
+    FrameView();
+
+    /**
+    * View of the 1 channel (gray), 3 channels (BGR) or 4 channels (BGRA) image.
+    * Intentionally implicit, so the functions taking the frame view accept cv::Mat as well.
+    */
+    FrameView(const cv::Mat& image);
+
+    /**
+    * Planar and packed YUV frames. @stride is the size of the luma row in bytes (0 - rows are not padded),
+    * chroma planes must follow the luma plane with the same layout as in the unpadded frame.
+    */
+    static FrameView fromNV12(const unsigned char* data, int width, int height, size_t stride = 0);
+    static FrameView fromI420(const unsigned char* data, int width, int height, size_t stride = 0);
+    static FrameView fromYUYV(const unsigned char* data, int width, int height, size_t stride = 0);
+
+    Format   format() const;
+    cv::Size size() const;
+    bool     empty() const;
+
+    /**
+    * Gray image of the frame. For gray, NV12 and I420 frames it's a view of the frame memory;
+    * luma of YUYV frames is extracted and BGR(A) frames are converted into @buffer.
+    */
+    cv::Mat getGray(cv::Mat& buffer) const;
+
+    /**
+    * Color image for display. BGR frames are returned as is, other formats are converted into @buffer.
+    */
+    cv::Mat getBgr(cv::Mat& buffer) const;
+
+private:
+    Format   m_format;
+    cv::Size m_size;
+    cv::Mat  m_data;   // Whole frame: image for Gray/BGR(A), luma rows followed by chroma rows for NV12/I420, 2 channels for YUYV
+};
+
+#endif
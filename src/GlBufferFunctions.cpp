@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "GlBufferFunctions.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+#include <cstdio>
+#include <cstring>
+
+GenBuffersFunction    glGenBuffersPtr    = 0;
+DeleteBuffersFunction glDeleteBuffersPtr = 0;
+BindBufferFunction    glBindBufferPtr    = 0;
+BufferDataFunction    glBufferDataPtr    = 0;
+MapBufferFunction     glMapBufferPtr     = 0;
+UnmapBufferFunction   glUnmapBufferPtr   = 0;
+
+namespace
+{
+  void* getProcAddress(const char* name)
+  {
+#ifdef _WIN32
+    return reinterpret_cast<void*>(wglGetProcAddress(name));
+#else
+    return reinterpret_cast<void*>(glXGetProcAddressARB(reinterpret_cast<const GLubyte*>(name)));
+#endif
+  }
+}
+
+bool isGlVersionAtLeast(int major, int minor)
+{
+  // Version string starts with "major.minor", vendor specific information follows
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  int contextMajor = 0, contextMinor = 0;
+  if (!version || std::sscanf(version, "%d.%d", &contextMajor, &contextMinor) != 2)
+    return false;
+
+  return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+bool hasGlExtension(const char* name)
+{
+  const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (!extensions)
+    return false;
+
+  // Names are separated by spaces and some are prefixes of others
+  const size_t length = std::strlen(name);
+  for (const char* found = std::strstr(extensions, name); found; found = std::strstr(found + length, name))
+  {
+    const bool startsWord = found == extensions || found[-1] == ' ';
+    const bool endsWord   = found[length] == ' ' || found[length] == '\0';
+    if (startsWord && endsWord)
+      return true;
+  }
+
+  return false;
+}
+
+bool loadGlBufferFunctions()
+{
+  // Core names of the buffer functions are OpenGL 1.5
+  if (!isGlVersionAtLeast(1, 5))
+    return false;
+
+  glGenBuffersPtr    = reinterpret_cast<GenBuffersFunction>(getProcAddress("glGenBuffers"));
+  glDeleteBuffersPtr = reinterpret_cast<DeleteBuffersFunction>(getProcAddress("glDeleteBuffers"));
+  glBindBufferPtr    = reinterpret_cast<BindBufferFunction>(getProcAddress("glBindBuffer"));
+  glBufferDataPtr    = reinterpret_cast<BufferDataFunction>(getProcAddress("glBufferData"));
+  glMapBufferPtr     = reinterpret_cast<MapBufferFunction>(getProcAddress("glMapBuffer"));
+  glUnmapBufferPtr   = reinterpret_cast<UnmapBufferFunction>(getProcAddress("glUnmapBuffer"));
+
+  return glGenBuffersPtr && glDeleteBuffersPtr && glBindBufferPtr && glBufferDataPtr && glMapBufferPtr && glUnmapBufferPtr;
+}
+
+bool loadGlPixelBufferFunctions()
+{
+  if (!isGlVersionAtLeast(2, 1) && !hasGlExtension("GL_ARB_pixel_buffer_object"))
+    return false;
+
+  return loadGlBufferFunctions();
+}
@@ -0,0 +1,74 @@
+#ifndef EXAMPLE_MARKERLESS_AR_GLBUFFERFUNCTIONS_HPP
+#define EXAMPLE_MARKERLESS_AR_GLBUFFERFUNCTIONS_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <gl/gl.h>
+#include <cstddef>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+
+/**
+ * Buffer objects are OpenGL 1.5, which is not declared by all system headers (e.g. gl.h of Windows),
+ * so the functions are loaded at runtime.
+ */
+typedef void      (APIENTRY *GenBuffersFunction)(GLsizei n, GLuint* buffers);
+typedef void      (APIENTRY *DeleteBuffersFunction)(GLsizei n, const GLuint* buffers);
+typedef void      (APIENTRY *BindBufferFunction)(GLenum target, GLuint buffer);
+typedef void      (APIENTRY *BufferDataFunction)(GLenum target, std::ptrdiff_t size, const void* data, GLenum usage);
+typedef void*     (APIENTRY *MapBufferFunction)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY *UnmapBufferFunction)(GLenum target);
+
+extern GenBuffersFunction    glGenBuffersPtr;
+extern DeleteBuffersFunction glDeleteBuffersPtr;
+extern BindBufferFunction    glBindBufferPtr;
+extern BufferDataFunction    glBufferDataPtr;
+extern MapBufferFunction     glMapBufferPtr;
+extern UnmapBufferFunction   glUnmapBufferPtr;
+
+/**
+ * Check the OpenGL version and the extensions of the current context.
+ */
+bool isGlVersionAtLeast(int major, int minor);
+bool hasGlExtension(const char* name);
+
+/**
+ * Load the buffer object functions, must be called with the context current. Returns false if they are not supported.
+ * Support is decided by the context version, non-null function addresses alone don't tell it (e.g. Mesa returns
+ * a dispatch stub for any name).
+ */
+bool loadGlBufferFunctions();
+
+/**
+ * Same as above for streaming through GL_PIXEL_UNPACK_BUFFER, which needs OpenGL 2.1 or GL_ARB_pixel_buffer_object
+ * on top of the buffer objects.
+ */
+bool loadGlPixelBufferFunctions();
+
+#endif
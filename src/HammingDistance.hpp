@@ -0,0 +1,130 @@
+#ifndef EXAMPLE_MARKERLESS_AR_HAMMINGDISTANCE_HPP
+#define EXAMPLE_MARKERLESS_AR_HAMMINGDISTANCE_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cstring>
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+#define HAMMING_USE_AVX512 1
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define HAMMING_USE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+/**
+ * Hamming distance kernels for binary descriptors (ORB - 32 bytes, FREAK - 64 bytes).
+ * The SIMD implementation is selected at compile time (AVX-512 VPOPCNTDQ, AVX2 or scalar 64-bit popcount),
+ * enable the matching compiler flags (e.g. ENABLE_NATIVE_OPTIMIZATIONS in CMake) to get the vector versions.
+ */
+namespace hamming
+{
+    /**
+    * Descriptors in the padded layout have a row length that is a multiple of this value (zero padded).
+    */
+    const int kPaddedBlock = 32;
+
+    /**
+    * Returns the row length of padded descriptor layout for descriptors of @length bytes.
+    */
+    inline int paddedLength(int length)
+    {
+        return (length + kPaddedBlock - 1) / kPaddedBlock * kPaddedBlock;
+    }
+
+    inline int popcount64(unsigned long long v)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<int>(__popcnt64(v));
+#else
+        v = v - ((v >> 1) & 0x5555555555555555ULL);
+        v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+        v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+#if HAMMING_USE_AVX2
+    // Per-byte popcount with nibble lookup table, summed to 4 64-bit lanes
+    inline __m256i popcount256(__m256i v)
+    {
+        const __m256i lookup = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                                0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+        const __m256i lowMask = _mm256_set1_epi8(0x0f);
+
+        __m256i lo = _mm256_and_si256(v, lowMask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+        __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+    }
+#endif
+
+    /**
+    * Distance between two descriptors of arbitrary length in bytes.
+    */
+    inline int distance(const unsigned char* a, const unsigned char* b, int length)
+    {
+        int result = 0;
+        int i = 0;
+
+        for (; i + 8 <= length; i += 8)
+        {
+            unsigned long long x, y;
+            std::memcpy(&x, a + i, 8);
+            std::memcpy(&y, b + i, 8);
+            result += popcount64(x ^ y);
+        }
+
+        for (; i < length; i++)
+        {
+            result += popcount64(static_cast<unsigned long long>(a[i] ^ b[i]));
+        }
+
+        return result;
+    }
+
+    /**
+    * Distance between two descriptors in the padded layout. @length must be a multiple of kPaddedBlock.
+    */
+    inline int distancePadded(const unsigned char* a, const unsigned char* b, int length)
+    {
+#if HAMMING_USE_AVX512
+        int i = 0;
+        __m512i acc = _mm512_setzero_si512();
+        for (; i + 64 <= length; i += 64)
+        {
+            __m512i x = _mm512_loadu_si512(reinterpret_cast<const void*>(a + i));
+            __m512i y = _mm512_loadu_si512(reinterpret_cast<const void*>(b + i));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_xor_si512(x, y)));
+        }
+
+        int result = static_cast<int>(_mm512_reduce_add_epi64(acc));
+        if (i < length)
+            result += distance(a + i, b + i, length - i);
+        return result;
+#elif HAMMING_USE_AVX2
+        __m256i acc = _mm256_setzero_si256();
+        for (int i = 0; i < length; i += 32)
+        {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            acc = _mm256_add_epi64(acc, popcount256(_mm256_xor_si256(x, y)));
+        }
+
+        __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+        return _mm_cvtsi128_si32(sum);
+#else
+        return distance(a, b, length);
+#endif
+    }
+}
+
+#endif
@@ -0,0 +1,450 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "HammingMatcher.hpp"
+#include "HammingDistance.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace
+{
+    // Train rows are scanned in blocks that fit into L1 cache together with the query row
+    const int kBlockBytes = 16 * 1024;
+
+    // Alignment of the packed train buffer (cache line)
+    const int kBufferAlignment = 64;
+
+    /**
+     * Scan all (query, train) pairs block by block and update the best/second best distances of queries
+     * and the best distance of train rows. Length is the compile-time row length (0 - use @stride).
+     * Best indices of queries are shifted by @indexOffset.
+     */
+    template <int Length>
+    void scanFused(const unsigned char* query, int queryCount,
+                   const unsigned char* train, int trainCount, int stride, int indexOffset,
+                   int* bestDistance, int* bestIndex, int* secondDistance,
+                   int* trainBestDistance, int* trainBestIndex)
+    {
+        const int length    = Length > 0 ? Length : stride;
+        const int blockRows = std::max(1, kBlockBytes / stride);
+
+        for (int blockStart = 0; blockStart < trainCount; blockStart += blockRows)
+        {
+            const int blockEnd = std::min(trainCount, blockStart + blockRows);
+
+            for (int q = 0; q < queryCount; q++)
+            {
+                const unsigned char* queryRow = query + q * stride;
+
+                int best   = bestDistance[q];
+                int bestI  = bestIndex[q];
+                int second = secondDistance[q];
+
+                for (int t = blockStart; t < blockEnd; t++)
+                {
+                    const int d = hamming::distancePadded(queryRow, train + t * stride, length);
+
+                    if (d < best)
+                    {
+                        second = best;
+                        best   = d;
+                        bestI  = indexOffset + t;
+                    }
+                    else if (d < second)
+                    {
+                        second = d;
+                    }
+
+                    if (d < trainBestDistance[t])
+                    {
+                        trainBestDistance[t] = d;
+                        trainBestIndex[t]    = q;
+                    }
+                }
+
+                bestDistance[q]   = best;
+                bestIndex[q]      = bestI;
+                secondDistance[q] = second;
+            }
+        }
+    }
+}
+
+HammingMatcher::HammingMatcher(bool crossCheck)
+    : m_crossCheck(crossCheck)
+    , m_isTrained(false)
+    , m_descriptorLength(0)
+    , m_stride(0)
+    , m_trainCount(0)
+    , m_trainData(0)
+{
+}
+
+void HammingMatcher::add(const std::vector<cv::Mat>& descriptors)
+{
+    cv::DescriptorMatcher::add(descriptors);
+    m_isTrained = false;
+}
+
+void HammingMatcher::clear()
+{
+    cv::DescriptorMatcher::clear();
+
+    m_isTrained  = false;
+    m_trainCount = 0;
+    m_trainData  = 0;
+    m_trainBuffer.release();
+    m_imageOffsets.clear();
+}
+
+bool HammingMatcher::isMaskSupported() const
+{
+    return false;
+}
+
+cv::Ptr<cv::DescriptorMatcher> HammingMatcher::clone(bool emptyTrainData) const
+{
+    HammingMatcher* matcher = new HammingMatcher(m_crossCheck);
+
+    // Train data is never modified, so it's safe to share it
+    if (!emptyTrainData)
+        shareTrainData(*matcher);
+
+    return matcher;
+}
+
+void HammingMatcher::shareTrainData(HammingMatcher& matcher) const
+{
+    matcher.trainDescCollection = trainDescCollection;
+
+    // Packed rows are shared as well, train() always packs into a new buffer
+    matcher.m_isTrained        = m_isTrained;
+    matcher.m_descriptorLength = m_descriptorLength;
+    matcher.m_stride           = m_stride;
+    matcher.m_trainCount       = m_trainCount;
+    matcher.m_trainBuffer      = m_trainBuffer;
+    matcher.m_trainData        = m_trainData;
+    matcher.m_imageOffsets     = m_imageOffsets;
+}
+
+void HammingMatcher::train()
+{
+    if (m_isTrained)
+        return;
+
+    // Compute the global row offset of each image
+    m_imageOffsets.resize(trainDescCollection.size() + 1);
+    m_descriptorLength = 0;
+    m_trainCount = 0;
+
+    for (size_t i = 0; i < trainDescCollection.size(); i++)
+    {
+        const cv::Mat& descriptors = trainDescCollection[i];
+        m_imageOffsets[i] = m_trainCount;
+
+        if (descriptors.empty())
+            continue;
+
+        CV_Assert(descriptors.type() == CV_8UC1);
+        CV_Assert(m_descriptorLength == 0 || m_descriptorLength == descriptors.cols);
+
+        m_descriptorLength = descriptors.cols;
+        m_trainCount += descriptors.rows;
+    }
+
+    m_imageOffsets.back() = m_trainCount;
+    m_stride = hamming::paddedLength(m_descriptorLength);
+
+    if (m_trainCount == 0)
+    {
+        m_trainBuffer.release();
+        m_trainData = 0;
+    }
+    else if (trainDescCollection.size() == 1 &&
+             trainDescCollection[0].cols == m_stride &&
+             trainDescCollection[0].step == static_cast<size_t>(m_stride))
+    {
+        // Descriptors already have the padded layout (e.g. 32 bytes ORB or 64 bytes FREAK in a continuous matrix),
+        // so they are used in place. Kernels use unaligned loads, so no particular alignment is required.
+        m_trainBuffer = trainDescCollection[0];
+        m_trainData   = m_trainBuffer.data;
+    }
+    else
+    {
+        // Pack all images into one aligned buffer with zero-padded rows
+        m_trainBuffer = cv::Mat(1, m_trainCount * m_stride + kBufferAlignment, CV_8U);
+        unsigned char* data = cv::alignPtr(m_trainBuffer.data, kBufferAlignment);
+
+        unsigned char* row = data;
+        for (size_t i = 0; i < trainDescCollection.size(); i++)
+        {
+            const cv::Mat& descriptors = trainDescCollection[i];
+            for (int r = 0; r < descriptors.rows; r++, row += m_stride)
+            {
+                std::memcpy(row, descriptors.ptr(r), m_descriptorLength);
+                std::memset(row + m_descriptorLength, 0, m_stride - m_descriptorLength);
+            }
+        }
+
+        m_trainData = data;
+    }
+
+    m_isTrained = true;
+}
+
+const unsigned char* HammingMatcher::packQuery(const cv::Mat& queryDescriptors)
+{
+    CV_Assert(queryDescriptors.type() == CV_8UC1 && queryDescriptors.cols == m_descriptorLength);
+
+    // Query already has the padded layout
+    if (queryDescriptors.cols == m_stride && queryDescriptors.isContinuous())
+        return queryDescriptors.data;
+
+    m_queryBuffer.create(queryDescriptors.rows, m_stride, CV_8U);
+    for (int r = 0; r < queryDescriptors.rows; r++)
+    {
+        unsigned char* row = m_queryBuffer.ptr(r);
+        std::memcpy(row, queryDescriptors.ptr(r), m_descriptorLength);
+        std::memset(row + m_descriptorLength, 0, m_stride - m_descriptorLength);
+    }
+
+    return m_queryBuffer.data;
+}
+
+cv::DMatch HammingMatcher::makeMatch(int queryIdx, int globalTrainIdx, int distance) const
+{
+    return makeMatch(queryIdx, globalTrainIdx, distance, m_imageOffsets);
+}
+
+cv::DMatch HammingMatcher::makeMatch(int queryIdx, int trainIdx, int distance, const std::vector<int>& imageOffsets)
+{
+    // Find the image the row belongs to (empty images share the offset with the next one)
+    const int imgIdx = static_cast<int>(std::upper_bound(imageOffsets.begin(), imageOffsets.end(), trainIdx) - imageOffsets.begin()) - 1;
+
+    return cv::DMatch(queryIdx, trainIdx - imageOffsets[imgIdx], imgIdx, static_cast<float>(distance));
+}
+
+void HammingMatcher::matchFused(const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches, float maxRatio)
+{
+    matches.clear();
+    train();
+
+    if (queryDescriptors.empty() || m_trainCount == 0)
+        return;
+
+    const unsigned char* query = packQuery(queryDescriptors);
+    const int queryCount = queryDescriptors.rows;
+
+    m_bestDistance.assign(queryCount, INT_MAX);
+    m_bestIndex.assign(queryCount, -1);
+    m_secondDistance.assign(queryCount, INT_MAX);
+    m_trainBestDistance.assign(m_trainCount, INT_MAX);
+    m_trainBestIndex.assign(m_trainCount, -1);
+
+    scanRows(query, queryCount, 0, m_trainCount, 0);
+    collectMatches(queryCount, maxRatio, matches);
+}
+
+void HammingMatcher::matchImages(const cv::Mat& queryDescriptors, const std::vector<int>& imageIndices, std::vector<cv::DMatch>& matches, float maxRatio)
+{
+    matches.clear();
+    train();
+
+    if (queryDescriptors.empty() || m_trainCount == 0)
+        return;
+
+    const int subsetCount = prepareSubset(imageIndices);
+    if (subsetCount == 0)
+        return;
+
+    const unsigned char* query = packQuery(queryDescriptors);
+    const int queryCount = queryDescriptors.rows;
+
+    m_bestDistance.assign(queryCount, INT_MAX);
+    m_bestIndex.assign(queryCount, -1);
+    m_secondDistance.assign(queryCount, INT_MAX);
+    m_trainBestDistance.assign(subsetCount, INT_MAX);
+    m_trainBestIndex.assign(subsetCount, -1);
+
+    // Each image is a contiguous range of the packed rows
+    for (size_t i = 0; i < imageIndices.size(); i++)
+    {
+        const int imgIdx = imageIndices[i];
+        scanRows(query, queryCount, m_imageOffsets[imgIdx], m_imageOffsets[imgIdx + 1] - m_imageOffsets[imgIdx], m_subsetOffsets[i]);
+    }
+
+    collectMatches(queryCount, maxRatio, m_subsetOffsets, matches);
+}
+
+void HammingMatcher::scanRows(const unsigned char* query, int queryCount, int firstRow, int rowsCount, int indexOffset)
+{
+    if (rowsCount == 0)
+        return;
+
+    const unsigned char* train = m_trainData + firstRow * m_stride;
+
+    // Specialize the kernel for the common descriptor sizes
+    switch (m_stride)
+    {
+    case 32:
+        scanFused<32>(query, queryCount, train, rowsCount, m_stride, indexOffset, &m_bestDistance[0], &m_bestIndex[0], &m_secondDistance[0], &m_trainBestDistance[indexOffset], &m_trainBestIndex[indexOffset]);
+        break;
+    case 64:
+        scanFused<64>(query, queryCount, train, rowsCount, m_stride, indexOffset, &m_bestDistance[0], &m_bestIndex[0], &m_secondDistance[0], &m_trainBestDistance[indexOffset], &m_trainBestIndex[indexOffset]);
+        break;
+    default:
+        scanFused<0>(query, queryCount, train, rowsCount, m_stride, indexOffset, &m_bestDistance[0], &m_bestIndex[0], &m_secondDistance[0], &m_trainBestDistance[indexOffset], &m_trainBestIndex[indexOffset]);
+        break;
+    }
+}
+
+int HammingMatcher::prepareSubset(const std::vector<int>& imageIndices)
+{
+    // Rows of the subset are numbered contiguously in the order of the images
+    m_subsetOffsets.resize(imageIndices.size() + 1);
+    int subsetCount = 0;
+
+    for (size_t i = 0; i < imageIndices.size(); i++)
+    {
+        const int imgIdx = imageIndices[i];
+        CV_Assert(imgIdx >= 0 && imgIdx < static_cast<int>(trainDescCollection.size()));
+
+        m_subsetOffsets[i] = subsetCount;
+        subsetCount += m_imageOffsets[imgIdx + 1] - m_imageOffsets[imgIdx];
+    }
+
+    m_subsetOffsets.back() = subsetCount;
+    return subsetCount;
+}
+
+void HammingMatcher::collectMatches(int queryCount, float maxRatio, std::vector<cv::DMatch>& matches) const
+{
+    collectMatches(queryCount, maxRatio, m_imageOffsets, matches);
+}
+
+void HammingMatcher::collectMatches(int queryCount, float maxRatio, const std::vector<int>& imageOffsets, std::vector<cv::DMatch>& matches) const
+{
+    const bool useRatioTest = maxRatio < 1.f;
+    matches.reserve(queryCount);
+
+    for (int q = 0; q < queryCount; q++)
+    {
+        const int t = m_bestIndex[q];
+        if (t < 0)
+            continue;
+
+        // Pass only distinct matches
+        if (useRatioTest && m_secondDistance[q] != INT_MAX && !(m_bestDistance[q] < maxRatio * m_secondDistance[q]))
+            continue;
+
+        // Pass only mutual nearest neighbours
+        if (m_crossCheck && m_trainBestIndex[t] != q)
+            continue;
+
+        matches.push_back(makeMatch(q, t, m_bestDistance[q], imageOffsets));
+    }
+}
+
+void HammingMatcher::knnMatchImpl(const cv::Mat& queryDescriptors, std::vector< std::vector<cv::DMatch> >& matches, int k,
+    const std::vector<cv::Mat>& /*masks*/, bool compactResult)
+{
+    const int queryCount = queryDescriptors.rows;
+
+    matches.clear();
+    matches.resize(queryCount);
+
+    if (k == 1)
+    {
+        // Nearest neighbour with optional cross-check is the fused pass
+        std::vector<cv::DMatch> flatMatches;
+        matchFused(queryDescriptors, flatMatches);
+
+        for (size_t i = 0; i < flatMatches.size(); i++)
+            matches[flatMatches[i].queryIdx].push_back(flatMatches[i]);
+    }
+    else if (m_trainCount > 0)
+    {
+        // Generic k nearest neighbours (cross-check is defined only for k = 1)
+        const unsigned char* query = packQuery(queryDescriptors);
+        std::vector< std::pair<int, int> > nearest;
+
+        for (int q = 0; q < queryCount; q++)
+        {
+            const unsigned char* queryRow = query + q * m_stride;
+            nearest.clear();
+
+            for (int t = 0; t < m_trainCount; t++)
+            {
+                const int d = hamming::distancePadded(queryRow, m_trainData + t * m_stride, m_stride);
+
+                if (static_cast<int>(nearest.size()) == k && d >= nearest.back().first)
+                    continue;
+
+                // Insert keeping the list sorted by distance
+                std::pair<int, int> candidate(d, t);
+                nearest.insert(std::upper_bound(nearest.begin(), nearest.end(), candidate), candidate);
+
+                if (static_cast<int>(nearest.size()) > k)
+                    nearest.pop_back();
+            }
+
+            for (size_t i = 0; i < nearest.size(); i++)
+                matches[q].push_back(makeMatch(q, nearest[i].second, nearest[i].first));
+        }
+    }
+
+    if (compactResult)
+    {
+        std::vector< std::vector<cv::DMatch> > compact;
+        for (size_t i = 0; i < matches.size(); i++)
+        {
+            if (!matches[i].empty())
+                compact.push_back(matches[i]);
+        }
+        matches.swap(compact);
+    }
+}
+
+void HammingMatcher::radiusMatchImpl(const cv::Mat& queryDescriptors, std::vector< std::vector<cv::DMatch> >& matches, float maxDistance,
+    const std::vector<cv::Mat>& /*masks*/, bool compactResult)
+{
+    const int queryCount = queryDescriptors.rows;
+
+    matches.clear();
+    matches.resize(queryCount);
+
+    train();
+
+    if (m_trainCount > 0)
+    {
+        const unsigned char* query = packQuery(queryDescriptors);
+
+        for (int q = 0; q < queryCount; q++)
+        {
+            const unsigned char* queryRow = query + q * m_stride;
+
+            for (int t = 0; t < m_trainCount; t++)
+            {
+                const int d = hamming::distancePadded(queryRow, m_trainData + t * m_stride, m_stride);
+                if (d < maxDistance)
+                    matches[q].push_back(makeMatch(q, t, d));
+            }
+
+            std::sort(matches[q].begin(), matches[q].end());
+        }
+    }
+
+    if (compactResult)
+    {
+        std::vector< std::vector<cv::DMatch> > compact;
+        for (size_t i = 0; i < matches.size(); i++)
+        {
+            if (!matches[i].empty())
+                compact.push_back(matches[i]);
+        }
+        matches.swap(compact);
+    }
+}
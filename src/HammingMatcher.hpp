@@ -0,0 +1,113 @@
+#ifndef EXAMPLE_MARKERLESS_AR_HAMMINGMATCHER_HPP
+#define EXAMPLE_MARKERLESS_AR_HAMMINGMATCHER_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Brute-force matcher for binary descriptors (ORB, FREAK, BRIEF).
+ * Train descriptors of all images are packed into one aligned buffer with zero-padded rows, which
+ * is scanned in cache-sized blocks with the SIMD Hamming distance kernel. A single pass over all
+ * (query, train) pairs tracks best and second best train distances for each query and the best
+ * query for each train descriptor, which is enough for both ratio test and cross-check.
+ */
+class HammingMatcher : public cv::DescriptorMatcher
+{
+public:
+    /**
+    * @crossCheck - keep only mutual nearest neighbours in match() and matchFused().
+    */
+    HammingMatcher(bool crossCheck = true);
+
+    virtual void add(const std::vector<cv::Mat>& descriptors);
+    virtual void clear();
+    virtual bool isMaskSupported() const;
+    virtual void train();
+
+    /**
+    * Clone of a trained matcher shares its packed train descriptors and needs no training.
+    */
+    virtual cv::Ptr<cv::DescriptorMatcher> clone(bool emptyTrainData = false) const;
+
+    /**
+    * Find the nearest train descriptor for each query descriptor in one fused pass.
+    * The match passes the ratio test when best distance is less than @maxRatio times the second best distance,
+    * values of @maxRatio greater or equal to one disable the test. Cross-check is applied if enabled in constructor.
+    * Matches are written to the flat @matches buffer (previous content is discarded).
+    */
+    virtual void matchFused(const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches, float maxRatio = 1.f);
+
+    /**
+    * Same as matchFused, but only the packed rows of the train images listed in @imageIndices are scanned
+    * (no training, so a subset may change on every call). The imgIdx of each match is the position of its image
+    * in @imageIndices, cross-check is applied within the subset.
+    */
+    virtual void matchImages(const cv::Mat& queryDescriptors, const std::vector<int>& imageIndices, std::vector<cv::DMatch>& matches, float maxRatio = 1.f);
+
+protected:
+    virtual void knnMatchImpl(const cv::Mat& queryDescriptors, std::vector< std::vector<cv::DMatch> >& matches, int k,
+        const std::vector<cv::Mat>& masks = std::vector<cv::Mat>(), bool compactResult = false);
+
+    virtual void radiusMatchImpl(const cv::Mat& queryDescriptors, std::vector< std::vector<cv::DMatch> >& matches, float maxDistance,
+        const std::vector<cv::Mat>& masks = std::vector<cv::Mat>(), bool compactResult = false);
+
+    /**
+    * Make @matcher use the train descriptors and the packed train rows of this matcher without copying them.
+    */
+    void shareTrainData(HammingMatcher& matcher) const;
+
+    /**
+    * Copy query descriptors to the padded layout.
+    */
+    const unsigned char* packQuery(const cv::Mat& queryDescriptors);
+
+    /**
+    * Convert global train row index to the DMatch (image index and row in the image).
+    */
+    cv::DMatch makeMatch(int queryIdx, int globalTrainIdx, int distance) const;
+
+    /**
+    * Same as above with the first row of each image given by @imageOffsets.
+    */
+    static cv::DMatch makeMatch(int queryIdx, int trainIdx, int distance, const std::vector<int>& imageOffsets);
+
+    /**
+    * Number the rows of the images listed in @imageIndices contiguously (m_subsetOffsets) and return the count.
+    */
+    int prepareSubset(const std::vector<int>& imageIndices);
+
+    /**
+    * Compare @queryCount packed queries with @rowsCount packed train rows starting at @firstRow.
+    * Best distances of the rows are stored from @indexOffset and the best indices of queries are shifted by it.
+    */
+    void scanRows(const unsigned char* query, int queryCount, int firstRow, int rowsCount, int indexOffset);
+
+    /**
+    * Apply ratio test and cross-check to the best distances found for @queryCount queries and append passed matches.
+    * Best indices are converted to the images with @imageOffsets.
+    */
+    void collectMatches(int queryCount, float maxRatio, std::vector<cv::DMatch>& matches) const;
+    void collectMatches(int queryCount, float maxRatio, const std::vector<int>& imageOffsets, std::vector<cv::DMatch>& matches) const;
+
+    bool                       m_crossCheck;
+    bool                       m_isTrained;
+
+    int                        m_descriptorLength;  // Descriptor length in bytes
+    int                        m_stride;            // Row length of the padded layout
+    int                        m_trainCount;
+    cv::Mat                    m_trainBuffer;       // Owns the packed train descriptors
+    const unsigned char*       m_trainData;         // Aligned start of the packed rows
+    std::vector<int>           m_imageOffsets;      // First global row of each train image
+    std::vector<int>           m_subsetOffsets;     // First row of each image of the matchImages subset
+
+    cv::Mat                    m_queryBuffer;
+    std::vector<int>           m_bestDistance;
+    std::vector<int>           m_bestIndex;
+    std::vector<int>           m_secondDistance;
+    std::vector<int>           m_trainBestDistance;
+    std::vector<int>           m_trainBestIndex;
+};
+
+#endif
@@ -0,0 +1,570 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "HomographyEstimator.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HOMOGRAPHY_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const int kSampleSize = 4;
+
+    // Number of points verified between two SPRT decisions
+    const int kSprtBatch = 16;
+
+    // Time of the model estimation in units of the verification time of one point (SPRT parameter)
+    const double kModelEstimationCost = 200;
+
+    // Minimal area of a triangle of sample points (in normalized coordinates)
+    const double kMinSampleArea = 1e-6;
+
+    const int kBitsCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+    /**
+     * Sequential probability ratio test state. Epsilon is the probability that a point is consistent
+     * with a good model, delta is the probability that it's consistent with a bad model.
+     */
+    struct SprtTest
+    {
+        double epsilon;
+        double delta;
+        double A;
+        double logA;
+        double logInlierStep;
+        double logOutlierStep;
+
+        void update(double newEpsilon, double newDelta)
+        {
+            epsilon = std::min(0.99, std::max(0.05, newEpsilon));
+            delta   = std::min(epsilon * 0.5, std::max(1e-4, newDelta));
+
+            // Optimal decision threshold is the fixed point of A = t_M * C + 1 + log(A)
+            const double C = (1 - delta) * std::log((1 - delta) / (1 - epsilon)) + delta * std::log(delta / epsilon);
+
+            A = kModelEstimationCost * C + 1;
+            for (int i = 0; i < 10; i++)
+            {
+                const double next = kModelEstimationCost * C + 1 + std::log(A);
+                const bool converged = std::fabs(next - A) < 1e-6;
+                A = next;
+
+                if (converged)
+                    break;
+            }
+
+            logA           = std::log(A);
+            logInlierStep  = std::log(delta / epsilon);
+            logOutlierStep = std::log((1 - delta) / (1 - epsilon));
+        }
+    };
+
+    inline double cross(const cv::Point2d& a, const cv::Point2d& b, const cv::Point2d& c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    /**
+     * Move the centroid of points to the origin and scale them to the mean distance sqrt(2).
+     * Returns the normalization transform.
+     */
+    cv::Matx33d normalizePoints(const std::vector<cv::Point2f>& points, std::vector<cv::Point2d>& normalized)
+    {
+        const size_t count = points.size();
+
+        double cx = 0, cy = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            cx += points[i].x;
+            cy += points[i].y;
+        }
+        cx /= count;
+        cy /= count;
+
+        double meanDistance = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const double dx = points[i].x - cx;
+            const double dy = points[i].y - cy;
+            meanDistance += std::sqrt(dx * dx + dy * dy);
+        }
+        meanDistance /= count;
+
+        const double s = meanDistance > DBL_EPSILON ? std::sqrt(2.0) / meanDistance : 1.0;
+
+        normalized.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            normalized[i] = cv::Point2d((points[i].x - cx) * s, (points[i].y - cy) * s);
+        }
+
+        return cv::Matx33d(s, 0, -s * cx, 0, s, -s * cy, 0, 0, 1);
+    }
+
+    inline void toFloat(const cv::Matx33d& model, float* h)
+    {
+        for (int i = 0; i < 9; i++)
+            h[i] = static_cast<float>(model.val[i]);
+    }
+}
+
+HomographyEstimator::HomographyEstimator(double confidence, int maxIterations)
+    : enableSPRT(true)
+    , m_confidence(confidence)
+    , m_maxIterations(maxIterations)
+    , m_iterationsCount(0)
+    , m_rejectedCount(0)
+{
+    CV_Assert(confidence > 0 && confidence < 1 && maxIterations > 0);
+}
+
+const std::vector<unsigned char>& HomographyEstimator::getInliersMask() const
+{
+    return m_inliersMask;
+}
+
+int HomographyEstimator::getIterationsCount() const
+{
+    return m_iterationsCount;
+}
+
+int HomographyEstimator::getRejectedCount() const
+{
+    return m_rejectedCount;
+}
+
+bool HomographyEstimator::estimate(const std::vector<cv::KeyPoint>& queryKeypoints,
+    const std::vector<cv::KeyPoint>& trainKeypoints,
+    const std::vector<cv::DMatch>& matches,
+    float reprojectionThreshold,
+    cv::Mat& homography)
+{
+    const size_t count = matches.size();
+
+    // PROSAC order: the most distinctive matches first
+    m_ranks.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        m_ranks[i] = std::make_pair(matches[i].distance, static_cast<int>(i));
+    }
+    std::sort(m_ranks.begin(), m_ranks.end());
+
+    m_order.resize(count);
+    m_srcPoints.resize(count);
+    m_dstPoints.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const cv::DMatch& match = matches[m_ranks[i].second];
+
+        m_order[i]     = m_ranks[i].second;
+        m_srcPoints[i] = trainKeypoints[match.trainIdx].pt;
+        m_dstPoints[i] = queryKeypoints[match.queryIdx].pt;
+    }
+
+    return run(reprojectionThreshold, homography);
+}
+
+bool HomographyEstimator::estimate(const std::vector<cv::Point2f>& srcPoints,
+    const std::vector<cv::Point2f>& dstPoints,
+    float reprojectionThreshold,
+    cv::Mat& homography)
+{
+    CV_Assert(srcPoints.size() == dstPoints.size());
+
+    m_order.resize(srcPoints.size());
+    for (size_t i = 0; i < m_order.size(); i++)
+    {
+        m_order[i] = static_cast<int>(i);
+    }
+
+    m_srcPoints.assign(srcPoints.begin(), srcPoints.end());
+    m_dstPoints.assign(dstPoints.begin(), dstPoints.end());
+
+    return run(reprojectionThreshold, homography);
+}
+
+bool HomographyEstimator::computeModel(const int* sample, cv::Matx33d& model) const
+{
+    const cv::Point2d* src = &m_srcNormalized[0];
+    const cv::Point2d* dst = &m_dstNormalized[0];
+
+    // Reject collinear samples and samples that mirror the points (a plane can't be seen from behind)
+    static const int triplets[4][3] = { {0, 1, 2}, {0, 1, 3}, {0, 2, 3}, {1, 2, 3} };
+
+    for (int t = 0; t < 4; t++)
+    {
+        const int a = sample[triplets[t][0]];
+        const int b = sample[triplets[t][1]];
+        const int c = sample[triplets[t][2]];
+
+        const double srcArea = cross(src[a], src[b], src[c]);
+        const double dstArea = cross(dst[a], dst[b], dst[c]);
+
+        if (std::fabs(srcArea) < kMinSampleArea || std::fabs(dstArea) < kMinSampleArea || (srcArea > 0) != (dstArea > 0))
+            return false;
+    }
+
+    // Direct linear transform with h33 = 1
+    cv::Matx<double, 8, 8> A;
+    cv::Matx<double, 8, 1> b;
+
+    for (int k = 0; k < kSampleSize; k++)
+    {
+        const double x = src[sample[k]].x;
+        const double y = src[sample[k]].y;
+        const double u = dst[sample[k]].x;
+        const double v = dst[sample[k]].y;
+
+        const int r = 2 * k;
+
+        A(r, 0) = x; A(r, 1) = y; A(r, 2) = 1;
+        A(r, 6) = -u * x; A(r, 7) = -u * y;
+        b(r) = u;
+
+        A(r + 1, 3) = x; A(r + 1, 4) = y; A(r + 1, 5) = 1;
+        A(r + 1, 6) = -v * x; A(r + 1, 7) = -v * y;
+        b(r + 1) = v;
+    }
+
+    const cv::Matx<double, 8, 1> h = A.solve(b, cv::DECOMP_LU);
+    if (cv::norm(h, cv::NORM_INF) == 0)
+        return false;
+
+    const cv::Matx33d normalizedModel(h(0), h(1), h(2), h(3), h(4), h(5), h(6), h(7), 1);
+
+    model = m_dstDenormalization * normalizedModel * m_srcNormalization;
+    if (std::fabs(model(2,2)) < DBL_EPSILON)
+        return false;
+
+    model = model * (1.0 / model(2,2));
+    return true;
+}
+
+int HomographyEstimator::countInliers(const float* h, int begin, int end, float threshold2, unsigned char* mask) const
+{
+    const float* srcX = &m_srcX[0];
+    const float* srcY = &m_srcY[0];
+    const float* dstX = &m_dstX[0];
+    const float* dstY = &m_dstY[0];
+
+    // Point is an inlier if |(u, v) / w - dst| <= threshold, tested without division as |(u, v) - dst * w|^2 <= threshold^2 * w^2
+    int count = 0;
+    int i = begin;
+
+#if HOMOGRAPHY_USE_SSE2
+    const __m128 h0 = _mm_set1_ps(h[0]), h1 = _mm_set1_ps(h[1]), h2 = _mm_set1_ps(h[2]);
+    const __m128 h3 = _mm_set1_ps(h[3]), h4 = _mm_set1_ps(h[4]), h5 = _mm_set1_ps(h[5]);
+    const __m128 h6 = _mm_set1_ps(h[6]), h7 = _mm_set1_ps(h[7]), h8 = _mm_set1_ps(h[8]);
+    const __m128 t2 = _mm_set1_ps(threshold2);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(srcX + i);
+        const __m128 y = _mm_loadu_ps(srcY + i);
+
+        const __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h6, x), _mm_mul_ps(h7, y)), h8);
+        const __m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h0, x), _mm_mul_ps(h1, y)), h2);
+        const __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h3, x), _mm_mul_ps(h4, y)), h5);
+
+        const __m128 du = _mm_sub_ps(u, _mm_mul_ps(_mm_loadu_ps(dstX + i), w));
+        const __m128 dv = _mm_sub_ps(v, _mm_mul_ps(_mm_loadu_ps(dstY + i), w));
+
+        const __m128 error = _mm_add_ps(_mm_mul_ps(du, du), _mm_mul_ps(dv, dv));
+        const __m128 inlier = _mm_and_ps(_mm_cmple_ps(error, _mm_mul_ps(t2, _mm_mul_ps(w, w))), _mm_cmpgt_ps(w, zero));
+
+        const int bits = _mm_movemask_ps(inlier);
+        count += kBitsCount[bits];
+
+        if (mask)
+        {
+            mask[i]     = static_cast<unsigned char>(bits & 1);
+            mask[i + 1] = static_cast<unsigned char>((bits >> 1) & 1);
+            mask[i + 2] = static_cast<unsigned char>((bits >> 2) & 1);
+            mask[i + 3] = static_cast<unsigned char>((bits >> 3) & 1);
+        }
+    }
+#endif
+
+    for (; i < end; i++)
+    {
+        const float w = h[6] * srcX[i] + h[7] * srcY[i] + h[8];
+        const float du = h[0] * srcX[i] + h[1] * srcY[i] + h[2] - dstX[i] * w;
+        const float dv = h[3] * srcX[i] + h[4] * srcY[i] + h[5] - dstY[i] * w;
+
+        const bool inlier = w > 0 && du * du + dv * dv <= threshold2 * w * w;
+        count += inlier;
+
+        if (mask)
+            mask[i] = inlier;
+    }
+
+    return count;
+}
+
+bool HomographyEstimator::fitModel(cv::Matx33d& model)
+{
+    const cv::Matx33d srcNormalization   = normalizePoints(m_inlierSrc, m_inlierSrcNormalized);
+    const cv::Matx33d dstDenormalization = normalizePoints(m_inlierDst, m_inlierDstNormalized).inv();
+
+    // Normal equations of the DLT system, two rows per correspondence
+    cv::Matx<double, 9, 9> AtA = cv::Matx<double, 9, 9>::zeros();
+
+    for (size_t i = 0; i < m_inlierSrcNormalized.size(); i++)
+    {
+        const double x = m_inlierSrcNormalized[i].x, y = m_inlierSrcNormalized[i].y;
+        const double u = m_inlierDstNormalized[i].x, v = m_inlierDstNormalized[i].y;
+
+        const double r1[9] = { -x, -y, -1,  0,  0,  0, u * x, u * y, u };
+        const double r2[9] = {  0,  0,  0, -x, -y, -1, v * x, v * y, v };
+
+        for (int j = 0; j < 9; j++)
+        {
+            for (int k = j; k < 9; k++)
+                AtA(j, k) += r1[j] * r1[k] + r2[j] * r2[k];
+        }
+    }
+
+    for (int j = 0; j < 9; j++)
+    {
+        for (int k = 0; k < j; k++)
+            AtA(j, k) = AtA(k, j);
+    }
+
+    // Solution is the eigenvector of the smallest eigenvalue (eigenvalues are sorted in descending order)
+    cv::Matx<double, 9, 1> eigenvalues;
+    cv::Matx<double, 9, 9> eigenvectors;
+    if (!cv::eigen(AtA, eigenvalues, eigenvectors))
+        return false;
+
+    cv::Matx33d normalizedModel;
+    for (int j = 0; j < 9; j++)
+        normalizedModel.val[j] = eigenvectors(8, j);
+
+    model = dstDenormalization * normalizedModel * srcNormalization;
+
+    if (std::fabs(model(2,2)) < DBL_EPSILON)
+        return false;
+
+    model *= 1.0 / model(2,2);
+    return true;
+}
+
+bool HomographyEstimator::run(float reprojectionThreshold, cv::Mat& homography)
+{
+    const int count = static_cast<int>(m_srcPoints.size());
+
+    m_iterationsCount = 0;
+    m_rejectedCount   = 0;
+    m_inliersMask.assign(count, 0);
+
+    if (count < kSampleSize)
+        return false;
+
+    // Fixed seed keeps the result reproducible for the same input
+    m_rng = cv::RNG(0x484f4d4f);
+
+    m_srcNormalization   = normalizePoints(m_srcPoints, m_srcNormalized);
+    m_dstDenormalization = normalizePoints(m_dstPoints, m_dstNormalized).inv();
+
+    // Points are verified in random order, otherwise SPRT decisions would be biased by the PROSAC order
+    m_permutation.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        m_permutation[i] = i;
+    }
+    for (int i = count - 1; i > 0; i--)
+    {
+        std::swap(m_permutation[i], m_permutation[m_rng.uniform(0, i + 1)]);
+    }
+
+    m_srcX.resize(count);
+    m_srcY.resize(count);
+    m_dstX.resize(count);
+    m_dstY.resize(count);
+    m_scoreMask.resize(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        const int p = m_permutation[i];
+
+        m_srcX[i] = m_srcPoints[p].x;
+        m_srcY[i] = m_srcPoints[p].y;
+        m_dstX[i] = m_dstPoints[p].x;
+        m_dstY[i] = m_dstPoints[p].y;
+    }
+
+    const float threshold2 = reprojectionThreshold * reprojectionThreshold;
+
+    SprtTest sprt;
+    sprt.update(0.1, 0.01);
+
+    // PROSAC state: sampling pool contains the poolSize best correspondences and grows at poolGrowth iteration
+    int    poolSize       = kSampleSize;
+    double poolIterations = m_maxIterations;
+    double poolGrowth     = 1;
+
+    for (int i = 0; i < kSampleSize; i++)
+    {
+        poolIterations *= static_cast<double>(kSampleSize - i) / (count - i);
+    }
+
+    int         bestCount = 0;
+    cv::Matx33d bestModel;
+    int         maxIterations = m_maxIterations;
+    int         sample[kSampleSize];
+    float       h[9];
+
+    for (int iteration = 1; iteration <= maxIterations; iteration++)
+    {
+        m_iterationsCount = iteration;
+
+        // Add the next best correspondence to the pool
+        if (iteration > poolGrowth && poolSize < count)
+        {
+            poolSize++;
+
+            const double next = poolIterations * poolSize / (poolSize - kSampleSize);
+            poolGrowth += std::max(1.0, std::ceil(next - poolIterations));
+            poolIterations = next;
+        }
+
+        // The newest correspondence of the pool is always sampled, the rest comes from the better ones.
+        // Once the pool contains all correspondences, sampling becomes uniform like in RANSAC.
+        int drawn = 0;
+        int range = count;
+
+        if (poolSize < count || iteration <= poolGrowth)
+        {
+            sample[drawn++] = poolSize - 1;
+            range = poolSize - 1;
+        }
+
+        while (drawn < kSampleSize)
+        {
+            const int index = m_rng.uniform(0, range);
+
+            bool unique = true;
+            for (int k = 0; k < drawn; k++)
+            {
+                unique = unique && sample[k] != index;
+            }
+
+            if (unique)
+                sample[drawn++] = index;
+        }
+
+        cv::Matx33d model;
+        if (!computeModel(sample, model))
+            continue;
+
+        toFloat(model, h);
+
+        // Verify the hypothesis in batches, SPRT stops as soon as the model is likely bad
+        int    inliers   = 0;
+        int    tested    = 0;
+        double logLambda = 0;
+        bool   rejected  = false;
+
+        for (int begin = 0; begin < count; begin += kSprtBatch)
+        {
+            const int end = std::min(count, begin + kSprtBatch);
+            const int batchInliers = countInliers(h, begin, end, threshold2, 0);
+
+            inliers += batchInliers;
+            tested   = end;
+
+            if (enableSPRT)
+            {
+                logLambda += batchInliers * sprt.logInlierStep + (end - begin - batchInliers) * sprt.logOutlierStep;
+                if (logLambda > sprt.logA)
+                {
+                    rejected = true;
+                    break;
+                }
+            }
+        }
+
+        if (rejected)
+        {
+            // Bad models tell how many points are consistent with a random model
+            m_rejectedCount++;
+            sprt.update(sprt.epsilon, 0.95 * sprt.delta + 0.05 * inliers / tested);
+            continue;
+        }
+
+        if (inliers <= bestCount)
+            continue;
+
+        bestCount = inliers;
+        bestModel = model;
+
+        const double inliersRatio = static_cast<double>(bestCount) / count;
+        sprt.update(inliersRatio, sprt.delta);
+
+        // Number of iterations to draw an all-inlier sample with the desired confidence.
+        // SPRT rejects a good model with probability 1/A, which makes good samples less frequent.
+        const double goodSample = (enableSPRT ? 1 - 1 / sprt.A : 1) * std::pow(inliersRatio, kSampleSize);
+
+        if (goodSample >= 1)
+        {
+            maxIterations = iteration;
+        }
+        else if (goodSample > 0)
+        {
+            const double needed = std::ceil(std::log(1 - m_confidence) / std::log(1 - goodSample));
+            if (needed < maxIterations)
+                maxIterations = std::max(iteration, static_cast<int>(needed));
+        }
+    }
+
+    if (bestCount < kSampleSize)
+        return false;
+
+    toFloat(bestModel, h);
+    countInliers(h, 0, count, threshold2, &m_scoreMask[0]);
+
+    // Refine the model with least squares over all its inliers
+    m_inlierSrc.clear();
+    m_inlierDst.clear();
+
+    for (int i = 0; i < count; i++)
+    {
+        if (m_scoreMask[i])
+        {
+            m_inlierSrc.push_back(cv::Point2f(m_srcX[i], m_srcY[i]));
+            m_inlierDst.push_back(cv::Point2f(m_dstX[i], m_dstY[i]));
+        }
+    }
+
+    cv::Matx33d refinedModel;
+    if (m_inlierSrc.size() > static_cast<size_t>(kSampleSize) && fitModel(refinedModel))
+    {
+        toFloat(refinedModel, h);
+        const int refinedCount = countInliers(h, 0, count, threshold2, 0);
+
+        // Keep the refined model only if it's not worse
+        if (refinedCount >= bestCount)
+        {
+            bestModel = refinedModel;
+            countInliers(h, 0, count, threshold2, &m_scoreMask[0]);
+        }
+    }
+
+    // Inliers mask in the order of the input correspondences
+    for (int i = 0; i < count; i++)
+    {
+        m_inliersMask[m_order[m_permutation[i]]] = m_scoreMask[i];
+    }
+
+    cv::Mat(bestModel, false).copyTo(homography);
+    return true;
+}
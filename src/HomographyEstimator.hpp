@@ -0,0 +1,111 @@
+#ifndef EXAMPLE_MARKERLESS_AR_HOMOGRAPHYESTIMATOR_HPP
+#define EXAMPLE_MARKERLESS_AR_HOMOGRAPHYESTIMATOR_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Robust homography estimator replacing cv::findHomography(..., CV_FM_RANSAC, ...).
+ * - Minimal samples are drawn in PROSAC order: the best ranked correspondences (smallest match distance) are
+ *   tried first and the sampling pool grows progressively, so good models are found in few iterations.
+ * - Each hypothesis is verified with the sequential probability ratio test (SPRT): the verification stops
+ *   as soon as the model is very likely to be bad, so bad hypotheses cost only a fraction of a full pass.
+ * - Correspondences are stored as arrays of floats and scored several points at a time with SIMD.
+ * - All buffers are owned by the estimator and reused between the calls.
+ * The best model is finally refined with least squares over its inliers.
+ * An instance is not thread-safe, use one estimator per thread.
+ */
+class HomographyEstimator
+{
+public:
+    /**
+    * @confidence    - desired probability that the found model is correct
+    * @maxIterations - maximal number of generated hypotheses
+    */
+    HomographyEstimator(double confidence = 0.995, int maxIterations = 2000);
+
+    /**
+    * Estimate the homography mapping train keypoints to query keypoints of @matches.
+    * Matches with smaller distance are considered more reliable and are sampled first.
+    */
+    bool estimate(const std::vector<cv::KeyPoint>& queryKeypoints,
+        const std::vector<cv::KeyPoint>& trainKeypoints,
+        const std::vector<cv::DMatch>& matches,
+        float reprojectionThreshold,
+        cv::Mat& homography);
+
+    /**
+    * Estimate the homography mapping @srcPoints to @dstPoints. Points are sampled in the given order.
+    */
+    bool estimate(const std::vector<cv::Point2f>& srcPoints,
+        const std::vector<cv::Point2f>& dstPoints,
+        float reprojectionThreshold,
+        cv::Mat& homography);
+
+    /**
+    * Inliers mask of the last estimation (in the order of the input correspondences).
+    */
+    const std::vector<unsigned char>& getInliersMask() const;
+
+    /**
+    * Number of hypotheses generated in the last estimation.
+    */
+    int getIterationsCount() const;
+
+    /**
+    * Number of hypotheses rejected early by SPRT in the last estimation.
+    */
+    int getRejectedCount() const;
+
+    /**
+    * Enables the early rejection of bad hypotheses. Without it every hypothesis is verified on all points.
+    */
+    bool enableSPRT;
+
+private:
+    bool run(float reprojectionThreshold, cv::Mat& homography);
+
+    bool computeModel(const int* sample, cv::Matx33d& model) const;
+
+    int countInliers(const float* model, int begin, int end, float threshold2, unsigned char* mask) const;
+
+    /**
+    * Least squares homography over m_inlierSrc/m_inlierDst (normalized DLT), computed on fixed size matrices.
+    */
+    bool fitModel(cv::Matx33d& model);
+
+    double m_confidence;
+    int    m_maxIterations;
+
+    cv::RNG m_rng;
+    int     m_iterationsCount;
+    int     m_rejectedCount;
+
+    // Correspondences in the sampling order (best first) and their original indices
+    std::vector< std::pair<float, int> > m_ranks;
+    std::vector<int>         m_order;
+    std::vector<cv::Point2f> m_srcPoints;
+    std::vector<cv::Point2f> m_dstPoints;
+    std::vector<cv::Point2d> m_srcNormalized;
+    std::vector<cv::Point2d> m_dstNormalized;
+    cv::Matx33d              m_srcNormalization;
+    cv::Matx33d              m_dstDenormalization;
+
+    // Correspondences for scoring in random order, structure of arrays layout
+    std::vector<int>         m_permutation;
+    std::vector<float>       m_srcX;
+    std::vector<float>       m_srcY;
+    std::vector<float>       m_dstX;
+    std::vector<float>       m_dstY;
+    std::vector<unsigned char> m_scoreMask;
+
+    std::vector<cv::Point2f> m_inlierSrc;
+    std::vector<cv::Point2f> m_inlierDst;
+    std::vector<cv::Point2d> m_inlierSrcNormalized;
+    std::vector<cv::Point2d> m_inlierDstNormalized;
+    std::vector<unsigned char> m_inliersMask;
+};
+
+#endif
@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "LatencyStats.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+
+namespace
+{
+    /**
+     * Smallest sample such that at least @percent of the sorted @samples are not greater than it.
+     */
+    double getPercentile(const std::vector<double>& samples, size_t percent)
+    {
+        const size_t rank = (samples.size() * percent + 99) / 100;
+        return samples[std::max<size_t>(1, rank) - 1];
+    }
+}
+
+LatencyStats::LatencyStats()
+    : mean(0)
+    , p50(0)
+    , p95(0)
+    , p99(0)
+{
+}
+
+LatencyStats LatencyStats::compute(std::vector<double> samples)
+{
+    LatencyStats stats;
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+        sum += samples[i];
+
+    stats.mean = sum / samples.size();
+    stats.p50  = getPercentile(samples, 50);
+    stats.p95  = getPercentile(samples, 95);
+    stats.p99  = getPercentile(samples, 99);
+    return stats;
+}
@@ -0,0 +1,26 @@
+#ifndef EXAMPLE_MARKERLESS_AR_LATENCYSTATS_HPP
+#define EXAMPLE_MARKERLESS_AR_LATENCYSTATS_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <vector>
+
+/**
+ * Mean and nearest-rank percentiles of latency samples, in the units of the samples.
+ */
+struct LatencyStats
+{
+    LatencyStats();
+
+    /**
+    * Statistics of the @samples, all values are zero if there are no samples.
+    */
+    static LatencyStats compute(std::vector<double> samples);
+
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+};
+
+#endif
@@ -0,0 +1,358 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "LshMatcher.hpp"
+#include "HammingDistance.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+#include <climits>
+
+LshMatcher::LshMatcher(int tablesCount, int keyBits, int probeLevel, bool crossCheck)
+    : HammingMatcher(crossCheck)
+    , m_tablesCount(tablesCount)
+    , m_keyBits(keyBits)
+    , m_probeLevel(probeLevel)
+    , m_currentStamp(0)
+    , m_averageCandidates(0)
+{
+    CV_Assert(tablesCount > 0);
+    CV_Assert(keyBits > 0 && keyBits <= 24);
+    CV_Assert(probeLevel >= 0 && probeLevel <= 2);
+
+    buildProbeMasks();
+}
+
+cv::Ptr<cv::DescriptorMatcher> LshMatcher::clone(bool emptyTrainData) const
+{
+    LshMatcher* matcher = new LshMatcher(m_tablesCount, m_keyBits, m_probeLevel, m_crossCheck);
+
+    // Train data and hash tables are never modified, so it's safe to share them
+    if (!emptyTrainData)
+    {
+        shareTrainData(*matcher);
+        matcher->m_tables = m_tables;
+    }
+
+    return matcher;
+}
+
+void LshMatcher::setTablesCount(int tablesCount)
+{
+    CV_Assert(tablesCount > 0);
+
+    if (tablesCount != m_tablesCount)
+    {
+        m_tablesCount = tablesCount;
+        m_isTrained = false;
+    }
+}
+
+int LshMatcher::getTablesCount() const
+{
+    return m_tablesCount;
+}
+
+void LshMatcher::setProbeLevel(int probeLevel)
+{
+    CV_Assert(probeLevel >= 0 && probeLevel <= 2);
+
+    m_probeLevel = probeLevel;
+    buildProbeMasks();
+}
+
+int LshMatcher::getProbeLevel() const
+{
+    return m_probeLevel;
+}
+
+float LshMatcher::getAverageCandidates() const
+{
+    return m_averageCandidates;
+}
+
+void LshMatcher::buildProbeMasks()
+{
+    // Exact bucket goes first, then buckets with one and two flipped key bits
+    m_probeMasks.assign(1, 0u);
+
+    if (m_probeLevel >= 1)
+    {
+        for (int a = 0; a < m_keyBits; a++)
+            m_probeMasks.push_back(1u << a);
+    }
+
+    if (m_probeLevel >= 2)
+    {
+        for (int a = 0; a < m_keyBits; a++)
+            for (int b = a + 1; b < m_keyBits; b++)
+                m_probeMasks.push_back((1u << a) | (1u << b));
+    }
+}
+
+void LshMatcher::train()
+{
+    if (m_isTrained)
+        return;
+
+    HammingMatcher::train();
+    buildTables();
+}
+
+unsigned int LshMatcher::computeKey(const unsigned char* descriptor, int table) const
+{
+    const int* bits = &m_tables->sampledBits[table * m_keyBits];
+    unsigned int key = 0;
+
+    for (int j = 0; j < m_keyBits; j++)
+    {
+        key |= ((descriptor[bits[j] >> 3] >> (bits[j] & 7)) & 1u) << j;
+    }
+
+    return key;
+}
+
+void LshMatcher::buildTables()
+{
+    if (m_trainCount == 0)
+    {
+        m_tables.release();
+        return;
+    }
+
+    // Tables of the previous training may be shared with clones, so new ones are built in a new object
+    m_tables = new Tables();
+    Tables& tables = *m_tables;
+
+    const int descriptorBits = m_descriptorLength * 8;
+    CV_Assert(m_keyBits <= descriptorBits);
+
+    // Each table samples its own random subset of bits (fixed seed keeps the tables reproducible)
+    cv::RNG rng(0x4c5348);
+    std::vector<int> permutation(descriptorBits);
+    tables.sampledBits.resize(m_tablesCount * m_keyBits);
+
+    for (int t = 0; t < m_tablesCount; t++)
+    {
+        for (int b = 0; b < descriptorBits; b++)
+            permutation[b] = b;
+
+        // Partial Fisher-Yates shuffle
+        for (int j = 0; j < m_keyBits; j++)
+        {
+            int k = j + rng.uniform(0, descriptorBits - j);
+            std::swap(permutation[j], permutation[k]);
+            tables.sampledBits[t * m_keyBits + j] = permutation[j];
+        }
+    }
+
+    // Fill buckets in compressed form: items of bucket b are bucketItems[starts[b] .. starts[b+1])
+    const int bucketsCount = 1 << m_keyBits;
+    std::vector<unsigned int> keys(m_trainCount);
+    std::vector<int> cursor;
+
+    tables.bucketStarts.resize(m_tablesCount);
+    tables.bucketItems.resize(m_tablesCount);
+
+    for (int t = 0; t < m_tablesCount; t++)
+    {
+        std::vector<int>& starts = tables.bucketStarts[t];
+        std::vector<int>& items  = tables.bucketItems[t];
+
+        starts.assign(bucketsCount + 1, 0);
+        for (int r = 0; r < m_trainCount; r++)
+        {
+            keys[r] = computeKey(m_trainData + r * m_stride, t);
+            starts[keys[r] + 1]++;
+        }
+
+        for (int b = 0; b < bucketsCount; b++)
+            starts[b + 1] += starts[b];
+
+        cursor.assign(starts.begin(), starts.end() - 1);
+        items.resize(m_trainCount);
+        for (int r = 0; r < m_trainCount; r++)
+            items[cursor[keys[r]]++] = r;
+    }
+
+    // Candidates are filtered by image in matchImages
+    tables.rowImages.resize(m_trainCount);
+    for (size_t img = 0; img + 1 < m_imageOffsets.size(); img++)
+        std::fill(tables.rowImages.begin() + m_imageOffsets[img], tables.rowImages.begin() + m_imageOffsets[img + 1], static_cast<int>(img));
+}
+
+void LshMatcher::matchFused(const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches, float maxRatio)
+{
+    matches.clear();
+    train();
+
+    if (queryDescriptors.empty() || m_trainCount == 0)
+        return;
+
+    const unsigned char* query = packQuery(queryDescriptors);
+    const int queryCount = queryDescriptors.rows;
+
+    m_bestDistance.assign(queryCount, INT_MAX);
+    m_bestIndex.assign(queryCount, -1);
+    m_secondDistance.assign(queryCount, INT_MAX);
+    m_trainBestDistance.assign(m_trainCount, INT_MAX);
+    m_trainBestIndex.assign(m_trainCount, -1);
+
+    searchBuckets(query, queryCount, false);
+
+    collectMatches(queryCount, maxRatio, matches);
+}
+
+void LshMatcher::matchImages(const cv::Mat& queryDescriptors, const std::vector<int>& imageIndices, std::vector<cv::DMatch>& matches, float maxRatio)
+{
+    matches.clear();
+    train();
+
+    if (queryDescriptors.empty() || m_trainCount == 0)
+        return;
+
+    const int subsetCount = prepareSubset(imageIndices);
+    if (subsetCount == 0)
+        return;
+
+    // Only the entries of the subset are set and they are reset afterwards, so the cost doesn't depend on the images count
+    if (m_subsetPositions.size() != trainDescCollection.size())
+        m_subsetPositions.assign(trainDescCollection.size(), -1);
+
+    for (size_t i = 0; i < imageIndices.size(); i++)
+        m_subsetPositions[imageIndices[i]] = static_cast<int>(i);
+
+    const unsigned char* query = packQuery(queryDescriptors);
+    const int queryCount = queryDescriptors.rows;
+
+    m_bestDistance.assign(queryCount, INT_MAX);
+    m_bestIndex.assign(queryCount, -1);
+    m_secondDistance.assign(queryCount, INT_MAX);
+    m_trainBestDistance.assign(subsetCount, INT_MAX);
+    m_trainBestIndex.assign(subsetCount, -1);
+
+    searchBuckets(query, queryCount, true);
+
+    for (size_t i = 0; i < imageIndices.size(); i++)
+        m_subsetPositions[imageIndices[i]] = -1;
+
+    collectMatches(queryCount, maxRatio, m_subsetOffsets, matches);
+}
+
+void LshMatcher::searchBuckets(const unsigned char* query, int queryCount, bool subsetOnly)
+{
+    // Stamps mark train rows already compared with the current query
+    if (static_cast<int>(m_visitedStamp.size()) != m_trainCount)
+    {
+        m_visitedStamp.assign(m_trainCount, 0);
+        m_currentStamp = 0;
+    }
+
+    size_t distanceComputations = 0;
+
+    for (int q = 0; q < queryCount; q++)
+    {
+        const unsigned char* queryRow = query + q * m_stride;
+
+        if (++m_currentStamp == INT_MAX)
+        {
+            std::fill(m_visitedStamp.begin(), m_visitedStamp.end(), 0);
+            m_currentStamp = 1;
+        }
+
+        int best   = INT_MAX;
+        int bestI  = -1;
+        int second = INT_MAX;
+
+        for (int table = 0; table < m_tablesCount; table++)
+        {
+            const unsigned int key = computeKey(queryRow, table);
+            const std::vector<int>& starts = m_tables->bucketStarts[table];
+            const std::vector<int>& items  = m_tables->bucketItems[table];
+
+            for (size_t p = 0; p < m_probeMasks.size(); p++)
+            {
+                const unsigned int bucket = key ^ m_probeMasks[p];
+
+                for (int i = starts[bucket]; i < starts[bucket + 1]; i++)
+                {
+                    const int t = items[i];
+                    if (m_visitedStamp[t] == m_currentStamp)
+                        continue;
+
+                    m_visitedStamp[t] = m_currentStamp;
+
+                    // Rows of the subset are numbered within it, other rows are skipped
+                    int row = t;
+                    if (subsetOnly)
+                    {
+                        const int image    = m_tables->rowImages[t];
+                        const int position = m_subsetPositions[image];
+                        if (position < 0)
+                            continue;
+
+                        row = m_subsetOffsets[position] + t - m_imageOffsets[image];
+                    }
+
+                    distanceComputations++;
+
+                    const int d = hamming::distancePadded(queryRow, m_trainData + t * m_stride, m_stride);
+
+                    if (d < best)
+                    {
+                        second = best;
+                        best   = d;
+                        bestI  = row;
+                    }
+                    else if (d < second)
+                    {
+                        second = d;
+                    }
+
+                    if (d < m_trainBestDistance[row])
+                    {
+                        m_trainBestDistance[row] = d;
+                        m_trainBestIndex[row]    = q;
+                    }
+                }
+            }
+        }
+
+        m_bestDistance[q]   = best;
+        m_bestIndex[q]      = bestI;
+        m_secondDistance[q] = second;
+    }
+
+    m_averageCandidates = static_cast<float>(distanceComputations) / queryCount;
+}
+
+float LshMatcher::measureRecall(const cv::Mat& queryDescriptors, float maxRatio)
+{
+    matchFused(queryDescriptors, m_approximateMatches, maxRatio);
+    HammingMatcher::matchFused(queryDescriptors, m_exactMatches, maxRatio);
+
+    if (m_exactMatches.empty())
+        return 1.f;
+
+    // Both lists are ordered by the query index
+    size_t found = 0;
+    size_t j = 0;
+
+    for (size_t i = 0; i < m_exactMatches.size(); i++)
+    {
+        const cv::DMatch& exact = m_exactMatches[i];
+
+        while (j < m_approximateMatches.size() && m_approximateMatches[j].queryIdx < exact.queryIdx)
+            j++;
+
+        if (j < m_approximateMatches.size() &&
+            m_approximateMatches[j].queryIdx == exact.queryIdx &&
+            m_approximateMatches[j].imgIdx   == exact.imgIdx &&
+            m_approximateMatches[j].trainIdx == exact.trainIdx)
+        {
+            found++;
+        }
+    }
+
+    return static_cast<float>(found) / m_exactMatches.size();
+}
@@ -0,0 +1,103 @@
+#ifndef EXAMPLE_MARKERLESS_AR_LSHMATCHER_HPP
+#define EXAMPLE_MARKERLESS_AR_LSHMATCHER_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "HammingMatcher.hpp"
+
+/**
+ * Approximate matcher for binary descriptors based on bit sampling locality sensitive hashing.
+ * Each hash table uses a random subset of descriptor bits as the bucket key. A query is compared
+ * only with train descriptors falling into its buckets (and the neighbouring buckets within
+ * @probeLevel flipped key bits), so the amount of work is controlled by the number of tables and
+ * the probe level: more tables and probes - higher recall, less tables and probes - faster matching.
+ * Exact distances of the candidates are computed with the same kernel as HammingMatcher.
+ */
+class LshMatcher : public HammingMatcher
+{
+public:
+    /**
+    * @tablesCount - number of hash tables
+    * @keyBits     - number of sampled bits in the key of each table (at most 24)
+    * @probeLevel  - number of flipped key bits for multi-probe lookup (0, 1 or 2)
+    * @crossCheck  - keep only mutual nearest neighbours among the evaluated candidates
+    */
+    LshMatcher(int tablesCount = 6, int keyBits = 16, int probeLevel = 1, bool crossCheck = true);
+
+    virtual void train();
+    virtual cv::Ptr<cv::DescriptorMatcher> clone(bool emptyTrainData = false) const;
+
+    /**
+    * Approximate nearest neighbour search with the same semantic as HammingMatcher::matchFused.
+    */
+    virtual void matchFused(const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches, float maxRatio = 1.f);
+
+    /**
+    * Approximate search with the same semantic as HammingMatcher::matchImages. Candidates from the probed buckets
+    * that belong to the images outside of @imageIndices are skipped without computing their distance.
+    */
+    virtual void matchImages(const cv::Mat& queryDescriptors, const std::vector<int>& imageIndices, std::vector<cv::DMatch>& matches, float maxRatio = 1.f);
+
+    /**
+    * Change the number of hash tables (tables are rebuilt on next train).
+    */
+    void setTablesCount(int tablesCount);
+    int  getTablesCount() const;
+
+    /**
+    * Change the multi-probe level (takes effect immediately).
+    */
+    void setProbeLevel(int probeLevel);
+    int  getProbeLevel() const;
+
+    /**
+    * Match the query with both approximate and exhaustive search and return the fraction
+    * of exhaustive search matches that were found by the approximate one.
+    */
+    float measureRecall(const cv::Mat& queryDescriptors, float maxRatio = 1.f);
+
+    /**
+    * Average number of distance computations per query descriptor in the last matchFused or matchImages call.
+    */
+    float getAverageCandidates() const;
+
+private:
+    void buildTables();
+    void buildProbeMasks();
+    unsigned int computeKey(const unsigned char* descriptor, int table) const;
+
+    /**
+    * Compare @queryCount packed queries with the train rows of their buckets and store the best distances.
+    * With @subsetOnly only rows of the matchImages subset are compared and they are numbered within the subset.
+    */
+    void searchBuckets(const unsigned char* query, int queryCount, bool subsetOnly);
+
+    int                        m_tablesCount;
+    int                        m_keyBits;
+    int                        m_probeLevel;
+
+    /**
+    * Hash tables are built by train() into a new object and never modified afterwards, so clones share them.
+    */
+    struct Tables
+    {
+        std::vector<int>                sampledBits;   // keyBits bit positions for each table
+        std::vector< std::vector<int> > bucketStarts;  // CSR buckets: start of each bucket in bucketItems
+        std::vector< std::vector<int> > bucketItems;   // Global train rows sorted by bucket
+        std::vector<int>                rowImages;     // Train image of each global row
+    };
+
+    cv::Ptr<Tables>            m_tables;
+    std::vector<unsigned int>  m_probeMasks;      // Key masks to XOR with for multi-probe lookup
+
+    std::vector<int>           m_subsetPositions; // Position of each train image in the matchImages subset or -1
+
+    std::vector<int>           m_visitedStamp;
+    int                        m_currentStamp;
+    float                      m_averageCandidates;
+
+    std::vector<cv::DMatch>    m_exactMatches;
+    std::vector<cv::DMatch>    m_approximateMatches;
+};
+
+#endif
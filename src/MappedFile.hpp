@@ -0,0 +1,44 @@
+#ifndef EXAMPLE_MARKERLESS_AR_MAPPEDFILE_HPP
+#define EXAMPLE_MARKERLESS_AR_MAPPEDFILE_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <string>
+#include <cstddef>
+
+/**
+ * Read-only view of a file mapped into memory.
+ * The mapping is private (copy-on-write), so matrices wrapping the mapped data can be safely
+ * written to without touching the file. Pages are loaded by the OS on first access.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+    * Map the whole file. Returns false if the file can't be opened or is empty.
+    */
+    bool open(const std::string& path);
+
+    void close();
+
+    unsigned char* data() const;
+    size_t size() const;
+
+private:
+    // Mapping can't be shared by copying, use cv::Ptr<MappedFile> instead
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    unsigned char* m_data;
+    size_t         m_size;
+
+#ifdef _WIN32
+    void*          m_file;
+    void*          m_mapping;
+#endif
+};
+
+#endif
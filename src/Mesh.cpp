@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "Mesh.hpp"
+#include "SceneGeometry.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cmath>
+
+namespace
+{
+    /**
+     * Cube vertices with the normal of their face (4 vertices per face).
+     */
+    void setCubeVertices(Mesh& mesh)
+    {
+        for (int face = 0; face < SceneGeometry::cubeFacesCount; face++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const float* vertex = SceneGeometry::cubeVertices[face * 4 + i];
+                const float* normal = SceneGeometry::cubeNormals[face];
+
+                mesh.positions.insert(mesh.positions.end(), vertex, vertex + 3);
+                mesh.normals.insert(mesh.normals.end(), normal, normal + 3);
+            }
+        }
+    }
+}
+
+Mesh::Mesh()
+    : primitive(Triangles)
+{
+}
+
+size_t Mesh::getVerticesCount() const
+{
+    return positions.size() / 3;
+}
+
+void Mesh::computeNormals()
+{
+    normals.assign(positions.size(), 0.f);
+
+    if (primitive != Triangles)
+        return;
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        const float* a = &positions[indices[t] * 3];
+        const float* b = &positions[indices[t + 1] * 3];
+        const float* c = &positions[indices[t + 2] * 3];
+
+        const float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+        // Length of the cross product is twice the triangle area, so larger faces weigh more
+        const float n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+
+        for (int k = 0; k < 3; k++)
+        {
+            float* normal = &normals[indices[t + k] * 3];
+            normal[0] += n[0];
+            normal[1] += n[1];
+            normal[2] += n[2];
+        }
+    }
+
+    for (size_t i = 0; i < normals.size(); i += 3)
+    {
+        float* normal = &normals[i];
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        if (length > 0)
+        {
+            normal[0] /= length;
+            normal[1] /= length;
+            normal[2] /= length;
+        }
+    }
+}
+
+Mesh Mesh::createCoordinateAxis()
+{
+    Mesh mesh;
+    mesh.primitive = Lines;
+
+    for (int i = 0; i < SceneGeometry::axisLinesCount; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            const float* vertex = SceneGeometry::axisVertices[2 * i + j];
+            const float* color  = SceneGeometry::axisColors[i];
+
+            mesh.positions.insert(mesh.positions.end(), vertex, vertex + 3);
+            mesh.colors.insert(mesh.colors.end(), color, color + 3);
+            mesh.indices.push_back(2 * i + j);
+        }
+    }
+
+    return mesh;
+}
+
+Mesh Mesh::createCubeFaces()
+{
+    Mesh mesh;
+    mesh.primitive = Triangles;
+    setCubeVertices(mesh);
+
+    for (unsigned int face = 0; face < SceneGeometry::cubeFacesCount; face++)
+    {
+        const unsigned int first = face * 4;
+        const unsigned int quad[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+        mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+    }
+
+    return mesh;
+}
+
+Mesh Mesh::createCubeEdges()
+{
+    Mesh mesh;
+    mesh.primitive = Lines;
+    setCubeVertices(mesh);
+
+    for (unsigned int face = 0; face < SceneGeometry::cubeFacesCount; face++)
+    {
+        const unsigned int first = face * 4;
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            mesh.indices.push_back(first + i);
+            mesh.indices.push_back(first + (i + 1) % 4);
+        }
+    }
+
+    return mesh;
+}
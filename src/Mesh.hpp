@@ -0,0 +1,46 @@
+#ifndef EXAMPLE_MARKERLESS_AR_MESH_HPP
+#define EXAMPLE_MARKERLESS_AR_MESH_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cstddef>
+#include <vector>
+
+/**
+ * Geometry of a model in the model coordinates: indexed lines or triangles with optional per-vertex normals
+ * and colors. Attributes are stored in separate arrays, three floats per vertex each.
+ */
+struct Mesh
+{
+    enum Primitive
+    {
+        Lines,
+        Triangles
+    };
+
+    Mesh();
+
+    size_t getVerticesCount() const;
+
+    /**
+    * Compute smooth per-vertex normals of the triangles (area weighted face normals).
+    */
+    void computeNormals();
+
+    /**
+    * Models of SceneGeometry: the coordinate axis (colored lines), the cube faces (triangles) and the cube edges
+    * (outline of each face, so edges are drawn once per face as with the polygon mode of the faces).
+    * The cube is in its own coordinates, see SceneGeometry::cubeOffset and cubeScale.
+    */
+    static Mesh createCoordinateAxis();
+    static Mesh createCubeFaces();
+    static Mesh createCubeEdges();
+
+    Primitive                 primitive;
+    std::vector<float>        positions;  // x, y, z of each vertex
+    std::vector<float>        normals;    // x, y, z of each vertex, empty if the mesh is not lit
+    std::vector<float>        colors;     // r, g, b of each vertex, empty if the color of the model is used
+    std::vector<unsigned int> indices;    // Two per line or three per triangle
+};
+
+#endif
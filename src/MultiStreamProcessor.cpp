@@ -0,0 +1,351 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "MultiStreamProcessor.hpp"
+#include "SpscQueue.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <chrono>
+
+namespace
+{
+    // Frames of a stream: one being processed, one being captured and the queued ones
+    const size_t kFramesPerStream = 4;
+
+    // Number of recent frames the latency percentiles are computed over
+    const size_t kLatencySamples = 1024;
+
+    inline void waitForInput()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * State of one stream. The stream is the task it submits to the pool, so scheduling never allocates.
+ */
+class MultiStreamProcessor::Stream : public WorkStealingPool::Task
+{
+public:
+    Stream(MultiStreamProcessor& owner, size_t index, cv::Ptr<cv::VideoCapture> capture)
+        : pipeline(owner.m_model, owner.m_calibration)
+        , m_owner(owner)
+        , m_index(index)
+        , m_capture(capture)
+        , m_frames(kFramesPerStream)
+        , m_captured(kFramesPerStream)
+        , m_recycled(kFramesPerStream)
+        , m_scheduled(false)
+        , m_stopCapture(false)
+        , m_captureFinished(false)
+        , m_capturedCount(0)
+        , m_processedCount(0)
+        , m_foundCount(0)
+        , m_droppedCount(0)
+        , m_lateCount(0)
+        , m_nextLatency(0)
+    {
+    }
+
+    void start()
+    {
+        m_stopCapture     = false;
+        m_captureFinished = false;
+        m_captureThread   = std::thread(&Stream::captureLoop, this);
+    }
+
+    void stopCapture()
+    {
+        m_stopCapture = true;
+
+        if (m_captureThread.joinable())
+            m_captureThread.join();
+    }
+
+    /**
+    * No frames left and no job in flight.
+    */
+    bool isFinished() const
+    {
+        return m_captureFinished && m_captured.empty() && !m_scheduled;
+    }
+
+    bool isIdle() const
+    {
+        return !m_scheduled;
+    }
+
+    /**
+    * Process one frame on a worker thread.
+    */
+    virtual void run()
+    {
+        if (!m_owner.m_stop)
+            processFrame();
+
+        // Any frame captured after this point schedules the stream again
+        m_scheduled = false;
+
+        if (!m_owner.m_stop && !m_captured.empty())
+            schedule();
+    }
+
+    StreamStats getStats() const
+    {
+        StreamStats stats;
+        stats.capturedCount  = m_capturedCount;
+        stats.processedCount = m_processedCount;
+        stats.foundCount     = m_foundCount;
+        stats.droppedCount   = m_droppedCount;
+        stats.lateCount      = m_lateCount;
+
+        std::vector<double> latencies;
+        {
+            std::lock_guard<std::mutex> lock(m_latencyMutex);
+            latencies = m_latencies;
+        }
+
+        stats.latency = LatencyStats::compute(latencies);
+        return stats;
+    }
+
+    ARPipeline pipeline;
+
+private:
+    struct Frame
+    {
+        cv::Mat image;
+        double  timestamp;
+        size_t  index;
+    };
+
+    void schedule()
+    {
+        if (!m_scheduled.exchange(true))
+            m_owner.m_pool.submit(this);
+    }
+
+    void captureLoop()
+    {
+        // Capture thread owns all frames that are not in flight
+        std::vector<Frame*> freeFrames;
+        for (size_t i = 0; i < m_frames.size(); i++)
+            freeFrames.push_back(&m_frames[i]);
+
+        size_t frameIndex = 0;
+
+        while (!m_stopCapture)
+        {
+            Frame* frame = 0;
+            while (m_recycled.tryPop(frame))
+                freeFrames.push_back(frame);
+
+            // All frames are queued or processed, wait for the worker
+            if (freeFrames.empty())
+            {
+                waitForInput();
+                continue;
+            }
+
+            frame = freeFrames.back();
+            freeFrames.pop_back();
+
+            if (!m_capture->read(frame->image) || frame->image.empty())
+                break;
+
+            frame->timestamp = PoseFilter::now();
+            frame->index     = frameIndex++;
+            m_capturedCount++;
+
+            m_captured.tryPush(frame);
+            schedule();
+        }
+
+        m_captureFinished = true;
+    }
+
+    /**
+    * Take the frame to process: the oldest one in the lossless mode, otherwise the newest one if it's not too old.
+    */
+    Frame* takeFrame()
+    {
+        Frame* frame = 0;
+
+        if (m_owner.lossless)
+        {
+            m_captured.tryPop(frame);
+            return frame;
+        }
+
+        Frame* newer = 0;
+        while (m_captured.tryPop(newer))
+        {
+            if (frame)
+            {
+                m_recycled.tryPush(frame);
+                m_droppedCount++;
+            }
+
+            frame = newer;
+        }
+
+        if (frame && m_owner.maxLatency > 0 && PoseFilter::now() - frame->timestamp > m_owner.maxLatency)
+        {
+            m_recycled.tryPush(frame);
+            m_lateCount++;
+            return 0;
+        }
+
+        return frame;
+    }
+
+    void processFrame()
+    {
+        Frame* frame = takeFrame();
+        if (!frame)
+            return;
+
+        StreamResult result;
+        result.streamIndex  = m_index;
+        result.frameIndex   = frame->index;
+        result.timestamp    = frame->timestamp;
+        result.patternFound = pipeline.processFrame(frame->image, frame->timestamp);
+        result.pose         = pipeline.getPatternLocation();
+        result.latency      = PoseFilter::now() - frame->timestamp;
+
+        // The image is no longer needed
+        m_recycled.tryPush(frame);
+
+        m_processedCount++;
+        m_foundCount += result.patternFound;
+
+        {
+            std::lock_guard<std::mutex> lock(m_latencyMutex);
+
+            if (m_latencies.size() < kLatencySamples)
+                m_latencies.push_back(result.latency);
+            else
+                m_latencies[m_nextLatency] = result.latency;
+
+            m_nextLatency = (m_nextLatency + 1) % kLatencySamples;
+        }
+
+        if (m_owner.m_resultCallback)
+            m_owner.m_resultCallback(result, m_owner.m_resultUserData);
+    }
+
+    MultiStreamProcessor&     m_owner;
+    size_t                    m_index;
+    cv::Ptr<cv::VideoCapture> m_capture;
+    std::thread               m_captureThread;
+
+    std::vector<Frame>        m_frames;
+    SpscQueue<Frame*>         m_captured;     // Capture -> worker
+    SpscQueue<Frame*>         m_recycled;     // Worker -> capture
+
+    // Only one job of the stream is in flight, so the worker side of the queues has one consumer at a time
+    std::atomic<bool>         m_scheduled;
+    std::atomic<bool>         m_stopCapture;
+    std::atomic<bool>         m_captureFinished;
+
+    std::atomic<size_t>       m_capturedCount;
+    std::atomic<size_t>       m_processedCount;
+    std::atomic<size_t>       m_foundCount;
+    std::atomic<size_t>       m_droppedCount;
+    std::atomic<size_t>       m_lateCount;
+
+    mutable std::mutex        m_latencyMutex;
+    std::vector<double>       m_latencies;
+    size_t                    m_nextLatency;
+};
+
+MultiStreamProcessor::MultiStreamProcessor(const Pattern& pattern, const CameraCalibration& calibration, size_t threadsCount)
+    : maxLatency(0.2)
+    , lossless(false)
+    , m_calibration(calibration)
+    , m_pool(threadsCount)
+    , m_resultCallback(0)
+    , m_resultUserData(0)
+    , m_stop(false)
+{
+    // Streams share the model, so the pattern is trained once
+    PatternDetector detector;
+    detector.train(pattern);
+    m_model = detector.getModel();
+}
+
+MultiStreamProcessor::~MultiStreamProcessor()
+{
+    for (size_t i = 0; i < m_streams.size(); i++)
+        m_streams[i]->stopCapture();
+}
+
+size_t MultiStreamProcessor::addStream(cv::Ptr<cv::VideoCapture> capture)
+{
+    m_streams.push_back(new Stream(*this, m_streams.size(), capture));
+    return m_streams.size() - 1;
+}
+
+void MultiStreamProcessor::setResultCallback(ResultFunction callback, void* userData)
+{
+    m_resultCallback = callback;
+    m_resultUserData = userData;
+}
+
+void MultiStreamProcessor::run()
+{
+    m_stop = false;
+
+    for (size_t i = 0; i < m_streams.size(); i++)
+        m_streams[i]->start();
+
+    // Workers do all the processing, this thread only waits for the streams to end
+    for (;;)
+    {
+        bool finished = true;
+        for (size_t i = 0; i < m_streams.size() && finished; i++)
+            finished = m_streams[i]->isFinished();
+
+        if (finished || m_stop)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    m_stop = true;
+
+    for (size_t i = 0; i < m_streams.size(); i++)
+        m_streams[i]->stopCapture();
+
+    // Jobs in flight finish the current frame and don't schedule new ones
+    for (size_t i = 0; i < m_streams.size(); i++)
+    {
+        while (!m_streams[i]->isIdle())
+            waitForInput();
+    }
+}
+
+void MultiStreamProcessor::stop()
+{
+    m_stop = true;
+}
+
+size_t MultiStreamProcessor::getStreamsCount() const
+{
+    return m_streams.size();
+}
+
+StreamStats MultiStreamProcessor::getStreamStats(size_t streamIndex) const
+{
+    return m_streams[streamIndex]->getStats();
+}
+
+PatternDetector& MultiStreamProcessor::getDetector(size_t streamIndex)
+{
+    return m_streams[streamIndex]->pipeline.m_patternDetector;
+}
+
+size_t MultiStreamProcessor::getThreadsCount() const
+{
+    return m_pool.getThreadsCount();
+}
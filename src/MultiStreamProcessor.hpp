@@ -0,0 +1,107 @@
+#ifndef EXAMPLE_MARKERLESS_AR_MULTISTREAMPROCESSOR_HPP
+#define EXAMPLE_MARKERLESS_AR_MULTISTREAMPROCESSOR_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "ARPipeline.hpp"
+#include "WorkStealingPool.hpp"
+#include "LatencyStats.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Result of one processed frame of a stream.
+ */
+struct StreamResult
+{
+    size_t         streamIndex;
+    size_t         frameIndex;    // Index of the frame in the stream (dropped frames included)
+    double         timestamp;     // Capture time (see PoseFilter::now)
+    double         latency;       // From the capture to the result (seconds), includes waiting for a worker
+    bool           patternFound;
+    Transformation pose;
+};
+
+/**
+ * Counters and latency of a stream. Latency percentiles are computed over the recent frames.
+ */
+struct StreamStats
+{
+    size_t capturedCount;
+    size_t processedCount;
+    size_t foundCount;
+    size_t droppedCount;    // Skipped because a newer frame of the stream was available
+    size_t lateCount;       // Skipped because they were older than maxLatency when a worker took them
+    LatencyStats latency;   // Seconds
+};
+
+/**
+ * Headless processing of many camera streams in one process.
+ * Each stream has its own capture thread and ARPipeline state (a detection context of one shared PatternModel), the detection work of all streams runs on one
+ * shared WorkStealingPool. A stream has at most one frame job in flight (the pipeline state is sequential), so
+ * the jobs of different streams interleave on the workers and every stream gets its turn in FIFO order.
+ * In the real-time mode a job takes the newest captured frame of its stream, older frames and frames that waited
+ * longer than maxLatency are dropped, so a stream falling behind doesn't delay the others. In the lossless mode
+ * every frame is processed in order (e.g. for recorded videos).
+ */
+class MultiStreamProcessor
+{
+public:
+    /**
+    * Called on a worker thread for every processed frame.
+    */
+    typedef void (*ResultFunction)(const StreamResult& result, void* userData);
+
+    /**
+    * @threadsCount - number of workers, 0 - number of hardware threads
+    */
+    MultiStreamProcessor(const Pattern& pattern, const CameraCalibration& calibration, size_t threadsCount = 0);
+    ~MultiStreamProcessor();
+
+    /**
+    * Add a frame source, returns the stream index. Streams are added before run().
+    */
+    size_t addStream(cv::Ptr<cv::VideoCapture> capture);
+
+    void setResultCallback(ResultFunction callback, void* userData);
+
+    /**
+    * Process all streams until they end or stop() is called.
+    */
+    void run();
+
+    /**
+    * Request run() to return, may be called from any thread.
+    */
+    void stop();
+
+    size_t getStreamsCount() const;
+
+    StreamStats getStreamStats(size_t streamIndex) const;
+
+    /**
+    * Settings of the pipeline of the stream, may be changed only while run() is not running.
+    */
+    PatternDetector& getDetector(size_t streamIndex);
+
+    size_t getThreadsCount() const;
+
+    double maxLatency;  // Frames older than this (seconds) are not processed in the real-time mode, 0 - no limit
+    bool   lossless;    // Process every frame in order instead of the newest one
+
+private:
+    class Stream;
+
+    cv::Ptr<const PatternModel> m_model;
+    CameraCalibration           m_calibration;
+    std::vector<cv::Ptr<Stream> > m_streams;
+    WorkStealingPool            m_pool;
+    ResultFunction              m_resultCallback;
+    void*                       m_resultUserData;
+    std::atomic<bool>           m_stop;
+};
+
+#endif
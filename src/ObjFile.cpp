@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "ObjFile.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <utility>
+
+namespace
+{
+    /**
+     * Resolve the 1-based (or negative, relative to the end) OBJ index. Returns -1 if it's out of range.
+     */
+    long resolveIndex(long index, size_t count)
+    {
+        if (index > 0 && static_cast<size_t>(index) <= count)
+            return index - 1;
+
+        if (index < 0 && static_cast<size_t>(-index) <= count)
+            return static_cast<long>(count) + index;
+
+        return -1;
+    }
+
+    /**
+     * Parse up to @count floats following the statement keyword.
+     */
+    void parseFloats(const char* text, float* values, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            char* end = 0;
+            values[i] = static_cast<float>(std::strtod(text, &end));
+            text = end;
+        }
+    }
+}
+
+bool ObjFile::load(const std::string& path, Mesh& mesh)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+        return false;
+
+    std::vector<float> positions;
+    std::vector<float> normals;
+
+    // Mesh vertex of each distinct pair of the position and the normal index
+    std::map<std::pair<long, long>, unsigned int> vertices;
+    std::vector<unsigned int> polygon;
+
+    Mesh result;
+    result.primitive = Mesh::Triangles;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const char* text = line.c_str();
+        while (*text == ' ' || *text == '\t')
+            text++;
+
+        if (text[0] == 'v' && (text[1] == ' ' || text[1] == '\t'))
+        {
+            float position[3] = { 0, 0, 0 };
+            parseFloats(text + 2, position, 3);
+            positions.insert(positions.end(), position, position + 3);
+        }
+        else if (text[0] == 'v' && text[1] == 'n' && (text[2] == ' ' || text[2] == '\t'))
+        {
+            float normal[3] = { 0, 0, 0 };
+            parseFloats(text + 3, normal, 3);
+            normals.insert(normals.end(), normal, normal + 3);
+        }
+        else if (text[0] == 'f' && (text[1] == ' ' || text[1] == '\t'))
+        {
+            polygon.clear();
+            text += 2;
+
+            // Each corner is v, v/vt, v//vn or v/vt/vn
+            for (;;)
+            {
+                char* end = 0;
+                const long positionIndex = std::strtol(text, &end, 10);
+                if (end == text)
+                    break;
+
+                long normalIndex = 0;
+                text = end;
+
+                if (*text == '/')
+                {
+                    std::strtol(++text, &end, 10);
+                    text = end;
+
+                    if (*text == '/')
+                    {
+                        normalIndex = std::strtol(++text, &end, 10);
+                        text = end;
+                    }
+                }
+
+                const long p = resolveIndex(positionIndex, positions.size() / 3);
+                const long n = normalIndex ? resolveIndex(normalIndex, normals.size() / 3) : -1;
+                if (p < 0 || (normalIndex && n < 0))
+                    return false;
+
+                std::map<std::pair<long, long>, unsigned int>::iterator vertex = vertices.find(std::make_pair(p, n));
+                if (vertex == vertices.end())
+                {
+                    const unsigned int index = static_cast<unsigned int>(result.getVerticesCount());
+                    vertex = vertices.insert(std::make_pair(std::make_pair(p, n), index)).first;
+
+                    result.positions.insert(result.positions.end(), &positions[p * 3], &positions[p * 3] + 3);
+
+                    if (n >= 0)
+                        result.normals.insert(result.normals.end(), &normals[n * 3], &normals[n * 3] + 3);
+                    else
+                        result.normals.insert(result.normals.end(), 3, 0.f);
+                }
+
+                polygon.push_back(vertex->second);
+            }
+
+            // Triangle fan of the polygon
+            for (size_t i = 2; i < polygon.size(); i++)
+            {
+                result.indices.push_back(polygon[0]);
+                result.indices.push_back(polygon[i - 1]);
+                result.indices.push_back(polygon[i]);
+            }
+        }
+    }
+
+    if (result.indices.empty())
+        return false;
+
+    if (normals.empty())
+        result.computeNormals();
+
+    mesh = result;
+    return true;
+}
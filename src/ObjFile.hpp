@@ -0,0 +1,28 @@
+#ifndef EXAMPLE_MARKERLESS_AR_OBJFILE_HPP
+#define EXAMPLE_MARKERLESS_AR_OBJFILE_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "Mesh.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <string>
+
+/**
+ * Wavefront OBJ reader for the model meshes.
+ * Only the geometry is read: vertex positions, normals and polygonal faces (triangulated as fans, negative
+ * indices are supported). Texture coordinates, materials, groups and other statements are ignored.
+ * Vertices are shared between faces when they have the same position and normal. If the file has no normals,
+ * smooth normals are computed (see Mesh::computeNormals).
+ */
+class ObjFile
+{
+public:
+    /**
+    * Read the triangle @mesh from the file. Returns false if the file can't be read, has invalid indices or no faces.
+    */
+    static bool load(const std::string& path, Mesh& mesh);
+};
+
+#endif
@@ -0,0 +1,249 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "OffscreenRenderer.hpp"
+#include "SceneGeometry.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+    // Fractional bits of the projected points (subpixel precision of the rasterization)
+    const int kShift = 4;
+
+    // Projected points further than this from the frame (pixels) reject the primitive, so fixed point doesn't overflow
+    const float kMaxCoordinate = 1e5f;
+
+    // Default global ambient light of OpenGL, which ARDrawingContext doesn't change
+    const float kGlobalAmbient = 0.2f;
+
+    // Overlay text layout (pixels), same as in ARDrawingContext
+    const int kOverlayLineHeight = 15;
+    const int kOverlayMargin     = 10;
+
+    /**
+     * Product of the column-major (OpenGL) matrix @m and the point @v.
+     */
+    inline void transform(const Matrix44& m, const float v[4], float result[4])
+    {
+        for (int i = 0; i < 4; i++)
+            result[i] = m.data[i] * v[0] + m.data[4 + i] * v[1] + m.data[8 + i] * v[2] + m.data[12 + i] * v[3];
+    }
+
+    /**
+     * Point of the cube vertex in the pattern coordinates (moved by cubeOffset, then scaled by cubeScale).
+     */
+    inline void getCubePoint(int vertex, float point[4])
+    {
+        for (int i = 0; i < 3; i++)
+            point[i] = (SceneGeometry::cubeVertices[vertex][i] + SceneGeometry::cubeOffset[i]) * SceneGeometry::cubeScale;
+
+        point[3] = 1;
+    }
+}
+
+OffscreenRenderer::OffscreenRenderer(const CameraCalibration& calibration)
+    : m_calibration(calibration)
+{
+}
+
+void OffscreenRenderer::setOverlayText(const std::vector<std::string>& lines)
+{
+    m_overlayText = lines;
+}
+
+void OffscreenRenderer::render(cv::Mat& frame, bool isPatternPresent, const Transformation& pose)
+{
+    CV_Assert(frame.type() == CV_8UC3);
+
+    if (frame.size() != m_frameSize)
+    {
+        SceneGeometry::buildProjectionMatrix(m_calibration, frame.cols, frame.rows, m_projection);
+        m_mask.create(frame.size(), CV_8UC1);
+        m_frameSize = frame.size();
+    }
+
+    if (isPatternPresent)
+    {
+        const Matrix44 modelView = pose.getMat44();
+
+        drawCoordinateAxis(frame, modelView);
+        drawCubeModel(frame, modelView);
+    }
+
+    for (size_t i = 0; i < m_overlayText.size(); i++)
+    {
+        const cv::Point origin(kOverlayMargin, static_cast<int>(i + 1) * kOverlayLineHeight);
+        cv::putText(frame, m_overlayText[i], origin, CV_FONT_HERSHEY_PLAIN, 1, CV_RGB(0,200,0));
+    }
+}
+
+bool OffscreenRenderer::projectPoint(const float eye[4], cv::Point& pixel) const
+{
+    float clip[4];
+    transform(m_projection, eye, clip);
+
+    if (clip[3] <= FLT_EPSILON)
+        return false;
+
+    // Viewport of the frame size, the top row of the frame is at the top of the viewport
+    const float x = (clip[0] / clip[3] + 1) * 0.5f * m_frameSize.width;
+    const float y = (1 - clip[1] / clip[3]) * 0.5f * m_frameSize.height;
+
+    if (std::fabs(x) > kMaxCoordinate || std::fabs(y) > kMaxCoordinate)
+        return false;
+
+    pixel = cv::Point(cvRound(x * (1 << kShift)), cvRound(y * (1 << kShift)));
+    return true;
+}
+
+void OffscreenRenderer::drawCoordinateAxis(cv::Mat& frame, const Matrix44& modelView)
+{
+    const int thickness = cvRound(SceneGeometry::axisLineWidth);
+
+    for (int i = 0; i < SceneGeometry::axisLinesCount; i++)
+    {
+        cv::Point points[2];
+        bool visible = true;
+
+        for (int j = 0; j < 2 && visible; j++)
+        {
+            const float* vertex = SceneGeometry::axisVertices[2 * i + j];
+            const float point[4] = { vertex[0], vertex[1], vertex[2], 1 };
+
+            float eye[4];
+            transform(modelView, point, eye);
+            visible = projectPoint(eye, points[j]);
+        }
+
+        if (!visible)
+            continue;
+
+        // Axis is opaque, so it's drawn directly
+        const float* color = SceneGeometry::axisColors[i];
+        cv::line(frame, points[0], points[1], cv::Scalar(color[2] * 255, color[1] * 255, color[0] * 255), thickness, 8, kShift);
+    }
+}
+
+void OffscreenRenderer::drawCubeModel(cv::Mat& frame, const Matrix44& modelView)
+{
+    // Edges have the line width left by the axis in OpenGL
+    const int thickness = cvRound(SceneGeometry::axisLineWidth);
+    const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+
+    // Light is positioned before the cube is scaled
+    float light[4];
+    transform(modelView, SceneGeometry::lightPosition, light);
+
+    // Filled faces first, then the edges over them, each face blended in order as in OpenGL
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const bool   edges    = pass == 1;
+        const float* material = edges ? SceneGeometry::cubeEdgeColor : SceneGeometry::cubeFillColor;
+
+        for (int face = 0; face < SceneGeometry::cubeFacesCount; face++)
+        {
+            cv::Point points[4];
+            float center[3] = { 0, 0, 0 };
+            bool visible = true;
+
+            for (int i = 0; i < 4 && visible; i++)
+            {
+                float point[4], eye[4];
+                getCubePoint(face * 4 + i, point);
+                transform(modelView, point, eye);
+                visible = projectPoint(eye, points[i]);
+
+                for (int k = 0; k < 3; k++)
+                    center[k] += eye[k] / 4;
+            }
+
+            if (!visible)
+                continue;
+
+            // Fixed-function lighting at the face center. The normal of the scaled cube grows by the inverse scale,
+            // as OpenGL doesn't renormalize it (GL_NORMALIZE is off)
+            const float* n = SceneGeometry::cubeNormals[face];
+            float normal[3], toLight[3];
+            for (int k = 0; k < 3; k++)
+            {
+                normal[k]  = (modelView.data[k] * n[0] + modelView.data[4 + k] * n[1] + modelView.data[8 + k] * n[2]) / SceneGeometry::cubeScale;
+                toLight[k] = light[k] - center[k];
+            }
+
+            const float distance = std::sqrt(toLight[0] * toLight[0] + toLight[1] * toLight[1] + toLight[2] * toLight[2]);
+            const float diffuse  = distance > FLT_EPSILON
+                ? std::max(0.f, (normal[0] * toLight[0] + normal[1] * toLight[1] + normal[2] * toLight[2]) / distance)
+                : 0.f;
+
+            float color[3];
+            for (int k = 0; k < 3; k++)
+            {
+                const float intensity = kGlobalAmbient + SceneGeometry::lightAmbient[k] + SceneGeometry::lightDiffuse[k] * diffuse;
+                color[k] = std::min(1.f, material[k] * intensity);
+            }
+
+            // Coverage of the face (or its outline) in the bounding box
+            int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+            for (int i = 0; i < 4; i++)
+            {
+                minX = std::min(minX, points[i].x);
+                minY = std::min(minY, points[i].y);
+                maxX = std::max(maxX, points[i].x);
+                maxY = std::max(maxY, points[i].y);
+            }
+
+            const int border = thickness + 1;
+            cv::Rect area(cv::Point((minX >> kShift) - border, (minY >> kShift) - border),
+                          cv::Point((maxX >> kShift) + border + 1, (maxY >> kShift) + border + 1));
+            area &= frameRect;
+
+            if (area.area() == 0)
+                continue;
+
+            m_mask(area).setTo(cv::Scalar::all(0));
+
+            if (edges)
+            {
+                const cv::Point* polygon = points;
+                const int count = 4;
+                cv::polylines(m_mask, &polygon, &count, 1, true, cv::Scalar::all(255), thickness, 8, kShift);
+            }
+            else
+            {
+                cv::fillConvexPoly(m_mask, points, 4, cv::Scalar::all(255), 8, kShift);
+            }
+
+            blendMask(frame, area, color, material[3]);
+        }
+    }
+}
+
+void OffscreenRenderer::blendMask(cv::Mat& frame, cv::Rect area, const float color[3], float alpha)
+{
+    const float keep = 1 - alpha;
+    const float b = color[2] * 255;
+    const float g = color[1] * 255;
+    const float r = color[0] * 255;
+
+    for (int y = area.y; y < area.y + area.height; y++)
+    {
+        const unsigned char* mask = m_mask.ptr<unsigned char>(y);
+        cv::Vec3b* row = frame.ptr<cv::Vec3b>(y);
+
+        for (int x = area.x; x < area.x + area.width; x++)
+        {
+            if (!mask[x])
+                continue;
+
+            cv::Vec3b& pixel = row[x];
+            pixel[0] = cv::saturate_cast<unsigned char>(b + pixel[0] * keep);
+            pixel[1] = cv::saturate_cast<unsigned char>(g + pixel[1] * keep);
+            pixel[2] = cv::saturate_cast<unsigned char>(r + pixel[2] * keep);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef EXAMPLE_MARKERLESS_AR_OFFSCREENRENDERER_HPP
+#define EXAMPLE_MARKERLESS_AR_OFFSCREENRENDERER_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "GeometryTypes.hpp"
+#include "CameraCalibration.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * CPU renderer of the augmented scene (see SceneGeometry): draws the coordinate axis and the cube over the frame
+ * in place, with the projection, blending and lighting of ARDrawingContext. Needs no window, no OpenGL context
+ * and no GPU, so annotated videos can be produced in batch at the speed of the CPU.
+ * Faces are shaded flat (lit at the face center) and primitives that cross the camera plane are skipped instead
+ * of being clipped.
+ */
+class OffscreenRenderer
+{
+public:
+    explicit OffscreenRenderer(const CameraCalibration& calibration);
+
+    /**
+    * Draw the scene of the pattern at @pose over the BGR @frame. Only the overlay text is drawn when
+    * @isPatternPresent is false.
+    */
+    void render(cv::Mat& frame, bool isPatternPresent, const Transformation& pose);
+
+    /**
+    * Set the text drawn over the scene, one line per entry.
+    */
+    void setOverlayText(const std::vector<std::string>& lines);
+
+private:
+    /**
+    * Project the point in the eye coordinates to the frame (fixed point with kShift fractional bits).
+    * Returns false if the point is behind the camera.
+    */
+    bool projectPoint(const float eye[4], cv::Point& pixel) const;
+
+    void drawCoordinateAxis(cv::Mat& frame, const Matrix44& modelView);
+
+    void drawCubeModel(cv::Mat& frame, const Matrix44& modelView);
+
+    /**
+    * Blend @color with the frame pixels set in m_mask within @area as glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+    */
+    void blendMask(cv::Mat& frame, cv::Rect area, const float color[3], float alpha);
+
+    CameraCalibration        m_calibration;
+    cv::Size                 m_frameSize;     // Frame size m_projection is built for
+    Matrix44                 m_projection;
+    cv::Mat                  m_mask;          // Coverage of the primitive being blended
+    std::vector<std::string> m_overlayText;
+};
+
+#endif
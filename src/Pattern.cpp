@@ -1,32 +1,18 @@
 ////////////////////////////////////////////////////////////////////
 // File includes:
 #include "Pattern.hpp"
+#include "PlanarPoseEstimator.hpp"
 
-void PatternTrackingInfo::computePose(const Pattern& pattern, const CameraCalibration& calibration)
+PatternTrackingInfo::PatternTrackingInfo()
+  : patternIndex(0)
+  , hasPose(false)
 {
-  cv::Mat Rvec;
-  cv::Mat_<float> Tvec;
-  cv::Mat raux,taux;
-
-  cv::solvePnP(pattern.points3d, points2d, calibration.getIntrinsic(), calibration.getDistorsion(),raux,taux);
-  raux.convertTo(Rvec,CV_32F);
-  taux.convertTo(Tvec ,CV_32F);
-
-  cv::Mat_<float> rotMat(3,3); 
-  cv::Rodrigues(Rvec, rotMat);
-
-  // Copy to transformation matrix
-  for (int col=0; col<3; col++)
-  {
-    for (int row=0; row<3; row++)
-    {        
-     pose3d.r().mat[row][col] = rotMat(row,col); // Copy rotation component
-    }
-    pose3d.t().data[col] = Tvec(col); // Copy translation component
-  }
+}
 
-  // Since solvePnP finds camera location, w.r.t to marker pose, to get marker pose w.r.t to the camera we invert it.
-  pose3d = pose3d.getInverted();
+void PatternTrackingInfo::computePose(const Pattern& pattern, const CameraCalibration& calibration)
+{
+  PlanarPoseEstimator estimator;
+  estimator.estimate(pattern, calibration, *this);
 }
 
 void PatternTrackingInfo::draw2dContour(cv::Mat& image, cv::Scalar color) const
@@ -5,6 +5,8 @@
 // File includes:
 #include "GeometryTypes.hpp"
 #include "CameraCalibration.hpp"
+#include "MappedFile.hpp"
+#include "FrameStats.hpp"
 
 #include <opencv2/opencv.hpp>
 
@@ -22,6 +24,10 @@ struct Pattern
 
   std::vector<cv::Point2f>  points2d;
   std::vector<cv::Point3f>  points3d;
+
+  std::vector<cv::Mat>      alignmentLevels; // Optional template pyramid of DirectHomographyRefiner (see getTemplateData)
+
+  cv::Ptr<MappedFile>       storage; // Keeps the pattern file mapped while the matrices above refer to it
 };
 
 /**
@@ -29,14 +35,26 @@ struct Pattern
  */
 struct PatternTrackingInfo
 {
+  PatternTrackingInfo();
+
+  int                       patternIndex; // Index of the found pattern in the trained set
   cv::Mat                   homography;
   std::vector<cv::Point2f>  points2d;
   Transformation            pose3d;
+  bool                      hasPose;      // pose3d is valid (the previous pose is the initial guess for the next one)
+
+  // Inlier correspondences the homography was estimated from (pattern image and frame coordinates)
+  std::vector<cv::Point2f>  patternInliers;
+  std::vector<cv::Point2f>  frameInliers;
+
+  FrameStats                stats;        // How the pattern was found on the frame (see FRAME_STATS)
 
   void draw2dContour(cv::Mat& image, cv::Scalar color) const;
 
   /**
-   * Compute pattern pose using PnP algorithm
+   * Compute pattern pose from the homography and its inliers (see PlanarPoseEstimator).
+   * Convenience for single calls: a temporary estimator allocates its buffers on every call, so per-frame
+   * code keeps its own PlanarPoseEstimator (as ARPipeline does).
    */
   void computePose(const Pattern& pattern, const CameraCalibration& calibration);
 };
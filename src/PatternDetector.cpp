@@ -1,6 +1,7 @@
 ////////////////////////////////////////////////////////////////////
 // File includes:
 #include "PatternDetector.hpp"
+#include "HammingDistance.hpp"
 #include "DebugHelpers.hpp"
 
 ////////////////////////////////////////////////////////////////////
@@ -10,6 +11,52 @@
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <cfloat>
+#include <climits>
+
+namespace
+{
+    /**
+     * Homography rendering the pattern of @size scaled by @scale and rotated around its center by @tiltX and @tiltY
+     * radians (around the horizontal and vertical axes) as seen by a camera with the focal length equal to the pattern size.
+     * The rendering is shifted to positive coordinates and its size is stored in @viewSize.
+     */
+    cv::Matx33d getSyntheticViewHomography(cv::Size size, double scale, double tiltX, double tiltY, cv::Size& viewSize)
+    {
+        const double f = std::max(size.width, size.height);
+
+        const cv::Matx33d center(1, 0, -0.5 * size.width, 0, 1, -0.5 * size.height, 0, 0, 1);
+        const cv::Matx33d rotationX(1, 0, 0, 0, cos(tiltX), -sin(tiltX), 0, sin(tiltX), cos(tiltX));
+        const cv::Matx33d rotationY(cos(tiltY), 0, sin(tiltY), 0, 1, 0, -sin(tiltY), 0, cos(tiltY));
+        const cv::Matx33d r = rotationY * rotationX;
+
+        // Pattern plane placed at the distance f in front of the camera: [r1 r2 t]
+        const cv::Matx33d pose(r(0,0), r(0,1), 0, r(1,0), r(1,1), 0, r(2,0), r(2,1), f);
+        const cv::Matx33d camera(f * scale, 0, 0, 0, f * scale, 0, 0, 0, 1);
+
+        const cv::Matx33d H = camera * pose * center;
+
+        // Bounding box of the rendered pattern
+        const cv::Point2d corners[4] = 
+        {
+            cv::Point2d(0, 0), cv::Point2d(size.width, 0), cv::Point2d(size.width, size.height), cv::Point2d(0, size.height)
+        };
+
+        double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+        for (int i = 0; i < 4; i++)
+        {
+            const cv::Vec3d p = H * cv::Vec3d(corners[i].x, corners[i].y, 1);
+
+            minX = std::min(minX, p[0] / p[2]);
+            minY = std::min(minY, p[1] / p[2]);
+            maxX = std::max(maxX, p[0] / p[2]);
+            maxY = std::max(maxY, p[1] / p[2]);
+        }
+
+        viewSize = cv::Size(cvCeil(maxX - minX), cvCeil(maxY - minY));
+        return cv::Matx33d(1, 0, -minX, 0, 1, -minY, 0, 0, 1) * H;
+    }
+}
 
 PatternDetector::PatternDetector(cv::Ptr<cv::FeatureDetector> detector, 
     cv::Ptr<cv::DescriptorExtractor> extractor, 
@@ -20,35 +67,87 @@ PatternDetector::PatternDetector(cv::Ptr<cv::FeatureDetector> detector,
     , m_matcher(matcher)
     , enableRatioTest(ratioTest)
     , enableHomographyRefinement(true)
+    , homographyRefinementMethod(FeatureRefinement)
     , homographyReprojectionThreshold(3)
+    , enableTracking(true)
+    , trackingQualityThreshold(0.5f)
+    , maxCandidatePatterns(8)
+    , enableGuidedMatching(true)
+    , guidedSearchRadius(20)
+    , trainingScalesCount(4)
+    , trainingScaleStep(sqrtf(2.0f))
+    , trainingTiltAngle(40)
+    , trainingFeaturesPerView(500)
+    , enableTiledExtraction(true)
+    , m_frameAllocationsCount(0)
+    , m_isTracking(false)
+    , m_initialTrackedCount(0)
+    , m_hasPrevHomography(false)
+{
+}
+
+PatternDetector::PatternDetector(cv::Ptr<const PatternModel> model, bool ratioTest)
+    : PatternDetector(cv::Ptr<cv::FeatureDetector>(), cv::Ptr<cv::DescriptorExtractor>(), cv::Ptr<cv::DescriptorMatcher>(), ratioTest)
 {
+    setModel(model);
 }
 
 
 void PatternDetector::train(const Pattern& pattern)
 {
-    // Store the pattern object
-    m_pattern = pattern;
+    train(std::vector<Pattern>(1, pattern));
+}
 
-    // API of cv::DescriptorMatcher is somewhat tricky
-    // First we clear old train data:
-    m_matcher->clear();
+void PatternDetector::train(const std::vector<Pattern>& patterns)
+{
+    // Contexts created from a model have no algorithms of their own
+    CV_Assert(!m_detector.empty() && !m_extractor.empty() && !m_matcher.empty());
 
-    // That we add vector of descriptors (each descriptors matrix describe one image). 
-    // This allows us to perform search across multiple images:
-    std::vector<cv::Mat> descriptors(1);
-    descriptors[0] = pattern.descriptors.clone(); 
-    m_matcher->add(descriptors);
+    // Model trains an empty matcher of the same type and parameters
+    setModel(new PatternModel(patterns, m_detector, m_extractor, m_matcher->clone(true), m_vocabulary));
+}
 
-    // After adding train data perform actual train:
-    m_matcher->train();
+void PatternDetector::setModel(cv::Ptr<const PatternModel> model)
+{
+    CV_Assert(!model.empty());
+    m_model = model;
+
+    // Matchers keep per-query buffers, so each context has its own instance sharing the trained data
+    m_matcher = m_model->createMatcher();
+
+    // Binary matchers match preselected patterns in place, other ones need a matcher trained with the candidates
+    m_candidateMatcher.release();
+    if (m_model->hasVocabulary() && !dynamic_cast<HammingMatcher*>(m_matcher.obj))
+        m_candidateMatcher = m_model->createEmptyMatcher();
+
+    // Direct refinement aligns the image of the first pattern, the copy shares the template built by the model
+    m_directRefiner = m_model->getDirectRefiner();
+
+    // Tracked points and location prior belong to the old pattern
+    resetTracking();
+    m_hasPrevHomography = false;
 }
 
-void PatternDetector::buildPatternFromImage(const cv::Mat& image, Pattern& pattern) const
+cv::Ptr<const PatternModel> PatternDetector::getModel() const
+{
+    return m_model;
+}
+
+void PatternDetector::setVocabulary(cv::Ptr<BinaryVocabulary> vocabulary)
+{
+    m_vocabulary = vocabulary;
+}
+
+void PatternDetector::resetTracking()
 {
-    int numImages = 4;
-    float step = sqrtf(2.0f);
+    m_isTracking = false;
+    m_initialTrackedCount = 0;
+    m_trackedPatternPoints.clear();
+    m_trackedPoints.clear();
+}
 
+void PatternDetector::buildPatternFromImage(const cv::Mat& image, Pattern& pattern) const
+{
     // Store original image in pattern structure
     pattern.size = cv::Size(image.cols, image.rows);
     pattern.frame = image.clone();
@@ -77,92 +176,315 @@ void PatternDetector::buildPatternFromImage(const cv::Mat& image, Pattern& patte
     pattern.points3d[2] = cv::Point3f( unitW,  unitH, 0);
     pattern.points3d[3] = cv::Point3f(-unitW,  unitH, 0);
 
-    extractFeatures(pattern.grayImg, pattern.keypoints, pattern.descriptors);
+    pattern.keypoints.clear();
+    pattern.descriptors.release();
+
+    // Template pyramid of the direct refinement is stored with the pattern, so it's not rebuilt on load
+    DirectHomographyRefiner refiner;
+    refiner.setTemplate(pattern.grayImg);
+    refiner.getTemplateData(pattern.alignmentLevels);
+
+    // Synthetic out-of-plane rotations used on each scale (the first one is the frontal view)
+    const double tilt = trainingTiltAngle * CV_PI / 180;
+    const double tilts[5][2] = { {0, 0}, {tilt, 0}, {-tilt, 0}, {0, tilt}, {0, -tilt} };
+    const int viewsCount = tilt > 0 ? 5 : 1;
+
+    std::vector<cv::KeyPoint> viewKeypoints;
+    cv::Mat viewDescriptors;
+    cv::Mat rendering;
+    cv::Mat mask;
+
+    for (int s = 0; s < std::max(1, trainingScalesCount); s++)
+    {
+        const double scale = 1.0 / std::pow(static_cast<double>(trainingScaleStep), s);
+
+        for (int v = 0; v < viewsCount; v++)
+        {
+            cv::Size viewSize;
+            const cv::Matx33d H = getSyntheticViewHomography(pattern.size, scale, tilts[v][0], tilts[v][1], viewSize);
+
+            // Too small renderings have no useful features
+            if (std::min(viewSize.width, viewSize.height) < 64)
+                continue;
+
+            if (s == 0 && v == 0)
+            {
+                // Original image itself
+                rendering = pattern.grayImg;
+                mask.release();
+            }
+            else
+            {
+                cv::warpPerspective(pattern.grayImg, rendering, cv::Mat(H), viewSize, cv::INTER_LINEAR);
+
+                // Corners on the border of the rendered pattern are artifacts of the rendering
+                cv::warpPerspective(cv::Mat(pattern.grayImg.size(), CV_8UC1, cv::Scalar(255)), mask, cv::Mat(H), viewSize, cv::INTER_NEAREST);
+                cv::erode(mask, mask, cv::Mat(), cv::Point(-1,-1), 8);
+            }
+
+            getFeatureDetector().detect(rendering, viewKeypoints, mask);
+            if (trainingFeaturesPerView > 0)
+                cv::KeyPointsFilter::retainBest(viewKeypoints, trainingFeaturesPerView);
+
+            if (viewKeypoints.empty())
+                continue;
+
+            getDescriptorExtractor().compute(rendering, viewKeypoints, viewDescriptors);
+
+            // Map features back to the pattern coordinates
+            const cv::Matx33d inverseH = H.inv();
+
+            for (size_t i = 0; i < viewKeypoints.size(); i++)
+            {
+                cv::KeyPoint kp = viewKeypoints[i];
+                const cv::Vec3d p = inverseH * cv::Vec3d(kp.pt.x, kp.pt.y, 1);
+
+                kp.pt   = cv::Point2f(static_cast<float>(p[0] / p[2]), static_cast<float>(p[1] / p[2]));
+                kp.size = static_cast<float>(kp.size / scale);
+
+                if (kp.pt.x < 0 || kp.pt.y < 0 || kp.pt.x >= w || kp.pt.y >= h)
+                    continue;
+
+                pattern.keypoints.push_back(kp);
+                pattern.descriptors.push_back(viewDescriptors.row(static_cast<int>(i)));
+            }
+        }
+    }
+}
+
+
+
+bool PatternDetector::findPattern(const FrameView& frame, PatternTrackingInfo& info)
+{
+    const size_t allocationsBefore = AllocationCounter::getThreadCount();
+    m_stats.reset();
+
+	// Get the gray image (no conversion for the luma of YUV frames)
+    ScopedStageTimer grayTimer(&m_stats.timings, StageGray);
+    m_grayImg = frame.getGray(m_grayBuffer);
+    grayTimer.stop();
+
+    bool patternFound = false;
+
+    // If the pattern was found on previous frame, try to follow it with optical flow first
+    if (enableTracking && m_isTracking)
+    {
+        ScopedStageTimer timer(&m_stats.timings, StageTracking);
+        patternFound = trackPattern(info);
+        FRAME_STATS(m_stats.tracked = patternFound);
+    }
+
+    // Fall back to full detection when tracking is disabled or lost
+    if (!patternFound)
+    {
+        patternFound = detectPattern(m_grayImg, info);
+
+        if (patternFound && enableTracking)
+            startTracking(m_matches);
+        else
+            resetTracking();
+    }
+
+    // Found location is the spatial prior for guided matching on the next frame
+    m_hasPrevHomography = patternFound;
+    if (patternFound)
+        info.homography.copyTo(m_prevHomography);
+
+    // Keep current frame for the next tracking step
+    if (enableTracking)
+    {
+        ScopedStageTimer timer(&m_stats.timings, StageTracking);
+
+        // Gray image may be a view of the input frame, which is owned by the caller
+        if (m_grayImg.data != m_grayBuffer.data)
+            m_grayImg.copyTo(m_prevGrayImg);
+        else
+            cv::swap(m_prevGrayImg, m_grayBuffer);
+    }
+
+    m_frameAllocationsCount = AllocationCounter::getThreadCount() - allocationsBefore;
+
+    FRAME_STATS(
+        m_stats.allocationsCount = m_frameAllocationsCount;
+        m_statsHistory.push(m_stats);
+        info.stats = m_stats;
+    )
+
+#if _DEBUG
+    std::cout << "Heap allocations: " << m_frameAllocationsCount << std::endl;
+#endif
+
+    return patternFound;
 }
 
+size_t PatternDetector::getFrameAllocationsCount() const
+{
+    return m_frameAllocationsCount;
+}
 
+const FrameStats& PatternDetector::getFrameStats() const
+{
+    return m_stats;
+}
 
-bool PatternDetector::findPattern(const cv::Mat& image, PatternTrackingInfo& info)
+const FrameStatsHistory& PatternDetector::getStatsHistory() const
 {
-	// Convert input image to gray
-    getGray(image, m_grayImg);
-	
+    return m_statsHistory;
+}
+
+bool PatternDetector::detectPattern(const cv::Mat& image, PatternTrackingInfo& info)
+{
+    const Pattern& pattern = m_model->getPattern(0);
+    info.patternIndex = 0;
+
 	// Extract feature points from input gray image
     extractFeatures(m_grayImg, m_queryKeypoints, m_queryDescriptors);
-	
+    FRAME_STATS(m_stats.keypointsCount = static_cast<int>(m_queryKeypoints.size()));
+
+    // Guided matching is possible only with the location prior and binary descriptors
+    const bool useGuidedMatching = enableGuidedMatching && m_hasPrevHomography && pattern.descriptors.depth() == CV_8U;
+
 	// Get matches with current pattern
-    getMatches(m_queryDescriptors, m_matches);
+    ScopedStageTimer matchTimer(&m_stats.timings, StageMatch);
+    if (useGuidedMatching)
+    {
+        getGuidedMatches(m_queryKeypoints, m_queryDescriptors, m_prevHomography, m_matches);
+    }
+    else
+    {
+        getMatches(m_queryDescriptors, m_matches);
+        keepMatchesWithImage(0, m_matches);
+    }
+    matchTimer.stop();
+    FRAME_STATS(m_stats.matchesCount = static_cast<int>(m_matches.size()));
 
 #if _DEBUG
-    cv::showAndSave("Raw matches", getMatchesImage(image, m_pattern.frame, m_queryKeypoints, m_pattern.keypoints, m_matches, 100));
+    cv::showAndSave("Raw matches", getMatchesImage(image, pattern.frame, m_queryKeypoints, pattern.keypoints, m_matches, 100));
 #endif
 
 #if _DEBUG
     cv::Mat tmp = image.clone();
 #endif
 
+    // RANSAC iterations are counted only with the statistics enabled
+    int* ransacIterations = 0;
+    FRAME_STATS(ransacIterations = &m_stats.ransacIterations);
+
 	// Find homography transformation and detect good matches
+    ScopedStageTimer ransacTimer(&m_stats.timings, StageRansac);
     bool homographyFound = refineMatchesWithHomography(
+        m_homographyEstimator,
         m_queryKeypoints, 
-        m_pattern.keypoints, 
+        pattern.keypoints, 
         homographyReprojectionThreshold, 
         m_matches, 
-        m_roughHomography);
+        m_roughHomography,
+        ransacIterations);
+    ransacTimer.stop();
+
+    // The prior could be wrong (fast motion), so repeat with exhaustive matching
+    if (!homographyFound && useGuidedMatching)
+    {
+        ScopedStageTimer exhaustiveMatchTimer(&m_stats.timings, StageMatch);
+        getMatches(m_queryDescriptors, m_matches);
+        keepMatchesWithImage(0, m_matches);
+        exhaustiveMatchTimer.stop();
+        FRAME_STATS(m_stats.matchesCount = static_cast<int>(m_matches.size()));
+
+        ScopedStageTimer exhaustiveRansacTimer(&m_stats.timings, StageRansac);
+        homographyFound = refineMatchesWithHomography(
+            m_homographyEstimator,
+            m_queryKeypoints, 
+            pattern.keypoints, 
+            homographyReprojectionThreshold, 
+            m_matches, 
+            m_roughHomography,
+            ransacIterations);
+    }
 
     if (homographyFound)
     {
+        FRAME_STATS(m_stats.inliersCount = static_cast<int>(m_matches.size()));
+        setInliers(m_matches, m_queryKeypoints, pattern.keypoints, info);
+
+#if _DEBUG
+        cv::showAndSave("Refined matches using RANSAC", getMatchesImage(image, pattern.frame, m_queryKeypoints, pattern.keypoints, m_matches, 100));
+#endif
+		// If direct refinement enabled align the pattern image to the frame starting from the rough homography
+        if (enableHomographyRefinement && homographyRefinementMethod == DirectRefinement)
+        {
+            ScopedStageTimer timer(&m_stats.timings, StageRefinement);
+            FRAME_STATS(m_stats.refinementApplied = true);
+
+            // Homography stays rough if the alignment didn't reduce the photometric error
+            m_roughHomography.copyTo(info.homography);
+            m_directRefiner.refine(m_grayImg, info.homography);
+
+            cv::perspectiveTransform(pattern.points2d, info.points2d, info.homography);
 #if _DEBUG
-        cv::showAndSave("Refined matches using RANSAC", getMatchesImage(image, m_pattern.frame, m_queryKeypoints, m_pattern.keypoints, m_matches, 100));
+            info.draw2dContour(tmp, CV_RGB(200,0,0));
 #endif
+        }
 		// If homography refinement enabled improve found transformation
-        if (enableHomographyRefinement)
+        else if (enableHomographyRefinement)
         {
 			// Warp image using found homography
-            cv::warpPerspective(m_grayImg, m_warpedImg, m_roughHomography, m_pattern.size, cv::WARP_INVERSE_MAP | cv::INTER_CUBIC);
+            ScopedStageTimer warpTimer(&m_stats.timings, StageWarp);
+            cv::warpPerspective(m_grayImg, m_warpedImg, m_roughHomography, pattern.size, cv::WARP_INVERSE_MAP | cv::INTER_CUBIC);
+            warpTimer.stop();
 #if _DEBUG
             cv::showAndSave("Warped image",m_warpedImg);
 #endif
-            // Get refined matches:
-            std::vector<cv::KeyPoint> warpedKeypoints;
-            std::vector<cv::DMatch> refinedMatches;
-
+            // Features are detected, matched and verified again, all of it is the refinement time
+            ScopedStageTimer refinementTimer(&m_stats.timings, StageRefinement);
+            FRAME_STATS(m_stats.refinementApplied = true);
 			// Detect features on warped image
-            extractFeatures(m_warpedImg, warpedKeypoints, m_queryDescriptors);
+            extractFeatures(m_warpedImg, m_warpedKeypoints, m_queryDescriptors);
 
-			// Match with pattern
-            getMatches(m_queryDescriptors, refinedMatches);
+			// Match with pattern (warped image is aligned with the pattern, so identity is the prior for guided matching)
+            if (enableGuidedMatching && pattern.descriptors.depth() == CV_8U)
+            {
+                getGuidedMatches(m_warpedKeypoints, m_queryDescriptors, cv::Mat(), m_refinedMatches);
+            }
+            else
+            {
+                getMatches(m_queryDescriptors, m_refinedMatches);
+                keepMatchesWithImage(0, m_refinedMatches);
+            }
 
 			// Estimate new refinement homography
             homographyFound = refineMatchesWithHomography(
-                warpedKeypoints, 
-                m_pattern.keypoints, 
+                m_homographyEstimator,
+                m_warpedKeypoints, 
+                pattern.keypoints, 
                 homographyReprojectionThreshold, 
-                refinedMatches, 
-                m_refinedHomography);
+                m_refinedMatches, 
+                m_refinedHomography,
+                ransacIterations);
 #if _DEBUG
-            cv::showAndSave("MatchesWithRefinedPose", getMatchesImage(m_warpedImg, m_pattern.grayImg, warpedKeypoints, m_pattern.keypoints, refinedMatches, 100));
+            cv::showAndSave("MatchesWithRefinedPose", getMatchesImage(m_warpedImg, pattern.grayImg, m_warpedKeypoints, pattern.keypoints, m_refinedMatches, 100));
 #endif
 			// Get a result homography as result of matrix product of refined and rough homographies:
-            info.homography = m_roughHomography * m_refinedHomography;
+            cv::gemm(m_roughHomography, m_refinedHomography, 1, cv::noArray(), 0, info.homography);
 
             // Transform contour with rough homography
 #if _DEBUG
-            cv::perspectiveTransform(m_pattern.points2d, info.points2d, m_roughHomography);
+            cv::perspectiveTransform(pattern.points2d, info.points2d, m_roughHomography);
             info.draw2dContour(tmp, CV_RGB(0,200,0));
 #endif
 
             // Transform contour with precise homography
-            cv::perspectiveTransform(m_pattern.points2d, info.points2d, info.homography);
+            cv::perspectiveTransform(pattern.points2d, info.points2d, info.homography);
 #if _DEBUG
             info.draw2dContour(tmp, CV_RGB(200,0,0));
 #endif
         }
         else
         {
-            info.homography = m_roughHomography;
+            m_roughHomography.copyTo(info.homography);
 
             // Transform contour with rough homography
-            cv::perspectiveTransform(m_pattern.points2d, info.points2d, m_roughHomography);
+            cv::perspectiveTransform(pattern.points2d, info.points2d, m_roughHomography);
 #if _DEBUG
             info.draw2dContour(tmp, CV_RGB(0,200,0));
 #endif
@@ -172,14 +494,456 @@ bool PatternDetector::findPattern(const cv::Mat& image, PatternTrackingInfo& inf
 #if _DEBUG
     if (1)
     {
-        cv::showAndSave("Final matches", getMatchesImage(tmp, m_pattern.frame, m_queryKeypoints, m_pattern.keypoints, m_matches, 100));
+        cv::showAndSave("Final matches", getMatchesImage(tmp, pattern.frame, m_queryKeypoints, pattern.keypoints, m_matches, 100));
     }
-    std::cout << "Features:" << std::setw(4) << m_queryKeypoints.size() << " Matches: " << std::setw(4) << m_matches.size() << std::endl;
+    std::cout << "Features:" << std::setw(4) << m_queryKeypoints.size() << " Matches: " << std::setw(4) << m_matches.size() 
+              << " RANSAC iterations: " << std::setw(4) << m_homographyEstimator.getIterationsCount() << std::endl;
 #endif
 
     return homographyFound;
 }
 
+void PatternDetector::startTracking(const std::vector<cv::DMatch>& inliers)
+{
+    const Pattern& pattern = m_model->getPattern(0);
+
+    m_trackedPatternPoints.resize(inliers.size());
+    m_trackedPoints.resize(inliers.size());
+
+    // Follow the inlier query keypoints and remember their positions on the pattern
+    for (size_t i = 0; i < inliers.size(); i++)
+    {
+        m_trackedPatternPoints[i] = pattern.keypoints[inliers[i].trainIdx].pt;
+        m_trackedPoints[i]        = m_queryKeypoints[inliers[i].queryIdx].pt;
+    }
+
+    m_initialTrackedCount = inliers.size();
+    m_isTracking = true;
+}
+
+bool PatternDetector::trackPattern(PatternTrackingInfo& info)
+{
+    const Pattern& pattern = m_model->getPattern(0);
+    info.patternIndex = 0;
+
+    const size_t minNumberPointsAllowed = 8;
+
+    if (m_prevGrayImg.empty() || m_prevGrayImg.size() != m_grayImg.size() || m_trackedPoints.empty())
+    {
+        resetTracking();
+        return false;
+    }
+
+    // Follow the points from the previous frame
+    cv::calcOpticalFlowPyrLK(m_prevGrayImg, m_grayImg, m_trackedPoints, m_nextTrackedPoints, m_trackingStatus, m_trackingError);
+
+    // Keep only successfully tracked points
+    size_t trackedCount = 0;
+    for (size_t i = 0; i < m_trackingStatus.size(); i++)
+    {
+        if (m_trackingStatus[i])
+        {
+            m_trackedPatternPoints[trackedCount] = m_trackedPatternPoints[i];
+            m_trackedPoints[trackedCount]        = m_nextTrackedPoints[i];
+            trackedCount++;
+        }
+    }
+
+    m_trackedPatternPoints.resize(trackedCount);
+    m_trackedPoints.resize(trackedCount);
+
+    // Tracking quality is the fraction of the initial points that are still consistent with the pattern
+    const size_t minTrackedCount = std::max(minNumberPointsAllowed, 
+        static_cast<size_t>(trackingQualityThreshold * m_initialTrackedCount));
+
+    if (trackedCount < minTrackedCount)
+    {
+        resetTracking();
+        return false;
+    }
+
+    // Estimate the homography from the tracked points and reject outliers
+    const bool homographyFound = m_homographyEstimator.estimate(m_trackedPatternPoints, m_trackedPoints, homographyReprojectionThreshold, m_trackedHomography);
+    FRAME_STATS(m_stats.ransacIterations += m_homographyEstimator.getIterationsCount());
+
+    const std::vector<unsigned char>& inliersMask = m_homographyEstimator.getInliersMask();
+
+    size_t inliersCount = 0;
+    for (size_t i = 0; i < inliersMask.size(); i++)
+    {
+        if (inliersMask[i])
+        {
+            m_trackedPatternPoints[inliersCount] = m_trackedPatternPoints[i];
+            m_trackedPoints[inliersCount]        = m_trackedPoints[i];
+            inliersCount++;
+        }
+    }
+
+    m_trackedPatternPoints.resize(inliersCount);
+    m_trackedPoints.resize(inliersCount);
+    FRAME_STATS(m_stats.inliersCount = static_cast<int>(inliersCount));
+
+#if _DEBUG
+    std::cout << "Tracked: " << std::setw(4) << trackedCount << " Inliers: " << std::setw(4) << inliersCount << std::endl;
+#endif
+
+    if (!homographyFound || inliersCount < minTrackedCount)
+    {
+        resetTracking();
+        return false;
+    }
+
+    m_trackedHomography.copyTo(info.homography);
+    info.patternInliers = m_trackedPatternPoints;
+    info.frameInliers   = m_trackedPoints;
+
+    // Transform contour with tracked homography
+    cv::perspectiveTransform(pattern.points2d, info.points2d, info.homography);
+    return true;
+}
+
+/**
+ * Verifies candidate patterns in parallel by estimating the homography from the matches of each of them.
+ */
+class PatternDetector::PatternVerificationBody : public cv::ParallelLoopBody
+{
+public:
+    PatternVerificationBody(PatternDetector& detector, float reprojectionThreshold)
+        : m_detector(detector)
+        , m_reprojectionThreshold(reprojectionThreshold)
+    {
+    }
+
+    virtual void operator()(const cv::Range& range) const
+    {
+        for (int i = range.start; i < range.end; i++)
+        {
+            const int imageIdx   = m_detector.m_candidateImages[i];
+            const int patternIdx = m_detector.m_matchedPatterns[imageIdx];
+
+            // Each candidate works on its own matches, homography and estimator, so no synchronization is needed
+            m_detector.m_candidateFound[i] = PatternDetector::refineMatchesWithHomography(
+                m_detector.m_candidateEstimators[i],
+                m_detector.m_queryKeypoints, 
+                m_detector.m_model->getPattern(patternIdx).keypoints, 
+                m_reprojectionThreshold, 
+                m_detector.m_patternMatches[imageIdx], 
+                m_detector.m_candidateHomographies[i]);
+        }
+    }
+
+private:
+    PatternDetector& m_detector;
+    float            m_reprojectionThreshold;
+};
+
+bool PatternDetector::findPatterns(const FrameView& frame, std::vector<PatternTrackingInfo>& infos)
+{
+    const size_t minNumberMatchesAllowed = 8;
+
+    infos.clear();
+    m_stats.reset();
+
+	// Get the gray image (no conversion for the luma of YUV frames)
+    ScopedStageTimer grayTimer(&m_stats.timings, StageGray);
+    m_grayImg = frame.getGray(m_grayBuffer);
+    grayTimer.stop();
+
+	// Extract feature points once for all patterns
+    const bool hasFeatures = extractFeatures(m_grayImg, m_queryKeypoints, m_queryDescriptors);
+    FRAME_STATS(m_stats.keypointsCount = static_cast<int>(m_queryKeypoints.size()));
+
+    if (!hasFeatures)
+    {
+        FRAME_STATS(m_statsHistory.push(m_stats));
+        return false;
+    }
+
+    ScopedStageTimer matchTimer(&m_stats.timings, StageMatch);
+
+    const std::vector<Pattern>& patterns = m_model->getPatterns();
+
+    if (m_model->hasVocabulary() && m_model->getPatternIndex().size() > maxCandidatePatterns)
+    {
+        // Rank patterns with the vocabulary index and match only against the best candidates
+        m_model->getVocabulary().transform(m_queryDescriptors, m_queryBow, m_queryWords);
+        m_model->getPatternIndex().query(m_queryBow, maxCandidatePatterns, m_indexBuffers, m_indexMatches);
+
+        m_matchedPatterns.resize(m_indexMatches.size());
+        for (size_t i = 0; i < m_indexMatches.size(); i++)
+        {
+            m_matchedPatterns[i] = m_indexMatches[i].documentId;
+        }
+
+        // Binary matchers (exhaustive or LSH) search the already packed rows of the candidates, match imgIdx is the candidate position
+        HammingMatcher* hammingMatcher = dynamic_cast<HammingMatcher*>(m_matcher.obj);
+        if (hammingMatcher)
+        {
+            const float minRatio = 1.f / 1.5f;
+            hammingMatcher->matchImages(m_queryDescriptors, m_matchedPatterns, m_matches, enableRatioTest ? minRatio : 1.f);
+        }
+        else
+        {
+            // Other matchers are trained with the candidates
+            m_candidateDescriptors.resize(m_matchedPatterns.size());
+            for (size_t i = 0; i < m_matchedPatterns.size(); i++)
+            {
+                m_candidateDescriptors[i] = patterns[m_matchedPatterns[i]].descriptors;
+            }
+
+            m_candidateMatcher->clear();
+            m_candidateMatcher->add(m_candidateDescriptors);
+            m_candidateMatcher->train();
+
+            getMatches(*m_candidateMatcher, m_queryDescriptors, m_matches);
+        }
+    }
+    else
+    {
+        // Each train image of the matcher is a pattern
+        m_matchedPatterns.resize(patterns.size());
+        for (size_t i = 0; i < patterns.size(); i++)
+        {
+            m_matchedPatterns[i] = static_cast<int>(i);
+        }
+
+	    // Match against all trained patterns at once
+        getMatches(*m_matcher, m_queryDescriptors, m_matches);
+    }
+
+    // Group matches by the train image they belong to
+    m_patternMatches.resize(m_matchedPatterns.size());
+    for (size_t i = 0; i < m_patternMatches.size(); i++)
+    {
+        m_patternMatches[i].clear();
+    }
+
+    for (size_t i = 0; i < m_matches.size(); i++)
+    {
+        m_patternMatches[m_matches[i].imgIdx].push_back(m_matches[i]);
+    }
+
+    // Only patterns with enough matches are worth verification
+    m_candidateImages.clear();
+    for (size_t i = 0; i < m_patternMatches.size(); i++)
+    {
+        if (m_patternMatches[i].size() >= minNumberMatchesAllowed)
+            m_candidateImages.push_back(static_cast<int>(i));
+    }
+
+    m_candidateHomographies.resize(m_candidateImages.size());
+    m_candidateFound.assign(m_candidateImages.size(), 0);
+
+    if (m_candidateEstimators.size() < m_candidateImages.size())
+        m_candidateEstimators.resize(m_candidateImages.size());
+
+    matchTimer.stop();
+
+    ScopedStageTimer ransacTimer(&m_stats.timings, StageRansac);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(m_candidateImages.size())), 
+        PatternVerificationBody(*this, homographyReprojectionThreshold));
+    ransacTimer.stop();
+
+    FRAME_STATS(
+        m_stats.matchesCount = static_cast<int>(m_matches.size());
+        for (size_t i = 0; i < m_candidateImages.size(); i++)
+        {
+            m_stats.ransacIterations += m_candidateEstimators[i].getIterationsCount();
+            if (m_candidateFound[i])
+                m_stats.inliersCount += static_cast<int>(m_patternMatches[m_candidateImages[i]].size());
+        }
+        m_statsHistory.push(m_stats);
+    )
+
+    for (size_t i = 0; i < m_candidateImages.size(); i++)
+    {
+        if (!m_candidateFound[i])
+            continue;
+
+        const int patternIdx = m_matchedPatterns[m_candidateImages[i]];
+
+        PatternTrackingInfo info;
+        info.patternIndex = patternIdx;
+        info.homography   = m_candidateHomographies[i];
+        FRAME_STATS(info.stats = m_stats);
+        setInliers(m_patternMatches[m_candidateImages[i]], m_queryKeypoints, patterns[patternIdx].keypoints, info);
+
+        // Transform contour with rough homography
+        cv::perspectiveTransform(patterns[patternIdx].points2d, info.points2d, info.homography);
+        infos.push_back(info);
+    }
+
+#if _DEBUG
+    std::cout << "Features:" << std::setw(4) << m_queryKeypoints.size() << " Matches: " << std::setw(4) << m_matches.size() 
+              << " Candidates: " << std::setw(4) << m_candidateImages.size() << " Found: " << std::setw(4) << infos.size() << std::endl;
+#endif
+
+    return !infos.empty();
+}
+
+void PatternDetector::getGuidedMatches(const std::vector<cv::KeyPoint>& queryKeypoints, 
+    const cv::Mat& queryDescriptors, 
+    const cv::Mat& homography, 
+    std::vector<cv::DMatch>& matches)
+{
+    const Pattern& pattern = m_model->getPattern(0);
+    const float radius = std::max(1.f, guidedSearchRadius);
+    const float radius2 = radius * radius;
+    const int   length = pattern.descriptors.cols;
+
+    matches.clear();
+
+    if (queryKeypoints.empty() || pattern.keypoints.empty())
+        return;
+
+    // Predict location of pattern keypoints on the frame
+    m_patternPoints.resize(pattern.keypoints.size());
+    for (size_t i = 0; i < pattern.keypoints.size(); i++)
+    {
+        m_patternPoints[i] = pattern.keypoints[i].pt;
+    }
+
+    if (homography.empty())
+        m_projectedPoints = m_patternPoints;
+    else
+        cv::perspectiveTransform(m_patternPoints, m_projectedPoints, homography);
+
+    // Bucket predicted points into the grid with the cell size equal to the search radius,
+    // so the candidates of any query point are in the 3x3 neighbourhood of its cell
+    cv::Rect_<float> bounds(-radius, -radius, 0, 0);
+    for (size_t i = 0; i < queryKeypoints.size(); i++)
+    {
+        bounds.width  = std::max(bounds.width,  queryKeypoints[i].pt.x + 2 * radius);
+        bounds.height = std::max(bounds.height, queryKeypoints[i].pt.y + 2 * radius);
+    }
+
+    const int gridCols = static_cast<int>(bounds.width  / radius) + 1;
+    const int gridRows = static_cast<int>(bounds.height / radius) + 1;
+
+    m_gridCells.resize(m_projectedPoints.size());
+    m_gridStarts.assign(gridCols * gridRows + 1, 0);
+
+    for (size_t i = 0; i < m_projectedPoints.size(); i++)
+    {
+        const cv::Point2f& p = m_projectedPoints[i];
+        int cell = -1;
+
+        if (bounds.contains(p))
+        {
+            cell = static_cast<int>((p.y - bounds.y) / radius) * gridCols + static_cast<int>((p.x - bounds.x) / radius);
+            m_gridStarts[cell + 1]++;
+        }
+
+        m_gridCells[i] = cell;
+    }
+
+    for (size_t c = 1; c < m_gridStarts.size(); c++)
+        m_gridStarts[c] += m_gridStarts[c - 1];
+
+    m_gridItems.resize(m_gridStarts.back());
+    m_gridCursor.assign(m_gridStarts.begin(), m_gridStarts.end() - 1);
+    for (size_t i = 0; i < m_gridCells.size(); i++)
+    {
+        if (m_gridCells[i] >= 0)
+            m_gridItems[m_gridCursor[m_gridCells[i]]++] = static_cast<int>(i);
+    }
+
+    // Best query for each pattern keypoint is needed for the mutual nearest neighbour check
+    m_trainBestDistance.assign(pattern.keypoints.size(), INT_MAX);
+    m_trainBestQuery.assign(pattern.keypoints.size(), -1);
+
+    // To avoid NaN's when best match has zero distance we will use inversed ratio. 
+    const float minRatio = 1.f / 1.5f;
+
+    for (size_t q = 0; q < queryKeypoints.size(); q++)
+    {
+        const cv::Point2f& qp = queryKeypoints[q].pt;
+        const int cellX = static_cast<int>((qp.x - bounds.x) / radius);
+        const int cellY = static_cast<int>((qp.y - bounds.y) / radius);
+        const uchar* queryDescriptor = queryDescriptors.ptr(static_cast<int>(q));
+
+        int best = INT_MAX, second = INT_MAX, bestIdx = -1;
+
+        for (int y = std::max(0, cellY - 1); y <= std::min(gridRows - 1, cellY + 1); y++)
+        {
+            for (int x = std::max(0, cellX - 1); x <= std::min(gridCols - 1, cellX + 1); x++)
+            {
+                const int cell = y * gridCols + x;
+                for (int j = m_gridStarts[cell]; j < m_gridStarts[cell + 1]; j++)
+                {
+                    const int t = m_gridItems[j];
+                    const cv::Point2f delta = m_projectedPoints[t] - qp;
+
+                    if (delta.dot(delta) > radius2)
+                        continue;
+
+                    const int d = hamming::distance(queryDescriptor, pattern.descriptors.ptr(t), length);
+                    if (d < best)
+                    {
+                        second  = best;
+                        best    = d;
+                        bestIdx = t;
+                    }
+                    else if (d < second)
+                    {
+                        second = d;
+                    }
+
+                    if (d < m_trainBestDistance[t])
+                    {
+                        m_trainBestDistance[t] = d;
+                        m_trainBestQuery[t]    = static_cast<int>(q);
+                    }
+                }
+            }
+        }
+
+        if (bestIdx < 0)
+            continue;
+
+        if (enableRatioTest && second != INT_MAX && !(best < minRatio * second))
+            continue;
+
+        matches.push_back(cv::DMatch(static_cast<int>(q), bestIdx, 0, static_cast<float>(best)));
+    }
+
+    // Pass only mutual nearest neighbours
+    size_t count = 0;
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        if (m_trainBestQuery[matches[i].trainIdx] == matches[i].queryIdx)
+            matches[count++] = matches[i];
+    }
+
+    matches.resize(count);
+}
+
+void PatternDetector::keepMatchesWithImage(int imgIdx, std::vector<cv::DMatch>& matches) const
+{
+    // With a single trained pattern all matches belong to it
+    if (m_model->getPatternsCount() < 2)
+        return;
+
+    size_t count = 0;
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        if (matches[i].imgIdx == imgIdx)
+            matches[count++] = matches[i];
+    }
+
+    matches.resize(count);
+}
+
+const cv::FeatureDetector& PatternDetector::getFeatureDetector() const
+{
+    return m_model.empty() ? *m_detector : m_model->getDetector();
+}
+
+const cv::DescriptorExtractor& PatternDetector::getDescriptorExtractor() const
+{
+    return m_model.empty() ? *m_extractor : m_model->getExtractor();
+}
+
 void PatternDetector::getGray(const cv::Mat& image, cv::Mat& gray)
 {
     if (image.channels()  == 3)
@@ -190,16 +954,25 @@ void PatternDetector::getGray(const cv::Mat& image, cv::Mat& gray)
         gray = image;
 }
 
-bool PatternDetector::extractFeatures(const cv::Mat& image, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) const
+bool PatternDetector::extractFeatures(const cv::Mat& image, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors)
 {
     assert(!image.empty());
     assert(image.channels() == 1);
 
-    m_detector->detect(image, keypoints);
+    if (enableTiledExtraction)
+        return m_tiledExtractor.extract(image, getFeatureDetector(), getDescriptorExtractor(), keypoints, descriptors, &m_stats.timings);
+
+    ScopedStageTimer detectTimer(&m_stats.timings, StageDetect);
+    getFeatureDetector().detect(image, keypoints);
+    detectTimer.stop();
+
     if (keypoints.empty())
         return false;
 
-    m_extractor->compute(image, keypoints, descriptors);
+    ScopedStageTimer extractTimer(&m_stats.timings, StageExtract);
+    getDescriptorExtractor().compute(image, keypoints, descriptors);
+    extractTimer.stop();
+
     if (keypoints.empty())
         return false;
 
@@ -207,16 +980,27 @@ bool PatternDetector::extractFeatures(const cv::Mat& image, std::vector<cv::KeyP
 }
 
 void PatternDetector::getMatches(const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches)
+{
+    getMatches(*m_matcher, queryDescriptors, matches);
+}
+
+void PatternDetector::getMatches(cv::DescriptorMatcher& matcher, const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches)
 {
     matches.clear();
 
-    if (enableRatioTest)
+    // To avoid NaN's when best match has zero distance we will use inversed ratio. 
+    const float minRatio = 1.f / 1.5f;
+
+    // Binary matcher does ratio test and cross-check in a single pass without intermediate knn matches
+    HammingMatcher* hammingMatcher = dynamic_cast<HammingMatcher*>(&matcher);
+    if (hammingMatcher)
+    {
+        hammingMatcher->matchFused(queryDescriptors, matches, enableRatioTest ? minRatio : 1.f);
+    }
+    else if (enableRatioTest)
     {
-        // To avoid NaN's when best match has zero distance we will use inversed ratio. 
-        const float minRatio = 1.f / 1.5f;
-        
         // KNN match will return 2 nearest matches for each query descriptor
-        m_matcher->knnMatch(queryDescriptors, m_knnMatches, 2);
+        matcher.knnMatch(queryDescriptors, m_knnMatches, 2);
 
         for (size_t i=0; i<m_knnMatches.size(); i++)
         {
@@ -236,17 +1020,34 @@ void PatternDetector::getMatches(const cv::Mat& queryDescriptors, std::vector<cv
     else
     {
         // Perform regular match
-        m_matcher->match(queryDescriptors, matches);
+        matcher.match(queryDescriptors, matches);
+    }
+}
+
+void PatternDetector::setInliers(const std::vector<cv::DMatch>& matches,
+    const std::vector<cv::KeyPoint>& queryKeypoints,
+    const std::vector<cv::KeyPoint>& trainKeypoints,
+    PatternTrackingInfo& info)
+{
+    info.patternInliers.resize(matches.size());
+    info.frameInliers.resize(matches.size());
+
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        info.patternInliers[i] = trainKeypoints[matches[i].trainIdx].pt;
+        info.frameInliers[i]   = queryKeypoints[matches[i].queryIdx].pt;
     }
 }
 
 bool PatternDetector::refineMatchesWithHomography
     (
+    HomographyEstimator& estimator,
     const std::vector<cv::KeyPoint>& queryKeypoints,
     const std::vector<cv::KeyPoint>& trainKeypoints, 
     float reprojectionThreshold,
     std::vector<cv::DMatch>& matches,
-    cv::Mat& homography
+    cv::Mat& homography,
+    int* iterationsCount
     )
 {
     const int minNumberMatchesAllowed = 8;
@@ -254,31 +1055,28 @@ bool PatternDetector::refineMatchesWithHomography
     if (matches.size() < minNumberMatchesAllowed)
         return false;
 
-    // Prepare data for cv::findHomography
-    std::vector<cv::Point2f> srcPoints(matches.size());
-    std::vector<cv::Point2f> dstPoints(matches.size());
+    // Find homography matrix and get inliers mask
+    const bool homographyFound = estimator.estimate(queryKeypoints, trainKeypoints, matches, reprojectionThreshold, homography);
 
-    for (size_t i = 0; i < matches.size(); i++)
+    if (iterationsCount)
+        *iterationsCount += estimator.getIterationsCount();
+
+    if (!homographyFound)
     {
-        srcPoints[i] = trainKeypoints[matches[i].trainIdx].pt;
-        dstPoints[i] = queryKeypoints[matches[i].queryIdx].pt;
+        matches.clear();
+        return false;
     }
 
-    // Find homography matrix and get inliers mask
-    std::vector<unsigned char> inliersMask(srcPoints.size());
-    homography = cv::findHomography(srcPoints, 
-                                    dstPoints, 
-                                    CV_FM_RANSAC, 
-                                    reprojectionThreshold, 
-                                    inliersMask);
+    // Keep only inliers (in place, so no temporary vector is needed)
+    const std::vector<unsigned char>& inliersMask = estimator.getInliersMask();
 
-    std::vector<cv::DMatch> inliers;
-    for (size_t i=0; i<inliersMask.size(); i++)
+    size_t inliersCount = 0;
+    for (size_t i = 0; i < inliersMask.size(); i++)
     {
         if (inliersMask[i])
-            inliers.push_back(matches[i]);
+            matches[inliersCount++] = matches[i];
     }
 
-    matches.swap(inliers);
+    matches.resize(inliersCount);
     return matches.size() > minNumberMatchesAllowed;
 }
@@ -4,51 +4,207 @@
 ////////////////////////////////////////////////////////////////////
 // File includes:
 #include "Pattern.hpp"
+#include "PatternModel.hpp"
+#include "BinaryVocabulary.hpp"
+#include "HammingMatcher.hpp"
+#include "LshMatcher.hpp"
+#include "DirectHomographyRefiner.hpp"
+#include "HomographyEstimator.hpp"
+#include "TiledFeatureExtractor.hpp"
+#include "FrameView.hpp"
+#include "AllocationCounter.hpp"
+#include "FrameStats.hpp"
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/nonfree/features2d.hpp>
 
+/**
+ * Detection context: settings and all per-frame state (buffers, tracking, location prior) of finding the patterns
+ * of a PatternModel on a sequence of frames. The model is shared, so a context per thread or per camera stream
+ * costs only its buffers.
+ */
 class PatternDetector
 {
 public:
+    /**
+     * The way the rough homography is refined when enableHomographyRefinement is set.
+     * FeatureRefinement - features are detected and matched again on the warped frame.
+     * DirectRefinement  - the pattern image is aligned to the frame with DirectHomographyRefiner.
+     */
+    enum RefinementMethod
+    {
+        FeatureRefinement,
+        DirectRefinement
+    };
+
     /**
      * Initialize a pattern detector with specified feature detector, descriptor extraction and matching algorithm
+     * For large patterns the exhaustive HammingMatcher can be replaced with approximate LshMatcher.
      */
     PatternDetector
         (
         cv::Ptr<cv::FeatureDetector>     detector  = new cv::ORB(1000), 
         cv::Ptr<cv::DescriptorExtractor> extractor = new cv::FREAK(false, false), 
-        cv::Ptr<cv::DescriptorMatcher>   matcher   = new cv::BFMatcher(cv::NORM_HAMMING, true),
+        cv::Ptr<cv::DescriptorMatcher>   matcher   = new HammingMatcher(true),
         bool enableRatioTest                       = false
         );
 
+    /**
+    * Initialize a detection context of the already trained @model.
+    * The context uses the detector and extractor of the model and its own clone of the model matcher.
+    */
+    explicit PatternDetector(cv::Ptr<const PatternModel> model, bool enableRatioTest = false);
+
     /**
     * 
     */
     void train(const Pattern& pattern);
 
+    /**
+    * Train the detector with several patterns at once.
+    * All patterns share the same matcher, so query features are extracted and matched only once per frame.
+    * A new PatternModel is created with the algorithms of this detector, see getModel.
+    */
+    void train(const std::vector<Pattern>& patterns);
+
+    /**
+    * Find the patterns of @model from now on. Tracking state and location prior are dropped.
+    */
+    void setModel(cv::Ptr<const PatternModel> model);
+
+    /**
+    * Trained model, may be shared with other contexts. Empty before training.
+    */
+    cv::Ptr<const PatternModel> getModel() const;
+
+    /**
+    * Set the vocabulary of binary words used to preselect candidate patterns in findPatterns.
+    * If the vocabulary is not created yet, it's built from the descriptors of all patterns in train().
+    * Must be called before train().
+    */
+    void setVocabulary(cv::Ptr<BinaryVocabulary> vocabulary);
+
     /**
     * Initialize Pattern structure from the input image.
     * This function finds the feature points and extract descriptors for them.
+    * Features are extracted from several renderings of the image (see trainingScalesCount) and mapped back 
+    * to the pattern coordinates.
     */
     void buildPatternFromImage(const cv::Mat& image, Pattern& pattern) const;
 
     /**
-    * Tries to find a @pattern object on given @image. 
+    * Tries to find a @pattern object on given @frame. 
     * The function returns true if succeeded and store the result (pattern 2d location, homography) in @info.
+    * Luma of gray, NV12 and I420 frames is used in place, other formats are converted to gray.
+    */
+    bool findPattern(const FrameView& frame, PatternTrackingInfo& info);
+
+    /**
+    * Tries to find all trained patterns on given @frame.
+    * Features are extracted once, matches are grouped by pattern and each candidate pattern is verified with 
+    * homography estimation in parallel. One entry per found pattern is stored in @infos (rough homography, 
+    * neither refinement nor tracking is performed). The function returns true if at least one pattern was found.
+    */
+    bool findPatterns(const FrameView& frame, std::vector<PatternTrackingInfo>& infos);
+
+    /**
+    * Drop the tracking state, so the next call to findPattern performs full detection.
+    */
+    void resetTracking();
+
+    /**
+    * Number of heap allocations made by the last findPattern call (see AllocationCounter).
+    * All per-frame buffers are members of the detector and keep their capacity, so after the first frames
+    * only the allocations inside OpenCV remain. Always zero when allocation counting is disabled.
+    * Only operator new is counted: cv::Mat data comes from cv::fastMalloc and is not seen, so reallocations
+    * of matrices (e.g. the rough and refined homographies) can't be detected with this counter.
+    */
+    size_t getFrameAllocationsCount() const;
+
+    /**
+    * Statistics of the last findPattern or findPatterns call (also stored in the returned PatternTrackingInfo).
+    * Collected only when EXAMPLE_MARKERLESS_AR_FRAME_STATS is defined, otherwise all zeros.
     */
-    bool findPattern(const cv::Mat& image, PatternTrackingInfo& info);
+    const FrameStats& getFrameStats() const;
+
+    /**
+    * Statistics of the recent findPattern and findPatterns calls.
+    */
+    const FrameStatsHistory& getStatsHistory() const;
 
     bool enableRatioTest;
     bool enableHomographyRefinement;
+    RefinementMethod homographyRefinementMethod;
     float homographyReprojectionThreshold;
 
+    /**
+    * When enabled, after a successful detection the pattern points are followed with pyramidal
+    * optical flow on subsequent frames instead of running detection, extraction and matching.
+    */
+    bool enableTracking;
+
+    /**
+    * Minimal fraction of initially tracked points that have to survive optical flow and RANSAC
+    * to consider tracking successful. Below this value the detector falls back to full detection.
+    */
+    float trackingQualityThreshold;
+
+    /**
+    * When the vocabulary is set and the number of trained patterns exceeds this value, findPatterns
+    * matches the frame only against this number of the best ranked patterns of the vocabulary index.
+    */
+    int maxCandidatePatterns;
+
+    /**
+    * When enabled and the pattern was found on the previous frame, each query descriptor is compared only with
+    * the pattern keypoints that the previous homography projects within guidedSearchRadius pixels from it.
+    */
+    bool enableGuidedMatching;
+    float guidedSearchRadius;
+
+    /**
+    * Pattern training renders the pattern image at trainingScalesCount scales (each next one is trainingScaleStep 
+    * times smaller) and, when trainingTiltAngle (in degrees) is positive, also rotated out of plane by this angle 
+    * in four directions. Features from the renderings let the pattern be found from a distance and at steep angles 
+    * without raising the number of features extracted per frame. At most trainingFeaturesPerView strongest 
+    * features are taken from each rendering (0 - no limit).
+    */
+    int   trainingScalesCount;
+    float trainingScaleStep;
+    float trainingTiltAngle;
+    int   trainingFeaturesPerView;
+
+    /**
+    * When enabled, frame features are extracted on a grid of tiles in parallel with the feature budget
+    * spread evenly over the grid (see TiledFeatureExtractor). Pattern training always uses the full images.
+    */
+    bool enableTiledExtraction;
+
 protected:
 
-    bool extractFeatures(const cv::Mat& image, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) const;
+    /**
+    * Runs full detection pipeline (feature extraction, matching and homography estimation) on the m_grayImg.
+    */
+    bool detectPattern(const cv::Mat& image, PatternTrackingInfo& info);
+
+    bool extractFeatures(const cv::Mat& image, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors);
 
     void getMatches(const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches);
 
+    void getMatches(cv::DescriptorMatcher& matcher, const cv::Mat& queryDescriptors, std::vector<cv::DMatch>& matches);
+
+    /**
+    * Match query descriptors with the first pattern using @homography as the prediction of pattern keypoints location.
+    * Empty @homography means identity. Ratio test (if enabled) and mutual nearest neighbour check are applied.
+    */
+    void getGuidedMatches(const std::vector<cv::KeyPoint>& queryKeypoints, const cv::Mat& queryDescriptors, 
+        const cv::Mat& homography, std::vector<cv::DMatch>& matches);
+
+    /**
+    * Remove matches that don't belong to the train image @imgIdx (only needed when several patterns are trained).
+    */
+    void keepMatchesWithImage(int imgIdx, std::vector<cv::DMatch>& matches) const;
+
     /**
     * Get the gray image from the input image.
     * Function performs necessary color conversion if necessary
@@ -57,30 +213,106 @@ protected:
     static void getGray(const cv::Mat& image, cv::Mat& gray);
 
     /**
-    * 
+    * Estimate the homography with @estimator and keep only the inlier matches.
+    * Number of the generated hypotheses is added to @iterationsCount if given.
     */
     static bool refineMatchesWithHomography(
+        HomographyEstimator& estimator,
         const std::vector<cv::KeyPoint>& queryKeypoints, 
         const std::vector<cv::KeyPoint>& trainKeypoints, 
         float reprojectionThreshold,
         std::vector<cv::DMatch>& matches, 
-        cv::Mat& homography);
+        cv::Mat& homography,
+        int* iterationsCount = 0);
+
+    /**
+    * Store the pattern and frame points of the inlier @matches in @info (used for the pose estimation).
+    */
+    static void setInliers(const std::vector<cv::DMatch>& matches,
+        const std::vector<cv::KeyPoint>& queryKeypoints,
+        const std::vector<cv::KeyPoint>& trainKeypoints,
+        PatternTrackingInfo& info);
+
+    /**
+    * Algorithms of the model, or the ones given to the constructor before training.
+    */
+    const cv::FeatureDetector& getFeatureDetector() const;
+    const cv::DescriptorExtractor& getDescriptorExtractor() const;
+
+    /**
+    * Follows the tracked pattern points from the previous gray frame to the current one
+    * and estimates a new homography from them.
+    * Returns false if tracking quality dropped below trackingQualityThreshold.
+    */
+    bool trackPattern(PatternTrackingInfo& info);
+
+    /**
+    * Initialize the tracking state from the inlier matches of the last detection.
+    */
+    void startTracking(const std::vector<cv::DMatch>& inliers);
 
 private:
+    class PatternVerificationBody;
+
     std::vector<cv::KeyPoint> m_queryKeypoints;
     cv::Mat                   m_queryDescriptors;
     std::vector<cv::DMatch>   m_matches;
     std::vector< std::vector<cv::DMatch> > m_knnMatches;
+    std::vector<cv::KeyPoint> m_warpedKeypoints;
+    std::vector<cv::DMatch>   m_refinedMatches;
+    size_t                    m_frameAllocationsCount;
+    FrameStats                m_stats;
+    FrameStatsHistory         m_statsHistory;
 
-    cv::Mat                   m_grayImg;
+    cv::Mat                   m_grayImg;      // View of the frame luma or m_grayBuffer
+    cv::Mat                   m_grayBuffer;   // Gray image converted from the color frame
     cv::Mat                   m_warpedImg;
     cv::Mat                   m_roughHomography;
     cv::Mat                   m_refinedHomography;
+    HomographyEstimator       m_homographyEstimator;
+    DirectHomographyRefiner   m_directRefiner;
+    TiledFeatureExtractor     m_tiledExtractor;
 
-    Pattern                          m_pattern;
-    cv::Ptr<cv::FeatureDetector>     m_detector;
+    bool                      m_isTracking;
+    size_t                    m_initialTrackedCount;
+    cv::Mat                   m_prevGrayImg;
+    std::vector<cv::Point2f>  m_trackedPatternPoints;
+    std::vector<cv::Point2f>  m_trackedPoints;
+    std::vector<cv::Point2f>  m_nextTrackedPoints;
+    std::vector<unsigned char> m_trackingStatus;
+    std::vector<float>        m_trackingError;
+    cv::Mat                   m_trackedHomography;
+
+    bool                      m_hasPrevHomography;
+    cv::Mat                   m_prevHomography;
+    std::vector<cv::Point2f>  m_patternPoints;
+    std::vector<cv::Point2f>  m_projectedPoints;
+    std::vector<int>          m_gridCells;
+    std::vector<int>          m_gridStarts;
+    std::vector<int>          m_gridCursor;
+    std::vector<int>          m_gridItems;
+    std::vector<int>          m_trainBestDistance;
+    std::vector<int>          m_trainBestQuery;
+
+    std::vector< std::vector<cv::DMatch> > m_patternMatches;
+    std::vector<int>          m_matchedPatterns;
+    std::vector<int>          m_candidateImages;
+    std::vector<cv::Mat>      m_candidateHomographies;
+    std::vector<unsigned char> m_candidateFound;
+    std::vector<HomographyEstimator> m_candidateEstimators;
+
+    cv::Ptr<const PatternModel>      m_model;
+    cv::Ptr<cv::FeatureDetector>     m_detector;    // Algorithms of the next train(), empty for the model contexts
     cv::Ptr<cv::DescriptorExtractor> m_extractor;
-    cv::Ptr<cv::DescriptorMatcher>   m_matcher;
+    cv::Ptr<cv::DescriptorMatcher>   m_matcher;     // Own clone of the model matcher
+
+    cv::Ptr<BinaryVocabulary>        m_vocabulary;  // Vocabulary of the next train()
+    cv::Ptr<cv::DescriptorMatcher>   m_candidateMatcher;  // Only for the matchers other than HammingMatcher
+    std::vector<int>                 m_queryWords;
+    BowVector                        m_queryBow;
+    IndexQueryBuffers                m_indexBuffers;
+    std::vector<IndexMatch>          m_indexMatches;
+    std::vector<cv::Mat>             m_candidateDescriptors;
 };
 
 #endif
\ No newline at end of file
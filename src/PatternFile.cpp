@@ -0,0 +1,302 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "PatternFile.hpp"
+#include "MappedFile.hpp"
+#include "PatternDetector.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cstring>
+#include <fstream>
+#include <stdint.h>
+
+namespace
+{
+    const char     kMagic[8]          = { 'M', 'A', 'R', 'P', 'A', 'T', 'T', 'N' };
+    const uint32_t kByteOrderMark     = 0x01020304;
+    const uint64_t kSectionAlignment  = 64;
+
+    enum SectionId
+    {
+        KeypointsSection   = 1,
+        DescriptorsSection = 2,
+        Points2dSection    = 3,
+        Points3dSection    = 4,
+        GrayImageSection   = 5,
+        AlignmentSection   = 6    // One per level of the template pyramid, from the finest one
+    };
+
+    struct FileHeader
+    {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;   // Rejects files written on a machine with the other byte order
+        uint32_t headerSize;      // Size of the header and the sections table
+        uint32_t sectionsCount;
+        int32_t  width;           // Pattern size
+        int32_t  height;
+    };
+
+    struct SectionEntry
+    {
+        uint32_t id;
+        int32_t  rows;
+        int32_t  cols;
+        int32_t  type;            // OpenCV type of the matrix elements
+        uint64_t offset;          // From the beginning of the file
+        uint64_t size;            // In bytes
+    };
+
+    struct KeypointRecord
+    {
+        float   x;
+        float   y;
+        float   size;
+        float   angle;
+        float   response;
+        int32_t octave;
+        int32_t classId;
+    };
+
+    inline uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+    }
+
+    inline uint64_t matrixSize(const cv::Mat& matrix)
+    {
+        return static_cast<uint64_t>(matrix.rows) * matrix.cols * matrix.elemSize();
+    }
+}
+
+bool PatternFile::save(const std::string& path, const Pattern& pattern)
+{
+    // Keypoints are stored with fixed layout, independent from cv::KeyPoint
+    std::vector<KeypointRecord> keypoints(pattern.keypoints.size());
+    for (size_t i = 0; i < keypoints.size(); i++)
+    {
+        const cv::KeyPoint& kp = pattern.keypoints[i];
+
+        keypoints[i].x        = kp.pt.x;
+        keypoints[i].y        = kp.pt.y;
+        keypoints[i].size     = kp.size;
+        keypoints[i].angle    = kp.angle;
+        keypoints[i].response = kp.response;
+        keypoints[i].octave   = kp.octave;
+        keypoints[i].classId  = kp.class_id;
+    }
+
+    std::vector<uint32_t> ids;
+    std::vector<cv::Mat> matrices;
+
+    ids.push_back(KeypointsSection);
+    matrices.push_back(keypoints.empty() ? cv::Mat() : cv::Mat(static_cast<int>(keypoints.size()), sizeof(KeypointRecord), CV_8UC1, &keypoints[0]));
+    ids.push_back(DescriptorsSection);
+    matrices.push_back(pattern.descriptors);
+    ids.push_back(Points2dSection);
+    matrices.push_back(pattern.points2d.empty() ? cv::Mat() : cv::Mat(pattern.points2d, false));
+    ids.push_back(Points3dSection);
+    matrices.push_back(pattern.points3d.empty() ? cv::Mat() : cv::Mat(pattern.points3d, false));
+    ids.push_back(GrayImageSection);
+    matrices.push_back(pattern.grayImg);
+
+    // Optional template pyramid, an empty level would end it on load
+    for (size_t i = 0; i < pattern.alignmentLevels.size() && !pattern.alignmentLevels[i].empty(); i++)
+    {
+        ids.push_back(AlignmentSection);
+        matrices.push_back(pattern.alignmentLevels[i]);
+    }
+
+    // Layout of the file: header, sections table, aligned sections
+    std::vector<SectionEntry> sections;
+    std::vector<const cv::Mat*> sectionData;
+
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        if (matrices[i].empty())
+            continue;
+
+        SectionEntry entry;
+        entry.id     = ids[i];
+        entry.rows   = matrices[i].rows;
+        entry.cols   = matrices[i].cols;
+        entry.type   = matrices[i].type();
+        entry.offset = 0;
+        entry.size   = matrixSize(matrices[i]);
+
+        sections.push_back(entry);
+        sectionData.push_back(&matrices[i]);
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version       = Version;
+    header.byteOrderMark = kByteOrderMark;
+    header.headerSize    = static_cast<uint32_t>(sizeof(FileHeader) + sections.size() * sizeof(SectionEntry));
+    header.sectionsCount = static_cast<uint32_t>(sections.size());
+    header.width         = pattern.size.width;
+    header.height        = pattern.size.height;
+
+    uint64_t offset = alignOffset(header.headerSize);
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        sections[i].offset = offset;
+        offset = alignOffset(offset + sections[i].size);
+    }
+
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!sections.empty())
+        out.write(reinterpret_cast<const char*>(&sections[0]), sections.size() * sizeof(SectionEntry));
+
+    uint64_t position = header.headerSize;
+    const char padding[kSectionAlignment] = { 0 };
+
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        out.write(padding, static_cast<std::streamsize>(sections[i].offset - position));
+
+        // Matrices may be not continuous, so write them row by row
+        const cv::Mat& matrix = *sectionData[i];
+        const size_t rowSize = matrix.cols * matrix.elemSize();
+
+        for (int r = 0; r < matrix.rows; r++)
+        {
+            out.write(reinterpret_cast<const char*>(matrix.ptr(r)), rowSize);
+        }
+
+        position = sections[i].offset + sections[i].size;
+    }
+
+    return out.good();
+}
+
+bool PatternFile::load(const std::string& path, Pattern& pattern)
+{
+    cv::Ptr<MappedFile> file = new MappedFile();
+    if (!file->open(path) || file->size() < sizeof(FileHeader))
+        return false;
+
+    unsigned char* data = file->data();
+    const uint64_t fileSize = file->size();
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.byteOrderMark != kByteOrderMark ||
+        header.version == 0 || header.version > Version)
+    {
+        return false;
+    }
+
+    if (header.headerSize < sizeof(FileHeader) + static_cast<uint64_t>(header.sectionsCount) * sizeof(SectionEntry) ||
+        header.headerSize > fileSize)
+    {
+        return false;
+    }
+
+    Pattern result;
+    result.size = cv::Size(header.width, header.height);
+
+    for (uint32_t s = 0; s < header.sectionsCount; s++)
+    {
+        SectionEntry entry;
+        std::memcpy(&entry, data + sizeof(FileHeader) + s * sizeof(SectionEntry), sizeof(entry));
+
+        // Validate the section bounds before touching the data
+        if (entry.rows < 0 || entry.cols <= 0 || entry.type != CV_MAT_TYPE(entry.type) ||
+            entry.offset > fileSize || entry.size > fileSize - entry.offset ||
+            entry.size != static_cast<uint64_t>(entry.rows) * entry.cols * CV_ELEM_SIZE(entry.type))
+        {
+            return false;
+        }
+
+        cv::Mat matrix(entry.rows, entry.cols, entry.type, data + entry.offset);
+
+        switch (entry.id)
+        {
+        case KeypointsSection:
+            {
+                if (entry.type != CV_8UC1 || entry.cols != sizeof(KeypointRecord))
+                    return false;
+
+                result.keypoints.resize(entry.rows);
+                for (int i = 0; i < entry.rows; i++)
+                {
+                    KeypointRecord record;
+                    std::memcpy(&record, matrix.ptr(i), sizeof(record));
+
+                    result.keypoints[i] = cv::KeyPoint(record.x, record.y, record.size, record.angle, record.response, record.octave, record.classId);
+                }
+            }
+            break;
+
+        case DescriptorsSection:
+            // Used in place
+            result.descriptors = matrix;
+            break;
+
+        case Points2dSection:
+            if (entry.type != CV_32FC2 || entry.cols != 1)
+                return false;
+
+            result.points2d.assign(matrix.ptr<cv::Point2f>(), matrix.ptr<cv::Point2f>() + entry.rows);
+            break;
+
+        case Points3dSection:
+            if (entry.type != CV_32FC3 || entry.cols != 1)
+                return false;
+
+            result.points3d.assign(matrix.ptr<cv::Point3f>(), matrix.ptr<cv::Point3f>() + entry.rows);
+            break;
+
+        case GrayImageSection:
+            if (entry.type != CV_8UC1)
+                return false;
+
+            // Used in place
+            result.grayImg = matrix;
+            break;
+
+        case AlignmentSection:
+            if (entry.type != CV_32FC1)
+                return false;
+
+            // Levels are stored in order, they are copied to the refiner when the pattern is trained
+            result.alignmentLevels.push_back(matrix);
+            break;
+
+        default:
+            // Unknown section of a newer writer
+            break;
+        }
+    }
+
+    if (result.descriptors.rows != static_cast<int>(result.keypoints.size()))
+        return false;
+
+    // Color image is only used for debug drawing, the gray one is good enough for it
+    result.frame   = result.grayImg;
+    result.storage = file;
+
+    pattern = result;
+    return true;
+}
+
+bool PatternFile::loadOrBuild(const std::string& path, Pattern& pattern)
+{
+    // Trained pattern file is used as is, the image has to be processed
+    if (load(path, pattern))
+        return true;
+
+    cv::Mat patternImage = cv::imread(path);
+    if (patternImage.empty())
+        return false;
+
+    PatternDetector().buildPatternFromImage(patternImage, pattern);
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef EXAMPLE_MARKERLESS_AR_PATTERNFILE_HPP
+#define EXAMPLE_MARKERLESS_AR_PATTERNFILE_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "Pattern.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <string>
+
+/**
+ * Versioned binary file of a trained pattern, so the pattern image doesn't have to be decoded and
+ * processed with the feature detector and extractor on each start.
+ *
+ * The file starts with a header and a table of sections (keypoints, descriptors, 2d and 3d contour points,
+ * the gray pattern image and the optional template pyramid of the direct homography refinement). Each section is aligned to 64 bytes. The file is memory mapped on load, and
+ * descriptors and the gray image refer to the mapped data directly, which makes them usable in place as
+ * matcher train data. Sections with unknown ids are skipped, so readers accept files with extra sections.
+ */
+class PatternFile
+{
+public:
+    static const unsigned int Version = 1;
+
+    /**
+    * Write the @pattern to the file. Returns false if the file can't be written.
+    */
+    static bool save(const std::string& path, const Pattern& pattern);
+
+    /**
+    * Map the file and initialize the @pattern from it. The mapping is released together with the last copy of the pattern.
+    * Returns false if the file can't be read, is not a pattern file or has an unsupported version.
+    */
+    static bool load(const std::string& path, Pattern& pattern);
+
+    /**
+    * Load the pattern file, or build the @pattern from the image at @path if it's not a pattern file
+    * (see PatternDetector::buildPatternFromImage). Returns false if neither can be read.
+    */
+    static bool loadOrBuild(const std::string& path, Pattern& pattern);
+};
+
+#endif
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "PatternModel.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+
+PatternModel::PatternModel(const std::vector<Pattern>& patterns,
+    cv::Ptr<cv::FeatureDetector>     detector,
+    cv::Ptr<cv::DescriptorExtractor> extractor,
+    cv::Ptr<cv::DescriptorMatcher>   matcher,
+    cv::Ptr<BinaryVocabulary>        vocabulary)
+    : m_patterns(patterns)
+    , m_detector(detector)
+    , m_extractor(extractor)
+    , m_matcher(matcher)
+    , m_vocabulary(vocabulary)
+{
+    // Descriptors are never modified, so the matcher shares them with patterns (e.g. mapped from a pattern file):
+    std::vector<cv::Mat> descriptors(m_patterns.size());
+    for (size_t i = 0; i < m_patterns.size(); i++)
+    {
+        descriptors[i] = m_patterns[i].descriptors;
+    }
+
+    m_matcher->clear();
+    m_matcher->add(descriptors);
+    m_matcher->train();
+
+    // Index patterns with the vocabulary of binary words
+    if (!m_vocabulary.empty())
+    {
+        if (m_vocabulary->empty())
+            m_vocabulary->create(descriptors);
+
+        BowVector bow;
+        m_patternIndex.clear(m_vocabulary->size());
+        for (size_t i = 0; i < m_patterns.size(); i++)
+        {
+            m_vocabulary->transform(m_patterns[i].descriptors, bow);
+            m_patternIndex.add(bow);
+        }
+    }
+
+    // Alignment template is built once, from the pattern file data if it's there
+    if (!m_patterns.empty())
+    {
+        const Pattern& first = m_patterns[0];
+        if (!m_directRefiner.setTemplateData(first.size, first.alignmentLevels))
+            m_directRefiner.setTemplate(first.grayImg);
+    }
+
+    // Some extractors (e.g. FREAK) build their sampling tables on the first call, do it before the model is shared
+    if (!m_patterns.empty() && !m_patterns[0].grayImg.empty() && !m_patterns[0].keypoints.empty())
+    {
+        std::vector<cv::KeyPoint> keypoints(m_patterns[0].keypoints.begin(),
+            m_patterns[0].keypoints.begin() + std::min<size_t>(16, m_patterns[0].keypoints.size()));
+
+        cv::Mat warmupDescriptors;
+        m_extractor->compute(m_patterns[0].grayImg, keypoints, warmupDescriptors);
+    }
+}
+
+size_t PatternModel::getPatternsCount() const
+{
+    return m_patterns.size();
+}
+
+const Pattern& PatternModel::getPattern(size_t index) const
+{
+    return m_patterns[index];
+}
+
+const std::vector<Pattern>& PatternModel::getPatterns() const
+{
+    return m_patterns;
+}
+
+const cv::FeatureDetector& PatternModel::getDetector() const
+{
+    return *m_detector;
+}
+
+const cv::DescriptorExtractor& PatternModel::getExtractor() const
+{
+    return *m_extractor;
+}
+
+cv::Ptr<cv::DescriptorMatcher> PatternModel::createMatcher() const
+{
+    return m_matcher->clone(false);
+}
+
+cv::Ptr<cv::DescriptorMatcher> PatternModel::createEmptyMatcher() const
+{
+    return m_matcher->clone(true);
+}
+
+bool PatternModel::hasVocabulary() const
+{
+    return !m_vocabulary.empty();
+}
+
+const BinaryVocabulary& PatternModel::getVocabulary() const
+{
+    return *m_vocabulary;
+}
+
+const InvertedIndex& PatternModel::getPatternIndex() const
+{
+    return m_patternIndex;
+}
+
+const DirectHomographyRefiner& PatternModel::getDirectRefiner() const
+{
+    return m_directRefiner;
+}
@@ -0,0 +1,79 @@
+#ifndef EXAMPLE_MARKERLESS_AR_PATTERNMODEL_HPP
+#define EXAMPLE_MARKERLESS_AR_PATTERNMODEL_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "Pattern.hpp"
+#include "BinaryVocabulary.hpp"
+#include "DirectHomographyRefiner.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Trained patterns together with the feature detector, descriptor extractor and trained matcher they are found with.
+ * The model is immutable after construction and is shared as cv::Ptr<const PatternModel> by any number of detection
+ * contexts (PatternDetector) on any threads without locking: the per-frame buffers live in the contexts, and each
+ * context matches with its own matcher instance created by createMatcher().
+ */
+class PatternModel
+{
+public:
+    /**
+    * Train the model. @matcher is trained with the pattern descriptors and is owned by the model afterwards.
+    * If @vocabulary is given, patterns are indexed with it (the vocabulary is created from the pattern descriptors
+    * if it's empty) and findPatterns matches only against the best ranked patterns.
+    */
+    PatternModel(const std::vector<Pattern>& patterns,
+        cv::Ptr<cv::FeatureDetector>     detector,
+        cv::Ptr<cv::DescriptorExtractor> extractor,
+        cv::Ptr<cv::DescriptorMatcher>   matcher,
+        cv::Ptr<BinaryVocabulary>        vocabulary = cv::Ptr<BinaryVocabulary>());
+
+    size_t getPatternsCount() const;
+    const Pattern& getPattern(size_t index) const;
+    const std::vector<Pattern>& getPatterns() const;
+
+    /**
+    * Detection and extraction don't change the state of the algorithms (lazily built tables are initialized in
+    * the constructor), so they may be called concurrently.
+    */
+    const cv::FeatureDetector& getDetector() const;
+    const cv::DescriptorExtractor& getExtractor() const;
+
+    /**
+    * New matcher for one context. Binary matchers share the trained data with the model, so this is cheap.
+    */
+    cv::Ptr<cv::DescriptorMatcher> createMatcher() const;
+
+    /**
+    * Matcher of the same type without train data (for matching against preselected patterns).
+    */
+    cv::Ptr<cv::DescriptorMatcher> createEmptyMatcher() const;
+
+    bool hasVocabulary() const;
+    const BinaryVocabulary& getVocabulary() const;
+    const InvertedIndex& getPatternIndex() const;
+
+    /**
+    * Refiner with the alignment template of the first pattern (empty if there is none). Contexts copy it,
+    * the copies share the template data.
+    */
+    const DirectHomographyRefiner& getDirectRefiner() const;
+
+private:
+    PatternModel(const PatternModel&);
+    PatternModel& operator=(const PatternModel&);
+
+    std::vector<Pattern>             m_patterns;
+    cv::Ptr<cv::FeatureDetector>     m_detector;
+    cv::Ptr<cv::DescriptorExtractor> m_extractor;
+    cv::Ptr<cv::DescriptorMatcher>   m_matcher;
+    cv::Ptr<BinaryVocabulary>        m_vocabulary;
+    InvertedIndex                    m_patternIndex;
+    DirectHomographyRefiner          m_directRefiner;
+};
+
+#endif
@@ -0,0 +1,288 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "PlanarPoseEstimator.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    cv::Matx33d skew(const cv::Vec3d& v)
+    {
+        return cv::Matx33d(    0, -v[2],  v[1],
+                            v[2],     0, -v[0],
+                           -v[1],  v[0],     0);
+    }
+
+    /**
+     * Rotation matrix of the rotation vector (Rodrigues formula).
+     */
+    cv::Matx33d rotationFromVector(const cv::Vec3d& w)
+    {
+        const double theta = cv::norm(w);
+        if (theta < 1e-12)
+            return cv::Matx33d::eye() + skew(w);
+
+        const cv::Matx33d K = skew(w * (1.0 / theta));
+        return cv::Matx33d::eye() + K * std::sin(theta) + K * K * (1 - std::cos(theta));
+    }
+
+    /**
+     * Closed form pose of the plane z = 0 from the homography @Hn mapping plane points to normalized camera coordinates.
+     * Columns of Hn are [r1 r2 t] up to scale.
+     */
+    bool decomposeHomography(const cv::Matx33d& Hn, cv::Matx33d& R, cv::Vec3d& t)
+    {
+        cv::Vec3d h1(Hn(0,0), Hn(1,0), Hn(2,0));
+        cv::Vec3d h2(Hn(0,1), Hn(1,1), Hn(2,1));
+        cv::Vec3d h3(Hn(0,2), Hn(1,2), Hn(2,2));
+
+        const double norm1 = cv::norm(h1);
+        const double norm2 = cv::norm(h2);
+        if (norm1 < DBL_EPSILON || norm2 < DBL_EPSILON)
+            return false;
+
+        // Rotation columns have unit length, the pattern is in front of the camera
+        double lambda = 2.0 / (norm1 + norm2);
+        if (h3[2] < 0)
+            lambda = -lambda;
+
+        const cv::Vec3d r1 = h1 * lambda;
+        const cv::Vec3d r2 = h2 * lambda;
+        const cv::Vec3d r3 = r1.cross(r2);
+
+        const cv::Matx33d Q(r1[0], r2[0], r3[0],
+                            r1[1], r2[1], r3[1],
+                            r1[2], r2[2], r3[2]);
+
+        // Noise makes r1 and r2 not orthogonal, take the closest rotation
+        cv::Matx31d w;
+        cv::Matx33d u, vt;
+        cv::SVD::compute(Q, w, u, vt);
+
+        R = u * vt;
+        if (cv::determinant(R) < 0)
+            R = u * cv::Matx33d(1, 0, 0, 0, 1, 0, 0, 0, -1) * vt;
+
+        t = h3 * lambda;
+        return true;
+    }
+}
+
+PlanarPoseEstimator::PlanarPoseEstimator(int maxIterations_)
+    : maxIterations(maxIterations_)
+{
+}
+
+bool PlanarPoseEstimator::estimate(const Pattern& pattern, const CameraCalibration& calibration, PatternTrackingInfo& info)
+{
+    if (info.homography.empty() || pattern.points2d.size() < 4 || pattern.points3d.size() < 4)
+    {
+        info.hasPose = false;
+        return false;
+    }
+
+    // Pattern image coordinates are scaled and shifted plane coordinates (see PatternDetector::buildPatternFromImage)
+    const cv::Point2f& p0 = pattern.points2d[0];
+    const cv::Point2f& p2 = pattern.points2d[2];
+    const cv::Point3f& q0 = pattern.points3d[0];
+    const cv::Point3f& q2 = pattern.points3d[2];
+
+    const double sx = (p2.x - p0.x) / (q2.x - q0.x);
+    const double sy = (p2.y - p0.y) / (q2.y - q0.y);
+    const double ox = p0.x - sx * q0.x;
+    const double oy = p0.y - sy * q0.y;
+
+    const cv::Matx33d planeToPattern(sx, 0, ox, 0, sy, oy, 0, 0, 1);
+
+    const double fx = calibration.fx(), fy = calibration.fy();
+    const double cx = calibration.cx(), cy = calibration.cy();
+    const cv::Matx33d inverseIntrinsic(1 / fx, 0, -cx / fx, 0, 1 / fy, -cy / fy, 0, 0, 1);
+
+    // Correspondences: all inliers of the homography or the projected pattern corners
+    const bool useInliers = info.patternInliers.size() >= 4 && info.patternInliers.size() == info.frameInliers.size();
+    const std::vector<cv::Point2f>& patternPoints = useInliers ? info.patternInliers : pattern.points2d;
+    const std::vector<cv::Point2f>& framePoints   = useInliers ? info.frameInliers   : info.points2d;
+
+    if (framePoints.size() != patternPoints.size())
+    {
+        info.hasPose = false;
+        return false;
+    }
+
+    const size_t count = patternPoints.size();
+    m_objectPoints.resize(count);
+    m_imagePoints.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        m_objectPoints[i] = cv::Point3d((patternPoints[i].x - ox) / sx, (patternPoints[i].y - oy) / sy, 0);
+    }
+
+    if (cv::countNonZero(calibration.getDistorsion()) > 0)
+    {
+        cv::undistortPoints(framePoints, m_undistorted, calibration.getIntrinsic(), calibration.getDistorsion());
+        for (size_t i = 0; i < count; i++)
+            m_imagePoints[i] = cv::Point2d(m_undistorted[i].x, m_undistorted[i].y);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+            m_imagePoints[i] = cv::Point2d((framePoints[i].x - cx) / fx, (framePoints[i].y - cy) / fy);
+    }
+
+    // Closed form initial pose
+    cv::Matx33d homography;
+    cv::Mat homographyView(3, 3, CV_64F, homography.val);
+    info.homography.convertTo(homographyView, CV_64F);
+
+    cv::Matx33d R;
+    cv::Vec3d   t;
+    if (!decomposeHomography(inverseIntrinsic * homography * planeToPattern, R, t))
+    {
+        info.hasPose = false;
+        return false;
+    }
+
+    double error = getError(R, t);
+
+    // Previous pose (stored inverted, see below) is a better start when the motion is small
+    if (info.hasPose)
+    {
+        const Transformation previous = info.pose3d.getInverted();
+
+        cv::Matx33d previousR;
+        cv::Vec3d   previousT;
+        for (int row = 0; row < 3; row++)
+        {
+            for (int col = 0; col < 3; col++)
+                previousR(row, col) = previous.r().mat[row][col];
+
+            previousT[row] = previous.t().data[row];
+        }
+
+        const double previousError = getError(previousR, previousT);
+        if (previousError < error)
+        {
+            R     = previousR;
+            t     = previousT;
+            error = previousError;
+        }
+    }
+
+    refine(R, t, error);
+
+    // Copy to transformation matrix
+    for (int col = 0; col < 3; col++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            info.pose3d.r().mat[row][col] = static_cast<float>(R(row, col)); // Copy rotation component
+        }
+        info.pose3d.t().data[col] = static_cast<float>(t[col]); // Copy translation component
+    }
+
+    // Same convention as the PnP based pose: camera location w.r.t. the pattern is inverted to get the pattern pose
+    info.pose3d = info.pose3d.getInverted();
+    info.hasPose = true;
+    return true;
+}
+
+double PlanarPoseEstimator::getError(const cv::Matx33d& R, const cv::Vec3d& t) const
+{
+    double error = 0;
+
+    for (size_t i = 0; i < m_objectPoints.size(); i++)
+    {
+        const cv::Vec3d p = R * cv::Vec3d(m_objectPoints[i].x, m_objectPoints[i].y, 0) + t;
+        if (p[2] < DBL_EPSILON)
+            return DBL_MAX;
+
+        const double dx = p[0] / p[2] - m_imagePoints[i].x;
+        const double dy = p[1] / p[2] - m_imagePoints[i].y;
+        error += dx * dx + dy * dy;
+    }
+
+    return error;
+}
+
+double PlanarPoseEstimator::refine(cv::Matx33d& R, cv::Vec3d& t, double error) const
+{
+    typedef cv::Matx<double, 6, 6> Matx66d;
+    typedef cv::Vec<double, 6>     Vec6d;
+
+    for (int iteration = 0; iteration < maxIterations && error < DBL_MAX; iteration++)
+    {
+        // Normal equations for the update [w, dt]: R' = exp(w) * R, t' = t + dt
+        Matx66d JtJ = Matx66d::zeros();
+        Vec6d   Jtr = Vec6d::all(0);
+
+        for (size_t i = 0; i < m_objectPoints.size(); i++)
+        {
+            const cv::Vec3d q = R * cv::Vec3d(m_objectPoints[i].x, m_objectPoints[i].y, 0);
+            const cv::Vec3d p = q + t;
+
+            const double iz = 1.0 / p[2];
+            const double u  = p[0] * iz;
+            const double v  = p[1] * iz;
+
+            const double ru = u - m_imagePoints[i].x;
+            const double rv = v - m_imagePoints[i].y;
+
+            // Derivatives of the projection by the camera point, the camera point by w is -[q]x and by dt is identity
+            const double du[3] = { iz, 0, -u * iz };
+            const double dv[3] = { 0, iz, -v * iz };
+
+            double ju[6], jv[6];
+            ju[0] = -du[1] * q[2] + du[2] * q[1];
+            ju[1] =  du[0] * q[2] - du[2] * q[0];
+            ju[2] = -du[0] * q[1] + du[1] * q[0];
+            jv[0] = -dv[1] * q[2] + dv[2] * q[1];
+            jv[1] =  dv[0] * q[2] - dv[2] * q[0];
+            jv[2] = -dv[0] * q[1] + dv[1] * q[0];
+
+            for (int k = 0; k < 3; k++)
+            {
+                ju[3 + k] = du[k];
+                jv[3 + k] = dv[k];
+            }
+
+            for (int j = 0; j < 6; j++)
+            {
+                for (int k = j; k < 6; k++)
+                    JtJ(j, k) += ju[j] * ju[k] + jv[j] * jv[k];
+
+                Jtr[j] += ju[j] * ru + jv[j] * rv;
+            }
+        }
+
+        for (int j = 0; j < 6; j++)
+        {
+            for (int k = 0; k < j; k++)
+                JtJ(j, k) = JtJ(k, j);
+        }
+
+        Vec6d delta;
+        if (!cv::solve(JtJ, -Jtr, delta, cv::DECOMP_CHOLESKY))
+            break;
+
+        const cv::Matx33d nextR = rotationFromVector(cv::Vec3d(delta[0], delta[1], delta[2])) * R;
+        const cv::Vec3d   nextT = t + cv::Vec3d(delta[3], delta[4], delta[5]);
+        const double nextError  = getError(nextR, nextT);
+
+        // Stop when the step doesn't improve the fit
+        if (nextError >= error)
+            break;
+
+        R     = nextR;
+        t     = nextT;
+        error = nextError;
+
+        if (cv::norm(delta) < 1e-9)
+            break;
+    }
+
+    return error;
+}
@@ -0,0 +1,52 @@
+#ifndef EXAMPLE_MARKERLESS_AR_PLANARPOSEESTIMATOR_HPP
+#define EXAMPLE_MARKERLESS_AR_PLANARPOSEESTIMATOR_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "Pattern.hpp"
+#include "CameraCalibration.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Estimates the pose of the planar pattern from its homography.
+ * The initial pose is the closed form decomposition of the homography with the camera intrinsics, or the previous
+ * pose of the pattern if it fits the current correspondences better (usually the case for smooth motion).
+ * The pose is then refined with Gauss-Newton steps minimizing the reprojection error of all inlier correspondences
+ * of the homography, so no information is lost by reducing them to the four pattern corners.
+ */
+class PlanarPoseEstimator
+{
+public:
+    PlanarPoseEstimator(int maxIterations = 5);
+
+    /**
+    * Compute @info.pose3d from @info.homography and the inlier correspondences (@info.patternInliers and
+    * @info.frameInliers, or the pattern corners if there are less than 4 inliers).
+    * When @info.hasPose is set, @info.pose3d is the pose of the previous frame and is used as the initial guess.
+    * Returns false (and resets @info.hasPose) if the homography can't be decomposed.
+    */
+    bool estimate(const Pattern& pattern, const CameraCalibration& calibration, PatternTrackingInfo& info);
+
+    int maxIterations;
+
+private:
+    /**
+    * Sum of squared reprojection errors in normalized camera coordinates.
+    */
+    double getError(const cv::Matx33d& R, const cv::Vec3d& t) const;
+
+    /**
+    * Gauss-Newton refinement of @R and @t, returns the final error.
+    */
+    double refine(cv::Matx33d& R, cv::Vec3d& t, double error) const;
+
+    std::vector<cv::Point3d> m_objectPoints;   // Points on the pattern plane (z = 0)
+    std::vector<cv::Point2d> m_imagePoints;    // Observations in normalized camera coordinates
+    std::vector<cv::Point2f> m_undistorted;
+};
+
+#endif
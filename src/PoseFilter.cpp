@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "PoseFilter.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+
+namespace
+{
+    cv::Matx33d toRotation(const cv::Vec3d& rotationVector)
+    {
+        cv::Matx33d R;
+        cv::Rodrigues(rotationVector, R);
+        return R;
+    }
+
+    cv::Vec3d toRotationVector(const cv::Matx33d& R)
+    {
+        cv::Vec3d rotationVector;
+        cv::Rodrigues(R, rotationVector);
+        return rotationVector;
+    }
+
+    /**
+     * Weight of the measurement: from @minWeight for no unexpected motion up to 1 at the @fullSpeed.
+     */
+    double getWeight(double speed, double minWeight, double fullSpeed)
+    {
+        const double k = fullSpeed > 0 ? std::min(1.0, speed / fullSpeed) : 1.0;
+        return minWeight + (1.0 - minWeight) * k;
+    }
+}
+
+PoseFilter::PoseFilter()
+    : minSmoothing(0.3f)
+    , translationSpeed(1.0f)
+    , rotationSpeed(1.0f)
+    , velocityGain(0.2f)
+    , maxPredictionTime(0.1f)
+    , m_initialized(false)
+    , m_timestamp(0)
+{
+}
+
+void PoseFilter::reset()
+{
+    m_initialized = false;
+}
+
+bool PoseFilter::empty() const
+{
+    return !m_initialized;
+}
+
+double PoseFilter::now()
+{
+    return static_cast<double>(cv::getTickCount()) / cv::getTickFrequency();
+}
+
+void PoseFilter::update(const Transformation& pose, double timestamp)
+{
+    // Pose is stored inverted (see PatternTrackingInfo::computePose), filter the pattern to camera transformation
+    const Transformation measured = pose.getInverted();
+
+    cv::Matx33d measuredRotation;
+    cv::Vec3d   measuredPosition;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++)
+            measuredRotation(row, col) = measured.r().mat[row][col];
+
+        measuredPosition[row] = measured.t().data[row];
+    }
+
+    const double dt = timestamp - m_timestamp;
+
+    if (!m_initialized || dt <= 0)
+    {
+        m_position        = measuredPosition;
+        m_rotation        = measuredRotation;
+        m_velocity        = cv::Vec3d(0, 0, 0);
+        m_angularVelocity = cv::Vec3d(0, 0, 0);
+        m_timestamp       = timestamp;
+        m_initialized     = true;
+        return;
+    }
+
+    // Predict the state to the measurement time
+    const cv::Vec3d   predictedPosition = m_position + m_velocity * dt;
+    const cv::Matx33d predictedRotation = toRotation(m_angularVelocity * dt) * m_rotation;
+
+    // Innovation, rotation difference is expressed as a rotation vector
+    const cv::Vec3d positionError = measuredPosition - predictedPosition;
+    const cv::Vec3d rotationError = toRotationVector(measuredRotation * predictedRotation.t());
+
+    const double positionWeight = getWeight(cv::norm(positionError) / dt, minSmoothing, translationSpeed);
+    const double rotationWeight = getWeight(cv::norm(rotationError) / dt, minSmoothing, rotationSpeed);
+
+    m_position        = predictedPosition + positionError * positionWeight;
+    m_velocity        = m_velocity + positionError * (velocityGain / dt);
+    m_rotation        = toRotation(rotationError * rotationWeight) * predictedRotation;
+    m_angularVelocity = m_angularVelocity + rotationError * (velocityGain / dt);
+    m_timestamp       = timestamp;
+}
+
+Transformation PoseFilter::predict(double timestamp) const
+{
+    const double dt = std::max(0.0, std::min<double>(timestamp - m_timestamp, maxPredictionTime));
+
+    const cv::Vec3d   position = m_position + m_velocity * dt;
+    const cv::Matx33d rotation = toRotation(m_angularVelocity * dt) * m_rotation;
+
+    Transformation pose;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++)
+            pose.r().mat[row][col] = static_cast<float>(rotation(row, col));
+
+        pose.t().data[row] = static_cast<float>(position[row]);
+    }
+
+    // Back to the convention of PatternTrackingInfo::pose3d
+    return pose.getInverted();
+}
@@ -0,0 +1,63 @@
+#ifndef EXAMPLE_MARKERLESS_AR_POSEFILTER_HPP
+#define EXAMPLE_MARKERLESS_AR_POSEFILTER_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "GeometryTypes.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+
+/**
+ * Constant velocity filter of the pattern pose.
+ * Position and orientation are tracked with their linear and angular velocities (alpha-beta filter, the steady
+ * state form of the constant velocity Kalman filter, with rotations handled as rotation vectors). The measurement
+ * weight adapts to the motion like in the One Euro filter: small unexpected motion is jitter and is smoothed
+ * strongly, fast motion is followed without lag.
+ * The filtered pose can be extrapolated to the render time, which hides the latency of the pipeline.
+ * Timestamps are in seconds.
+ */
+class PoseFilter
+{
+public:
+    PoseFilter();
+
+    /**
+    * Forget the state, the next measurement is taken as is.
+    */
+    void reset();
+
+    bool empty() const;
+
+    /**
+    * Add the pose measured on the frame captured at @timestamp.
+    */
+    void update(const Transformation& pose, double timestamp);
+
+    /**
+    * Filtered pose extrapolated to @timestamp (at most by maxPredictionTime after the last measurement).
+    */
+    Transformation predict(double timestamp) const;
+
+    /**
+    * Current time in seconds for the timestamps.
+    */
+    static double now();
+
+    float minSmoothing;         // Weight of the measurement when the pattern is still (0..1], lower - less jitter
+    float translationSpeed;     // Unexpected speed (pattern units per second) at which the measurement is fully trusted
+    float rotationSpeed;        // Unexpected angular speed (radians per second) at which the measurement is fully trusted
+    float velocityGain;         // Weight of the measured velocity (0..1]
+    float maxPredictionTime;    // Limit of the extrapolation in seconds
+
+private:
+    bool        m_initialized;
+    double      m_timestamp;
+    cv::Vec3d   m_position;
+    cv::Vec3d   m_velocity;
+    cv::Matx33d m_rotation;
+    cv::Vec3d   m_angularVelocity;
+};
+
+#endif
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "SceneGeometry.hpp"
+
+const float SceneGeometry::axisVertices[axisLinesCount * 2][3] =
+{
+  {0,0,0}, {1,0,0},
+  {0,0,0}, {0,1,0},
+  {0,0,0}, {0,0,1}
+};
+
+const float SceneGeometry::axisColors[axisLinesCount][3] =
+{
+  {1.0f, 0.0f, 0.0f},
+  {0.0f, 1.0f, 0.0f},
+  {0.0f, 0.0f, 1.0f}
+};
+
+const float SceneGeometry::axisLineWidth = 2;
+
+const float SceneGeometry::cubeVertices[cubeFacesCount * 4][3] =
+{
+  // Front Face
+  {-1.0f, -1.0f,  1.0f}, { 1.0f, -1.0f,  1.0f}, { 1.0f,  1.0f,  1.0f}, {-1.0f,  1.0f,  1.0f},
+  // Back Face
+  {-1.0f, -1.0f, -1.0f}, {-1.0f,  1.0f, -1.0f}, { 1.0f,  1.0f, -1.0f}, { 1.0f, -1.0f, -1.0f},
+  // Top Face
+  {-1.0f,  1.0f, -1.0f}, {-1.0f,  1.0f,  1.0f}, { 1.0f,  1.0f,  1.0f}, { 1.0f,  1.0f, -1.0f},
+  // Bottom Face
+  {-1.0f, -1.0f, -1.0f}, { 1.0f, -1.0f, -1.0f}, { 1.0f, -1.0f,  1.0f}, {-1.0f, -1.0f,  1.0f},
+  // Right face
+  { 1.0f, -1.0f, -1.0f}, { 1.0f,  1.0f, -1.0f}, { 1.0f,  1.0f,  1.0f}, { 1.0f, -1.0f,  1.0f},
+  // Left Face
+  {-1.0f, -1.0f, -1.0f}, {-1.0f, -1.0f,  1.0f}, {-1.0f,  1.0f,  1.0f}, {-1.0f,  1.0f, -1.0f}
+};
+
+const float SceneGeometry::cubeNormals[cubeFacesCount][3] =
+{
+  { 0.0f, 0.0f, 1.0f},    // Normal Pointing Towards Viewer
+  { 0.0f, 0.0f,-1.0f},    // Normal Pointing Away From Viewer
+  { 0.0f, 1.0f, 0.0f},    // Normal Pointing Up
+  { 0.0f,-1.0f, 0.0f},    // Normal Pointing Down
+  { 1.0f, 0.0f, 0.0f},    // Normal Pointing Right
+  {-1.0f, 0.0f, 0.0f}     // Normal Pointing Left
+};
+
+const float SceneGeometry::cubeOffset[3] = { 0, 0, 1 };
+
+const float SceneGeometry::cubeScale = 0.25f;
+
+const float SceneGeometry::cubeFillColor[4] = { 0.2f, 0.35f, 0.3f, 0.75f };
+
+const float SceneGeometry::cubeEdgeColor[4] = { 0.2f, 0.65f, 0.3f, 0.35f };
+
+const float SceneGeometry::lightAmbient[4]  = { 0.25f, 0.25f, 0.25f, 1.0f };
+
+const float SceneGeometry::lightDiffuse[4]  = { 0.1f, 0.1f, 0.1f, 1.0f };
+
+const float SceneGeometry::lightPosition[4] = { 0.0f, 0.0f, 2.0f, 1.0f };
+
+Matrix44 SceneGeometry::getCubeAnchor()
+{
+  Matrix44 anchor = Matrix44::identity();
+
+  for (int i = 0; i < 3; i++)
+  {
+    anchor.mat[i][i] = cubeScale;
+    anchor.mat[3][i] = cubeScale * cubeOffset[i];
+  }
+
+  return anchor;
+}
+
+void SceneGeometry::buildProjectionMatrix(const CameraCalibration& calibration, int screen_width, int screen_height, Matrix44& projectionMatrix)
+{
+  float nearPlane = 0.01f;  // Near clipping distance
+  float farPlane  = 100.0f;  // Far clipping distance
+
+  // Camera parameters
+  float f_x = calibration.fx(); // Focal length in x axis
+  float f_y = calibration.fy(); // Focal length in y axis (usually the same?)
+  float c_x = calibration.cx(); // Camera primary point x
+  float c_y = calibration.cy(); // Camera primary point y
+
+  projectionMatrix.data[0] = -2.0f * f_x / screen_width;
+  projectionMatrix.data[1] = 0.0f;
+  projectionMatrix.data[2] = 0.0f;
+  projectionMatrix.data[3] = 0.0f;
+
+  projectionMatrix.data[4] = 0.0f;
+  projectionMatrix.data[5] = 2.0f * f_y / screen_height;
+  projectionMatrix.data[6] = 0.0f;
+  projectionMatrix.data[7] = 0.0f;
+
+  projectionMatrix.data[8] = 2.0f * c_x / screen_width - 1.0f;
+  projectionMatrix.data[9] = 2.0f * c_y / screen_height - 1.0f;
+  projectionMatrix.data[10] = -( farPlane + nearPlane) / ( farPlane - nearPlane );
+  projectionMatrix.data[11] = -1.0f;
+
+  projectionMatrix.data[12] = 0.0f;
+  projectionMatrix.data[13] = 0.0f;
+  projectionMatrix.data[14] = -2.0f * farPlane * nearPlane / ( farPlane - nearPlane );
+  projectionMatrix.data[15] = 0.0f;
+}
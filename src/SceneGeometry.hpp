@@ -0,0 +1,47 @@
+#ifndef EXAMPLE_MARKERLESS_AR_SCENEGEOMETRY_HPP
+#define EXAMPLE_MARKERLESS_AR_SCENEGEOMETRY_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "GeometryTypes.hpp"
+#include "CameraCalibration.hpp"
+
+/**
+ * Models of the augmented scene and the camera projection, shared by the OpenGL renderer (ARDrawingContext)
+ * and the CPU renderer (OffscreenRenderer), so both draw the same scene.
+ * Model coordinates are the pattern coordinates (the pattern lies in the z = 0 plane), colors are RGBA.
+ */
+struct SceneGeometry
+{
+  // Coordinate axis: lines of the unit length along x, y and z
+  static const int   axisLinesCount = 3;
+  static const float axisVertices[axisLinesCount * 2][3];
+  static const float axisColors[axisLinesCount][3];
+  static const float axisLineWidth;
+
+  // Cube: quads of 4 vertices with a normal per quad. The cube is moved by cubeOffset, then scaled by cubeScale
+  static const int   cubeFacesCount = 6;
+  static const float cubeVertices[cubeFacesCount * 4][3];
+  static const float cubeNormals[cubeFacesCount][3];
+  static const float cubeOffset[3];
+  static const float cubeScale;
+  static const float cubeFillColor[4];   // Faces are blended with GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+  static const float cubeEdgeColor[4];   // Edges are drawn over the faces with the same blending
+
+  // Light of the cube, the position is in the pattern coordinates
+  static const float lightAmbient[4];
+  static const float lightDiffuse[4];
+  static const float lightPosition[4];
+
+  /**
+   * Transformation of the cube to the pattern coordinates (column-major, moves by cubeOffset and scales by cubeScale).
+   */
+  static Matrix44 getCubeAnchor();
+
+  /**
+   * OpenGL (column-major) projection matrix of the camera for the viewport of the frame size.
+   */
+  static void buildProjectionMatrix(const CameraCalibration& calibration, int screenWidth, int screenHeight, Matrix44& result);
+};
+
+#endif
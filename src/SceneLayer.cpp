@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "SceneLayer.hpp"
+#include "SceneGeometry.hpp"
+#include "ObjFile.hpp"
+#include "GlBufferFunctions.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <gl/gl.h>
+
+namespace
+{
+    inline const GLvoid* bufferOffset(size_t offset)
+    {
+        return reinterpret_cast<const GLvoid*>(offset);
+    }
+}
+
+SceneLayer::Model::Model(int index)
+    : meshIndex(index)
+    , anchor(Matrix44::identity())
+    , lit(true)
+    , blended(false)
+    , lineWidth(1)
+{
+    color[0] = color[1] = color[2] = color[3] = 1;
+}
+
+SceneLayer::SceneLayer()
+    : m_isInitialized(false)
+    , m_useBuffers(false)
+{
+}
+
+int SceneLayer::addMesh(const Mesh& mesh)
+{
+    const MeshBuffers buffers = { 0, 0, 0, 0 };
+
+    m_meshes.push_back(mesh);
+    m_buffers.push_back(buffers);
+    return static_cast<int>(m_meshes.size()) - 1;
+}
+
+int SceneLayer::loadMesh(const std::string& path)
+{
+    std::map<std::string, int>::const_iterator cached = m_meshFiles.find(path);
+    if (cached != m_meshFiles.end())
+        return cached->second;
+
+    Mesh mesh;
+    if (!ObjFile::load(path, mesh))
+        return -1;
+
+    const int index = addMesh(mesh);
+    m_meshFiles[path] = index;
+    return index;
+}
+
+size_t SceneLayer::addModel(const Model& model)
+{
+    m_models.push_back(model);
+    return m_models.size() - 1;
+}
+
+SceneLayer::Model& SceneLayer::getModel(size_t index)
+{
+    return m_models[index];
+}
+
+size_t SceneLayer::getModelsCount() const
+{
+    return m_models.size();
+}
+
+void SceneLayer::draw()
+{
+    if (!m_isInitialized)
+    {
+        m_useBuffers    = loadGlBufferFunctions();
+        m_isInitialized = true;
+    }
+
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_LINE_BIT);
+
+    // Light is positioned in the pattern coordinates, before the models are anchored
+    glDisable(GL_LIGHT0);
+    glEnable(GL_LIGHT1);
+    glLightfv(GL_LIGHT1, GL_AMBIENT, SceneGeometry::lightAmbient);
+    glLightfv(GL_LIGHT1, GL_DIFFUSE, SceneGeometry::lightDiffuse);
+    glLightfv(GL_LIGHT1, GL_POSITION, SceneGeometry::lightPosition);
+    glEnable(GL_COLOR_MATERIAL);
+    glShadeModel(GL_SMOOTH);
+
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glMatrixMode(GL_MODELVIEW);
+
+    for (size_t i = 0; i < m_models.size(); i++)
+    {
+        const Model& model = m_models[i];
+        if (model.meshIndex < 0 || model.meshIndex >= static_cast<int>(m_meshes.size()))
+            continue;
+
+        if (model.lit)
+            glEnable(GL_LIGHTING);
+        else
+            glDisable(GL_LIGHTING);
+
+        if (model.blended)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+
+        glColor4fv(model.color);
+        glLineWidth(model.lineWidth);
+
+        glPushMatrix();
+        glMultMatrixf(model.anchor.data);
+        drawMesh(model.meshIndex);
+        glPopMatrix();
+    }
+
+    glPopAttrib();
+}
+
+void SceneLayer::releaseBuffers()
+{
+    for (size_t i = 0; i < m_buffers.size(); i++)
+    {
+        MeshBuffers& buffers = m_buffers[i];
+        if (!buffers.vertexBuffer)
+            continue;
+
+        const GLuint ids[2] = { buffers.vertexBuffer, buffers.indexBuffer };
+        glDeleteBuffersPtr(2, ids);
+
+        buffers.vertexBuffer = 0;
+        buffers.indexBuffer  = 0;
+    }
+}
+
+void SceneLayer::uploadMesh(size_t index)
+{
+    const Mesh& mesh = m_meshes[index];
+    MeshBuffers& buffers = m_buffers[index];
+
+    // All attributes in one buffer, so a mesh needs one vertex buffer binding
+    std::vector<float> vertexData(mesh.positions);
+    vertexData.insert(vertexData.end(), mesh.normals.begin(), mesh.normals.end());
+    vertexData.insert(vertexData.end(), mesh.colors.begin(), mesh.colors.end());
+
+    buffers.normalsOffset = mesh.positions.size() * sizeof(float);
+    buffers.colorsOffset  = buffers.normalsOffset + mesh.normals.size() * sizeof(float);
+
+    GLuint ids[2];
+    glGenBuffersPtr(2, ids);
+    buffers.vertexBuffer = ids[0];
+    buffers.indexBuffer  = ids[1];
+
+    glBindBufferPtr(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+    glBufferDataPtr(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), &vertexData[0], GL_STATIC_DRAW);
+
+    glBindBufferPtr(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+    glBufferDataPtr(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
+}
+
+void SceneLayer::drawMesh(size_t index)
+{
+    const Mesh& mesh = m_meshes[index];
+    if (mesh.indices.empty() || mesh.positions.empty())
+        return;
+
+    const GLvoid* positions = &mesh.positions[0];
+    const GLvoid* normals   = mesh.normals.empty() ? 0 : &mesh.normals[0];
+    const GLvoid* colors    = mesh.colors.empty() ? 0 : &mesh.colors[0];
+    const GLvoid* indices   = &mesh.indices[0];
+
+    if (m_useBuffers)
+    {
+        if (!m_buffers[index].vertexBuffer)
+            uploadMesh(index);
+
+        const MeshBuffers& buffers = m_buffers[index];
+        glBindBufferPtr(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+        glBindBufferPtr(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+
+        // Pointers are offsets in the bound buffers
+        positions = bufferOffset(0);
+        normals   = normals ? bufferOffset(buffers.normalsOffset) : 0;
+        colors    = colors ? bufferOffset(buffers.colorsOffset) : 0;
+        indices   = bufferOffset(0);
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, positions);
+
+    if (!mesh.normals.empty())
+    {
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, 0, normals);
+    }
+
+    if (!mesh.colors.empty())
+    {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(3, GL_FLOAT, 0, colors);
+    }
+
+    const GLenum mode = mesh.primitive == Mesh::Lines ? GL_LINES : GL_TRIANGLES;
+    glDrawElements(mode, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, indices);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+
+    if (m_useBuffers)
+    {
+        glBindBufferPtr(GL_ARRAY_BUFFER, 0);
+        glBindBufferPtr(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef EXAMPLE_MARKERLESS_AR_SCENELAYER_HPP
+#define EXAMPLE_MARKERLESS_AR_SCENELAYER_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "GeometryTypes.hpp"
+#include "Mesh.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Retained-mode OpenGL scene of the models anchored to the pattern.
+ * Meshes are added once and uploaded to vertex and index buffer objects on the first draw, then every model
+ * is drawn with one call from the cached buffers. Meshes loaded from files are cached by the path, so many
+ * models may share one mesh. Without buffer object support the meshes are drawn from the client memory.
+ * All functions that touch OpenGL (draw, releaseBuffers) must be called with the context current.
+ */
+class SceneLayer
+{
+public:
+    /**
+    * Instance of a mesh placed relatively to the pattern.
+    */
+    struct Model
+    {
+        explicit Model(int meshIndex = -1);
+
+        int      meshIndex;
+        Matrix44 anchor;      // Model to pattern coordinates (column-major)
+        float    color[4];    // RGBA, used when the mesh has no colors
+        bool     lit;         // Lit by the scene light (see SceneGeometry), the mesh needs normals
+        bool     blended;     // Blended with GL_ONE, GL_ONE_MINUS_SRC_ALPHA, otherwise opaque
+        float    lineWidth;   // Width of the line meshes (pixels)
+    };
+
+    SceneLayer();
+
+    /**
+    * Add the @mesh and return its index. The mesh is uploaded by the next draw.
+    */
+    int addMesh(const Mesh& mesh);
+
+    /**
+    * Read the mesh from the OBJ file (see ObjFile) or return the index of the already loaded one.
+    * Returns -1 if the file can't be read.
+    */
+    int loadMesh(const std::string& path);
+
+    size_t addModel(const Model& model);
+    Model& getModel(size_t index);
+    size_t getModelsCount() const;
+
+    /**
+    * Draw all models. The current modelview matrix must be the pattern pose.
+    */
+    void draw();
+
+    /**
+    * Delete the buffer objects (e.g. before the context is destroyed). Meshes are uploaded again by the next draw.
+    */
+    void releaseBuffers();
+
+private:
+    struct MeshBuffers
+    {
+        unsigned int vertexBuffer;   // Positions, normals and colors one after another
+        unsigned int indexBuffer;
+        size_t       normalsOffset;
+        size_t       colorsOffset;
+    };
+
+    void uploadMesh(size_t index);
+    void drawMesh(size_t index);
+
+    std::vector<Mesh>          m_meshes;
+    std::vector<MeshBuffers>   m_buffers;
+    std::map<std::string, int> m_meshFiles;
+    std::vector<Model>         m_models;
+    bool                       m_isInitialized;   // Buffer object support was checked
+    bool                       m_useBuffers;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef EXAMPLE_MARKERLESS_AR_SPSCQUEUE_HPP
+#define EXAMPLE_MARKERLESS_AR_SPSCQUEUE_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ * Indices grow monotonically and are wrapped with the mask, so a full queue holds all
+ * capacity elements. Producer and consumer indices live on separate cache lines.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    /**
+    * @capacity - minimal number of elements the queue can hold (rounded up to a power of two)
+    */
+    explicit SpscQueue(size_t capacity)
+        : m_head(0)
+        , m_tail(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        m_buffer.resize(size);
+        m_mask = size - 1;
+    }
+
+    /**
+    * Called by the producer only. Returns false if the queue is full.
+    */
+    bool tryPush(const T& value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_buffer.size())
+            return false;
+
+        m_buffer[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * Called by the consumer only. Returns false if the queue is empty.
+    */
+    bool tryPop(T& value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        value = m_buffer[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * Approximate when called concurrently with push or pop.
+    */
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    SpscQueue(const SpscQueue&);
+    SpscQueue& operator=(const SpscQueue&);
+
+    static const size_t kCacheLine = 64;
+
+    std::vector<T>      m_buffer;
+    size_t              m_mask;
+
+    char                m_padding0[kCacheLine];
+    std::atomic<size_t> m_head;   // Written by the consumer
+    char                m_padding1[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_tail;   // Written by the producer
+    char                m_padding2[kCacheLine - sizeof(std::atomic<size_t>)];
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef EXAMPLE_MARKERLESS_AR_STAGETIMINGS_HPP
+#define EXAMPLE_MARKERLESS_AR_STAGETIMINGS_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+
+/**
+ * Stages of the frame processing.
+ */
+enum PipelineStage
+{
+    StageGray,          // Gray image of the frame
+    StageTracking,      // Optical flow tracking of the pattern points
+    StageDetect,        // Keypoints detection
+    StageExtract,       // Descriptors extraction
+    StageMatch,         // Descriptors matching
+    StageRansac,        // Robust homography estimation
+    StageWarp,          // Warping the frame with the rough homography
+    StageRefinement,    // Homography refinement pass (features on the warped frame or direct alignment)
+    StagePose,          // Pose estimation
+
+    StagesCount
+};
+
+inline const char* getStageName(PipelineStage stage)
+{
+    static const char* names[StagesCount] = { "gray", "track", "detect", "extract", "match", "ransac", "warp", "refinement", "pose" };
+    return names[stage];
+}
+
+/**
+ * Time spent in each stage on one frame (seconds).
+ * Stages don't nest: a stage started while another one is running is counted in the outer one (e.g. matching
+ * in the refinement pass is the refinement time), so the stage times add up to the processing time.
+ */
+class StageTimings
+{
+public:
+    StageTimings()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (int i = 0; i < StagesCount; i++)
+            m_seconds[i] = 0;
+
+        m_activeStage = StagesCount;
+    }
+
+    double get(PipelineStage stage) const
+    {
+        return m_seconds[stage];
+    }
+
+    double getTotal() const
+    {
+        double total = 0;
+        for (int i = 0; i < StagesCount; i++)
+            total += m_seconds[i];
+
+        return total;
+    }
+
+    void add(const StageTimings& other)
+    {
+        for (int i = 0; i < StagesCount; i++)
+            m_seconds[i] += other.m_seconds[i];
+    }
+
+private:
+    friend class ScopedStageTimer;
+
+    double m_seconds[StagesCount];
+    int    m_activeStage;
+};
+
+/**
+ * Adds the time from the construction to stop() or destruction to the @stage of @timings.
+ * Does nothing if @timings is null or another stage is already running.
+ * Without EXAMPLE_MARKERLESS_AR_FRAME_STATS the timer is empty and compiles to nothing.
+ */
+class ScopedStageTimer
+{
+public:
+#ifdef EXAMPLE_MARKERLESS_AR_FRAME_STATS
+    ScopedStageTimer(StageTimings* timings, PipelineStage stage)
+        : m_timings(timings && timings->m_activeStage == StagesCount ? timings : 0)
+        , m_stage(stage)
+        , m_start(0)
+    {
+        if (m_timings)
+        {
+            m_timings->m_activeStage = stage;
+            m_start = cv::getTickCount();
+        }
+    }
+
+    ~ScopedStageTimer()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (!m_timings)
+            return;
+
+        m_timings->m_seconds[m_stage] += static_cast<double>(cv::getTickCount() - m_start) / cv::getTickFrequency();
+        m_timings->m_activeStage = StagesCount;
+        m_timings = 0;
+    }
+#else
+    ScopedStageTimer(StageTimings*, PipelineStage)
+    {
+    }
+
+    void stop()
+    {
+    }
+#endif
+
+private:
+    ScopedStageTimer(const ScopedStageTimer&);
+    ScopedStageTimer& operator=(const ScopedStageTimer&);
+
+#ifdef EXAMPLE_MARKERLESS_AR_FRAME_STATS
+    StageTimings* m_timings;
+    PipelineStage m_stage;
+    int64         m_start;
+#endif
+};
+
+#endif
@@ -0,0 +1,183 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "ThreadedVideoProcessor.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    // Idle stages wait for input with short sleeps instead of blocking primitives
+    inline void waitForInput()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+ThreadedVideoProcessor::ThreadedVideoProcessor(cv::VideoCapture& capture, ARPipeline& pipeline, ARDrawingContext& drawingCtx,
+    OverlayFunction overlay, KeyFunction keyHandler, size_t framesCount)
+    : m_capture(capture)
+    , m_pipeline(pipeline)
+    , m_drawingCtx(drawingCtx)
+    , m_overlay(overlay)
+    , m_keyHandler(keyHandler)
+    , m_frames(framesCount)
+    , m_captured(framesCount)
+    , m_detected(framesCount)
+    , m_recycledByDetection(framesCount)
+    , m_recycledByRendering(framesCount)
+    , m_keys(16)
+    , m_stop(false)
+    , m_captureFinished(false)
+    , m_detectionFinished(false)
+    , m_droppedFrames(0)
+{
+    CV_Assert(framesCount >= 3);
+}
+
+size_t ThreadedVideoProcessor::getDroppedFramesCount() const
+{
+    return m_droppedFrames;
+}
+
+ThreadedVideoProcessor::Frame* ThreadedVideoProcessor::takeLatest(SpscQueue<Frame*>& queue, SpscQueue<Frame*>& recycled)
+{
+    Frame* latest = 0;
+    Frame* frame  = 0;
+
+    while (queue.tryPop(frame))
+    {
+        if (latest)
+        {
+            // Queues can hold the whole pool, so pushing never fails
+            recycled.tryPush(latest);
+            m_droppedFrames++;
+        }
+
+        latest = frame;
+    }
+
+    return latest;
+}
+
+void ThreadedVideoProcessor::captureLoop()
+{
+    // Capture thread owns all frames that are not in flight
+    std::vector<Frame*> freeFrames;
+    for (size_t i = 0; i < m_frames.size(); i++)
+    {
+        freeFrames.push_back(&m_frames[i]);
+    }
+
+    while (!m_stop)
+    {
+        Frame* frame = 0;
+        while (m_recycledByDetection.tryPop(frame))
+            freeFrames.push_back(frame);
+        while (m_recycledByRendering.tryPop(frame))
+            freeFrames.push_back(frame);
+
+        // All frames are in flight, wait for the other stages
+        if (freeFrames.empty())
+        {
+            waitForInput();
+            continue;
+        }
+
+        frame = freeFrames.back();
+        freeFrames.pop_back();
+
+        // Decoding into the pooled image reuses its buffer
+        if (!m_capture.read(frame->image) || frame->image.empty())
+            break;
+
+        frame->timestamp = PoseFilter::now();
+
+        m_captured.tryPush(frame);
+    }
+
+    m_captureFinished = true;
+}
+
+void ThreadedVideoProcessor::detectionLoop()
+{
+    while (!m_stop)
+    {
+        // Settings are changed only between the frames and never during the background detection
+        int keyCode = 0;
+        while (m_keys.tryPop(keyCode))
+        {
+            m_pipeline.waitForDetection();
+            if (m_keyHandler(keyCode, m_pipeline.m_patternDetector))
+                m_stop = true;
+        }
+
+        Frame* frame = takeLatest(m_captured, m_recycledByDetection);
+        if (!frame)
+        {
+            if (m_captureFinished && m_captured.empty())
+                break;
+
+            waitForInput();
+            continue;
+        }
+
+        // Find a pattern and update it's detection status and pose:
+        frame->patternFound = m_pipeline.processFrame(frame->image, frame->timestamp);
+        frame->pose         = m_pipeline.getPatternLocation();
+        frame->poseFilter   = m_pipeline.getPoseFilter();
+
+        // Overlay shows the settings the frame was processed with
+        m_overlay(m_pipeline.m_patternDetector, frame->overlayText);
+
+        m_detected.tryPush(frame);
+    }
+
+    m_detectionFinished = true;
+}
+
+void ThreadedVideoProcessor::run()
+{
+    m_stop = false;
+    m_captureFinished = false;
+    m_detectionFinished = false;
+
+    std::thread captureThread(&ThreadedVideoProcessor::captureLoop, this);
+    std::thread detectionThread(&ThreadedVideoProcessor::detectionLoop, this);
+
+    while (!m_stop)
+    {
+        Frame* frame = takeLatest(m_detected, m_recycledByRendering);
+
+        if (frame)
+        {
+            // Set a new camera frame and the pattern pose:
+            m_drawingCtx.updateBackground(frame->image);
+            m_drawingCtx.setOverlayText(frame->overlayText);
+            m_drawingCtx.isPatternPresent = frame->patternFound;
+            m_drawingCtx.patternPose      = frame->patternFound ? frame->poseFilter.predict(PoseFilter::now()) : frame->pose;
+
+            // Background is copied by the drawing context, so the frame can be captured again
+            m_recycledByRendering.tryPush(frame);
+
+            // Request redraw of the window:
+            m_drawingCtx.updateWindow();
+        }
+        else if (m_detectionFinished && m_detected.empty())
+        {
+            break;
+        }
+
+        // Read the keyboard input (also keeps the window responsive while waiting for frames):
+        int keyCode = cv::waitKey(1);
+        if (keyCode >= 0)
+            m_keys.tryPush(keyCode);
+    }
+
+    m_stop = true;
+
+    captureThread.join();
+    detectionThread.join();
+}
@@ -0,0 +1,95 @@
+#ifndef EXAMPLE_MARKERLESS_AR_THREADEDVIDEOPROCESSOR_HPP
+#define EXAMPLE_MARKERLESS_AR_THREADEDVIDEOPROCESSOR_HPP
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "ARPipeline.hpp"
+#include "ARDrawingContext.hpp"
+#include "SpscQueue.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * Processes a video with capture, detection and rendering running concurrently.
+ * Capture and detection have their own threads, rendering runs on the calling (GUI) thread.
+ * Frames come from a fixed pool and travel between the stages through lock-free single-producer/single-consumer
+ * queues, finished frames are returned to the capture thread for reuse. Detection and rendering always take
+ * the newest available frame and recycle the older ones, so throughput is limited by the slowest stage and
+ * the latency doesn't grow when a stage falls behind. The remaining latency is hidden by rendering the pattern
+ * pose extrapolated by the pose filter from the capture time of the frame to the render time.
+ */
+class ThreadedVideoProcessor
+{
+public:
+    /**
+    * Fills the lines of the information overlay drawn over the processed frame (called on the detection thread).
+    */
+    typedef void (*OverlayFunction)(const PatternDetector& detector, std::vector<std::string>& lines);
+
+    /**
+    * Applies the pressed key to the detector settings and returns true if processing should be stopped
+    * (called on the detection thread, so settings never change during detection).
+    */
+    typedef bool (*KeyFunction)(int keyCode, PatternDetector& detector);
+
+    /**
+    * @framesCount - size of the frame pool (at least 3: one frame for each stage)
+    */
+    ThreadedVideoProcessor(cv::VideoCapture& capture, ARPipeline& pipeline, ARDrawingContext& drawingCtx,
+        OverlayFunction overlay, KeyFunction keyHandler, size_t framesCount = 4);
+
+    /**
+    * Process the video until it ends or the key handler requests to stop.
+    */
+    void run();
+
+    /**
+    * Number of frames skipped by detection or rendering because a newer frame was available.
+    */
+    size_t getDroppedFramesCount() const;
+
+private:
+    struct Frame
+    {
+        cv::Mat        image;
+        double         timestamp;      // Capture time (see PoseFilter::now)
+        bool           patternFound;
+        Transformation pose;
+        PoseFilter     poseFilter;     // Filter state after the frame was processed
+        std::vector<std::string> overlayText;
+    };
+
+    void captureLoop();
+    void detectionLoop();
+
+    /**
+    * Pop all frames from @queue, return the newest one and pass the older ones to @recycled.
+    */
+    Frame* takeLatest(SpscQueue<Frame*>& queue, SpscQueue<Frame*>& recycled);
+
+    cv::VideoCapture&   m_capture;
+    ARPipeline&         m_pipeline;
+    ARDrawingContext&   m_drawingCtx;
+    OverlayFunction     m_overlay;
+    KeyFunction         m_keyHandler;
+
+    std::vector<Frame>  m_frames;
+
+    SpscQueue<Frame*>   m_captured;              // Capture -> detection
+    SpscQueue<Frame*>   m_detected;              // Detection -> rendering
+    SpscQueue<Frame*>   m_recycledByDetection;   // Detection -> capture
+    SpscQueue<Frame*>   m_recycledByRendering;   // Rendering -> capture
+    SpscQueue<int>      m_keys;                  // Rendering -> detection
+
+    std::atomic<bool>   m_stop;
+    std::atomic<bool>   m_captureFinished;
+    std::atomic<bool>   m_detectionFinished;
+    std::atomic<size_t> m_droppedFrames;
+};
+
+#endif
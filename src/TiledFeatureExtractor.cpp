@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "TiledFeatureExtractor.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    bool isStronger(const cv::KeyPoint& a, const cv::KeyPoint& b)
+    {
+        return a.response > b.response;
+    }
+
+    void shiftKeypoints(std::vector<cv::KeyPoint>& keypoints, cv::Point2f offset)
+    {
+        for (size_t i = 0; i < keypoints.size(); i++)
+        {
+            keypoints[i].pt += offset;
+        }
+    }
+}
+
+/**
+ * Detects keypoints in the extended region of each tile, keeps the ones inside the cell sorted by response.
+ */
+class TiledFeatureExtractor::DetectionBody : public cv::ParallelLoopBody
+{
+public:
+    DetectionBody(TiledFeatureExtractor& owner, const cv::Mat& gray, const cv::FeatureDetector& detector)
+        : m_owner(owner)
+        , m_gray(gray)
+        , m_detector(detector)
+    {
+    }
+
+    virtual void operator()(const cv::Range& range) const
+    {
+        for (int i = range.start; i < range.end; i++)
+        {
+            const cv::Rect& cell   = m_owner.m_cells[i];
+            const cv::Rect& region = m_owner.m_regions[i];
+            std::vector<cv::KeyPoint>& keypoints = m_owner.m_tileKeypoints[i];
+
+            m_detector.detect(m_gray(region), keypoints);
+
+            // Move to the image coordinates and drop keypoints owned by the neighbour tiles
+            size_t kept = 0;
+            for (size_t j = 0; j < keypoints.size(); j++)
+            {
+                cv::KeyPoint kp = keypoints[j];
+                kp.pt.x += region.x;
+                kp.pt.y += region.y;
+
+                if (kp.pt.x >= cell.x && kp.pt.x < cell.x + cell.width &&
+                    kp.pt.y >= cell.y && kp.pt.y < cell.y + cell.height)
+                {
+                    keypoints[kept++] = kp;
+                }
+            }
+
+            keypoints.resize(kept);
+            std::sort(keypoints.begin(), keypoints.end(), isStronger);
+        }
+    }
+
+private:
+    TiledFeatureExtractor&     m_owner;
+    const cv::Mat&             m_gray;
+    const cv::FeatureDetector& m_detector;
+};
+
+/**
+ * Computes descriptors of the selected keypoints of each tile on its extended region.
+ */
+class TiledFeatureExtractor::DescriptionBody : public cv::ParallelLoopBody
+{
+public:
+    DescriptionBody(TiledFeatureExtractor& owner, const cv::Mat& gray, const cv::DescriptorExtractor& extractor)
+        : m_owner(owner)
+        , m_gray(gray)
+        , m_extractor(extractor)
+    {
+    }
+
+    virtual void operator()(const cv::Range& range) const
+    {
+        for (int i = range.start; i < range.end; i++)
+        {
+            const cv::Rect& region = m_owner.m_regions[i];
+            std::vector<cv::KeyPoint>& keypoints = m_owner.m_tileKeypoints[i];
+
+            if (keypoints.empty())
+            {
+                m_owner.m_tileDescriptors[i].release();
+                continue;
+            }
+
+            // Extractor may remove keypoints it can't describe
+            shiftKeypoints(keypoints, cv::Point2f(static_cast<float>(-region.x), static_cast<float>(-region.y)));
+            m_extractor.compute(m_gray(region), keypoints, m_owner.m_tileDescriptors[i]);
+            shiftKeypoints(keypoints, cv::Point2f(static_cast<float>(region.x), static_cast<float>(region.y)));
+        }
+    }
+
+private:
+    TiledFeatureExtractor&         m_owner;
+    const cv::Mat&                 m_gray;
+    const cv::DescriptorExtractor& m_extractor;
+};
+
+TiledFeatureExtractor::TiledFeatureExtractor(int gridCols_, int gridRows_, int tileOverlap_, int maxFeatures_)
+    : gridCols(gridCols_)
+    , gridRows(gridRows_)
+    , tileOverlap(tileOverlap_)
+    , maxFeatures(maxFeatures_)
+{
+}
+
+void TiledFeatureExtractor::buildTiles(cv::Size imageSize)
+{
+    // Cells smaller than the overlap would mostly process their neighbours
+    const int minCellSize = std::max(2 * tileOverlap, 1);
+    const int cols = std::max(1, std::min(gridCols, imageSize.width  / minCellSize));
+    const int rows = std::max(1, std::min(gridRows, imageSize.height / minCellSize));
+
+    m_cells.clear();
+    m_regions.clear();
+
+    const cv::Rect imageRect(0, 0, imageSize.width, imageSize.height);
+
+    for (int r = 0; r < rows; r++)
+    {
+        const int y0 = r * imageSize.height / rows;
+        const int y1 = (r + 1) * imageSize.height / rows;
+
+        for (int c = 0; c < cols; c++)
+        {
+            const int x0 = c * imageSize.width / cols;
+            const int x1 = (c + 1) * imageSize.width / cols;
+
+            const cv::Rect cell(x0, y0, x1 - x0, y1 - y0);
+            const cv::Rect region(x0 - tileOverlap, y0 - tileOverlap, cell.width + 2 * tileOverlap, cell.height + 2 * tileOverlap);
+
+            m_cells.push_back(cell);
+            m_regions.push_back(region & imageRect);
+        }
+    }
+
+    m_tileKeypoints.resize(m_cells.size());
+    m_tileDescriptors.resize(m_cells.size());
+}
+
+void TiledFeatureExtractor::balanceBudget()
+{
+    const size_t tilesCount = m_tileKeypoints.size();
+
+    size_t available = 0;
+    for (size_t i = 0; i < tilesCount; i++)
+        available += m_tileKeypoints[i].size();
+
+    if (maxFeatures <= 0 || available <= static_cast<size_t>(maxFeatures))
+        return;
+
+    const size_t budget = static_cast<size_t>(maxFeatures);
+
+    // Raise the common quota until the budget is filled (tiles with less keypoints give their share to the others)
+    size_t quota = std::max<size_t>(1, budget / tilesCount);
+    size_t total = 0;
+
+    for (;;)
+    {
+        total = 0;
+        size_t saturated = 0;
+        for (size_t i = 0; i < tilesCount; i++)
+        {
+            total += std::min(m_tileKeypoints[i].size(), quota);
+            if (m_tileKeypoints[i].size() > quota)
+                saturated++;
+        }
+
+        if (total >= budget || saturated == 0)
+            break;
+
+        quota += std::max<size_t>(1, (budget - total) / saturated);
+    }
+
+    // Quota is raised by one only when the rest is less than one keypoint per saturated tile,
+    // so the overshoot is smaller than the number of tiles limited by the quota
+    size_t excess = total > budget ? total - budget : 0;
+
+    for (size_t i = 0; i < tilesCount; i++)
+    {
+        std::vector<cv::KeyPoint>& keypoints = m_tileKeypoints[i];
+        size_t count = std::min(keypoints.size(), quota);
+
+        if (excess > 0 && count == quota)
+        {
+            count--;
+            excess--;
+        }
+
+        keypoints.resize(count);
+    }
+}
+
+bool TiledFeatureExtractor::extract(const cv::Mat& gray,
+    const cv::FeatureDetector& detector,
+    const cv::DescriptorExtractor& extractor,
+    std::vector<cv::KeyPoint>& keypoints,
+    cv::Mat& descriptors,
+    StageTimings* timings)
+{
+    assert(!gray.empty());
+    assert(gray.channels() == 1);
+
+    keypoints.clear();
+
+    buildTiles(gray.size());
+    const int tilesCount = static_cast<int>(m_cells.size());
+
+    ScopedStageTimer detectTimer(timings, StageDetect);
+    cv::parallel_for_(cv::Range(0, tilesCount), DetectionBody(*this, gray, detector));
+
+    balanceBudget();
+    detectTimer.stop();
+
+    ScopedStageTimer extractTimer(timings, StageExtract);
+
+    // The first non-empty tile is described on this thread, so the extractor initializes its lazy state before concurrent calls
+    int firstTile = 0;
+    while (firstTile < tilesCount && m_tileKeypoints[firstTile].empty())
+        firstTile++;
+
+    if (firstTile == tilesCount)
+        return false;
+
+    DescriptionBody description(*this, gray, extractor);
+    description(cv::Range(0, firstTile + 1));
+
+    if (firstTile + 1 < tilesCount)
+        cv::parallel_for_(cv::Range(firstTile + 1, tilesCount), description);
+
+    // Merge the tiles
+    int descriptorsCount = 0;
+    int descriptorSize   = 0;
+    int descriptorType   = -1;
+
+    for (int i = 0; i < tilesCount; i++)
+    {
+        const cv::Mat& tileDescriptors = m_tileDescriptors[i];
+        if (tileDescriptors.empty())
+            continue;
+
+        descriptorsCount += tileDescriptors.rows;
+        descriptorSize    = tileDescriptors.cols;
+        descriptorType    = tileDescriptors.type();
+    }
+
+    if (descriptorsCount == 0)
+    {
+        descriptors.release();
+        return false;
+    }
+
+    keypoints.reserve(descriptorsCount);
+
+    // Number of descriptors changes every frame, so they are stored in the rows of the reused buffer
+    if (m_descriptorsStorage.rows < descriptorsCount || m_descriptorsStorage.cols != descriptorSize || m_descriptorsStorage.type() != descriptorType)
+        m_descriptorsStorage.create(std::max(descriptorsCount, m_descriptorsStorage.rows), descriptorSize, descriptorType);
+
+    descriptors = m_descriptorsStorage.rowRange(0, descriptorsCount);
+
+    int row = 0;
+    for (int i = 0; i < tilesCount; i++)
+    {
+        const cv::Mat& tileDescriptors = m_tileDescriptors[i];
+        if (tileDescriptors.empty())
+            continue;
+
+        cv::Mat rows = descriptors.rowRange(row, row + tileDescriptors.rows);
+        tileDescriptors.copyTo(rows);
+        keypoints.insert(keypoints.end(), m_tileKeypoints[i].begin(), m_tileKeypoints[i].end());
+        row += tileDescriptors.rows;
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef EXAMPLE_MARKERLESS_AR_TILEDFEATUREEXTRACTOR_HPP
+#define EXAMPLE_MARKERLESS_AR_TILEDFEATUREEXTRACTOR_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "StageTimings.hpp"
+
+/**
+ * Detects features and computes descriptors on a grid of tiles in parallel.
+ * Each tile is processed on its region extended by tileOverlap pixels, so detector and descriptor have
+ * the same context at the tile borders as on the full image. A keypoint belongs only to the tile whose
+ * (not extended) cell contains it, which removes duplicates found in the overlapping regions.
+ * The feature budget is shared between the tiles: every tile keeps its strongest keypoints up to an equal
+ * quota, the quota of tiles with few features is passed to the others, so the result is spread over the image.
+ *
+ * Detector and descriptor extractor are called concurrently, so they must not modify their state in
+ * detect() and compute() (true for ORB, FAST, BRIEF, SURF and SIFT; FREAK builds its lookup table on the first
+ * call, which is done for the first tile before the others are started).
+ */
+class TiledFeatureExtractor
+{
+public:
+    /**
+    * @maxFeatures - total number of keypoints kept for the image (0 - no limit)
+    */
+    TiledFeatureExtractor(int gridCols = 4, int gridRows = 3, int tileOverlap = 48, int maxFeatures = 1000);
+
+    /**
+    * Returns false if no features were found.
+    * @descriptors refer to the buffer of the extractor (grown to the largest frame and then reused),
+    * they stay valid until the next call. Detection and description times are added to @timings if given.
+    */
+    bool extract(const cv::Mat& gray,
+        const cv::FeatureDetector& detector,
+        const cv::DescriptorExtractor& extractor,
+        std::vector<cv::KeyPoint>& keypoints,
+        cv::Mat& descriptors,
+        StageTimings* timings = 0);
+
+    int gridCols;
+    int gridRows;
+    int tileOverlap;
+    int maxFeatures;
+
+private:
+    class DetectionBody;
+    class DescriptionBody;
+
+    /**
+    * Split the image into cells and their extended regions.
+    */
+    void buildTiles(cv::Size imageSize);
+
+    /**
+    * Limit the number of keypoints in each tile so the total fits into maxFeatures.
+    */
+    void balanceBudget();
+
+    std::vector<cv::Rect>                   m_cells;
+    std::vector<cv::Rect>                   m_regions;
+    std::vector< std::vector<cv::KeyPoint> > m_tileKeypoints;
+    std::vector<cv::Mat>                    m_tileDescriptors;
+    cv::Mat                                 m_descriptorsStorage;
+};
+
+#endif
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "WorkStealingPool.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <algorithm>
+
+namespace
+{
+    // Pool and worker index of the current thread (null for threads outside of any pool)
+    thread_local const WorkStealingPool* tls_pool        = 0;
+    thread_local size_t                  tls_workerIndex = 0;
+}
+
+WorkStealingPool::WorkStealingPool(size_t threadsCount)
+    : m_workers(threadsCount > 0 ? threadsCount : std::max(1u, std::thread::hardware_concurrency()))
+    , m_pendingCount(0)
+    , m_nextWorker(0)
+    , m_stolenCount(0)
+    , m_stop(false)
+{
+    for (size_t i = 0; i < m_workers.size(); i++)
+        m_threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+
+    m_wakeCondition.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+        m_threads[i].join();
+}
+
+void WorkStealingPool::submit(Task* task)
+{
+    const size_t index = tls_pool == this ? tls_workerIndex : m_nextWorker++ % m_workers.size();
+
+    // Counted before it's queued, so the counter never drops below the number of queued tasks
+    m_pendingCount++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index].mutex);
+        m_workers[index].tasks.push_back(task);
+    }
+
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_wakeCondition.notify_one();
+}
+
+size_t WorkStealingPool::getThreadsCount() const
+{
+    return m_workers.size();
+}
+
+size_t WorkStealingPool::getStolenCount() const
+{
+    return m_stolenCount;
+}
+
+bool WorkStealingPool::tryPop(size_t index, Task*& task)
+{
+    Worker& worker = m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    if (worker.tasks.empty())
+        return false;
+
+    task = worker.tasks.front();
+    worker.tasks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::trySteal(size_t index, Task*& task)
+{
+    for (size_t i = 1; i < m_workers.size(); i++)
+    {
+        Worker& victim = m_workers[(index + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (victim.tasks.empty())
+            continue;
+
+        // Oldest task first, so a task rescheduled just now doesn't overtake the ones waiting longer
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        m_stolenCount++;
+        return true;
+    }
+
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index)
+{
+    tls_pool        = this;
+    tls_workerIndex = index;
+
+    while (!m_stop)
+    {
+        Task* task = 0;
+        if (tryPop(index, task) || trySteal(index, task))
+        {
+            m_pendingCount--;
+            task->run();
+            continue;
+        }
+
+        // Nothing to do anywhere, sleep until a task is submitted
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        while (!m_stop && m_pendingCount == 0)
+            m_wakeCondition.wait(lock);
+    }
+
+    tls_pool = 0;
+}
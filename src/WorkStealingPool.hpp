@@ -0,0 +1,79 @@
+#ifndef EXAMPLE_MARKERLESS_AR_WORKSTEALINGPOOL_HPP
+#define EXAMPLE_MARKERLESS_AR_WORKSTEALINGPOOL_HPP
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Thread pool where every worker has its own queue of tasks.
+ * A task submitted from a worker goes to the queue of that worker (the data it touches is likely in its cache),
+ * tasks submitted from other threads are distributed round-robin. Workers run their own tasks in FIFO order and
+ * steal the oldest task of the other queues when they run out of work, so all cores stay busy while the tasks
+ * of one queue are served in the order they came.
+ * Tasks are owned by the caller and must stay alive until they have run.
+ */
+class WorkStealingPool
+{
+public:
+    class Task
+    {
+    public:
+        virtual ~Task()
+        {
+        }
+
+        virtual void run() = 0;
+    };
+
+    /**
+    * @threadsCount - number of workers, 0 - number of hardware threads
+    */
+    explicit WorkStealingPool(size_t threadsCount = 0);
+
+    /**
+    * Stops the workers, tasks that haven't started are not run.
+    */
+    ~WorkStealingPool();
+
+    void submit(Task* task);
+
+    size_t getThreadsCount() const;
+
+    /**
+    * Number of tasks run by a worker other than the one they were queued to.
+    */
+    size_t getStolenCount() const;
+
+private:
+    WorkStealingPool(const WorkStealingPool&);
+    WorkStealingPool& operator=(const WorkStealingPool&);
+
+    struct Worker
+    {
+        std::mutex        mutex;
+        std::deque<Task*> tasks;
+    };
+
+    void workerLoop(size_t index);
+
+    bool tryPop(size_t index, Task*& task);
+    bool trySteal(size_t index, Task*& task);
+
+    std::vector<Worker>      m_workers;
+    std::vector<std::thread> m_threads;
+
+    std::mutex               m_sleepMutex;
+    std::condition_variable  m_wakeCondition;
+    std::atomic<size_t>      m_pendingCount;
+    std::atomic<size_t>      m_nextWorker;
+    std::atomic<size_t>      m_stolenCount;
+    std::atomic<bool>        m_stop;
+};
+
+#endif
@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "ARPipeline.hpp"
+#include "PatternFile.hpp"
+#include "LatencyStats.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    struct BenchOptions
+    {
+        BenchOptions()
+            : maxFrames(0)
+            , warmupFrames(10)
+            , format("json")
+            , enableRefinement(true)
+            , directRefinement(false)
+            , enableTracking(true)
+            , enableTiledExtraction(true)
+        {
+        }
+
+        std::string patternPath;
+        std::string inputPath;
+        int         maxFrames;
+        int         warmupFrames;
+        std::string format;
+        std::string outputPath;
+        bool        enableRefinement;
+        bool        directRefinement;
+        bool        enableTracking;
+        bool        enableTiledExtraction;
+    };
+
+    /**
+     * Frames of a video file or of the sorted images of a directory.
+     */
+    class FrameSource
+    {
+    public:
+        bool open(const std::string& path)
+        {
+            m_next = 0;
+            m_files.clear();
+
+            if (m_capture.open(path))
+                return true;
+
+            std::vector<cv::String> files;
+            cv::glob(path, files);
+            std::sort(files.begin(), files.end());
+
+            m_files.assign(files.begin(), files.end());
+            return !m_files.empty();
+        }
+
+        bool read(cv::Mat& frame)
+        {
+            if (m_capture.isOpened())
+                return m_capture.read(frame) && !frame.empty();
+
+            // Skip the files that are not images
+            while (m_next < m_files.size())
+            {
+                frame = cv::imread(m_files[m_next++]);
+                if (!frame.empty())
+                    return true;
+            }
+
+            return false;
+        }
+
+    private:
+        cv::VideoCapture         m_capture;
+        std::vector<std::string> m_files;
+        size_t                   m_next;
+    };
+
+    bool parseArguments(int argc, const char * argv[], BenchOptions& options)
+    {
+        if (argc < 3)
+            return false;
+
+        options.patternPath = argv[1];
+        options.inputPath   = argv[2];
+
+        for (int i = 3; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "--frames" && hasValue)
+                options.maxFrames = std::atoi(argv[++i]);
+            else if (arg == "--warmup" && hasValue)
+                options.warmupFrames = std::atoi(argv[++i]);
+            else if (arg == "--format" && hasValue)
+                options.format = argv[++i];
+            else if (arg == "--output" && hasValue)
+                options.outputPath = argv[++i];
+            else if (arg == "--no-refinement")
+                options.enableRefinement = false;
+            else if (arg == "--direct")
+                options.directRefinement = true;
+            else if (arg == "--no-tracking")
+                options.enableTracking = false;
+            else if (arg == "--no-tiles")
+                options.enableTiledExtraction = false;
+            else
+                return false;
+        }
+
+        return options.format == "json" || options.format == "csv";
+    }
+
+    void writeReport(std::ostream& out, const BenchOptions& options, const std::vector<std::vector<double> >& stageSamples,
+        const std::vector<double>& totalSamples, size_t foundCount)
+    {
+        const size_t frames = totalSamples.size();
+        const LatencyStats total = LatencyStats::compute(totalSamples);
+        const double fps = total.mean > 0 ? 1000.0 / total.mean : 0;
+
+        if (options.format == "csv")
+        {
+            out << "stage,frames,mean_ms,p50_ms,p95_ms,p99_ms,fps" << std::endl;
+            for (int stage = 0; stage < StagesCount; stage++)
+            {
+                const LatencyStats s = LatencyStats::compute(stageSamples[stage]);
+                out << getStageName(static_cast<PipelineStage>(stage)) << "," << frames << ","
+                    << s.mean << "," << s.p50 << "," << s.p95 << "," << s.p99 << "," << std::endl;
+            }
+
+            out << "total," << frames << "," << total.mean << "," << total.p50 << "," << total.p95 << "," << total.p99 << "," << fps << std::endl;
+            return;
+        }
+
+        out << "{" << std::endl;
+        out << "  \"frames\": " << frames << "," << std::endl;
+        out << "  \"found\": " << foundCount << "," << std::endl;
+        out << "  \"fps\": " << fps << "," << std::endl;
+        out << "  \"stages\": {" << std::endl;
+
+        for (int stage = 0; stage < StagesCount; stage++)
+        {
+            const LatencyStats s = LatencyStats::compute(stageSamples[stage]);
+            out << "    \"" << getStageName(static_cast<PipelineStage>(stage)) << "\": { \"mean_ms\": " << s.mean
+                << ", \"p50_ms\": " << s.p50 << ", \"p95_ms\": " << s.p95 << ", \"p99_ms\": " << s.p99 << " }," << std::endl;
+        }
+
+        out << "    \"total\": { \"mean_ms\": " << total.mean << ", \"p50_ms\": " << total.p50
+            << ", \"p95_ms\": " << total.p95 << ", \"p99_ms\": " << total.p99 << " }" << std::endl;
+        out << "  }" << std::endl;
+        out << "}" << std::endl;
+    }
+}
+
+/**
+ * Headless benchmark of the detection pipeline: runs ARPipeline on a recorded video or a directory of images
+ * and reports per-stage latencies (mean, p50, p95, p99) and the throughput. Frame decoding is not measured.
+ */
+int main(int argc, const char * argv[])
+{
+    CameraCalibration calibration = CameraCalibration::getDefault();
+
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options))
+    {
+        std::cout << "Usage: markerless_ar_bench <pattern image or pattern file> <video file or image directory>" << std::endl;
+        std::cout << "       [--frames N] [--warmup N] [--format json|csv] [--output file]" << std::endl;
+        std::cout << "       [--no-refinement] [--direct] [--no-tracking] [--no-tiles]" << std::endl;
+        return 1;
+    }
+
+#ifndef EXAMPLE_MARKERLESS_AR_FRAME_STATS
+    std::cerr << "Frame statistics are disabled (ENABLE_FRAME_STATS), stage times are not measured" << std::endl;
+#endif
+
+    Pattern pattern;
+    if (!PatternFile::loadOrBuild(options.patternPath, pattern))
+    {
+        std::cerr << "Input image cannot be read" << std::endl;
+        return 2;
+    }
+
+    FrameSource source;
+    if (!source.open(options.inputPath))
+    {
+        std::cerr << "Input video or images cannot be read" << std::endl;
+        return 2;
+    }
+
+    // Synchronous mode: all the detection work is done in processFrame and measured
+    ARPipeline pipeline(pattern, calibration);
+    PatternDetector& detector = pipeline.m_patternDetector;
+    detector.enableHomographyRefinement = options.enableRefinement;
+    detector.homographyRefinementMethod = options.directRefinement ? PatternDetector::DirectRefinement : PatternDetector::FeatureRefinement;
+    detector.enableTracking             = options.enableTracking;
+    detector.enableTiledExtraction      = options.enableTiledExtraction;
+
+    std::vector<std::vector<double> > stageSamples(StagesCount);
+    std::vector<double> totalSamples;
+    size_t foundCount = 0;
+
+    cv::Mat frame;
+    for (int index = 0; options.maxFrames <= 0 || index < options.warmupFrames + options.maxFrames; index++)
+    {
+        if (!source.read(frame))
+            break;
+
+        const int64 start = cv::getTickCount();
+        const bool found = pipeline.processFrame(frame);
+        const double totalMs = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+        if (index < options.warmupFrames)
+            continue;
+
+        const StageTimings& timings = pipeline.getFrameStats().timings;
+        for (int stage = 0; stage < StagesCount; stage++)
+            stageSamples[stage].push_back(timings.get(static_cast<PipelineStage>(stage)) * 1000.0);
+
+        totalSamples.push_back(totalMs);
+        foundCount += found;
+    }
+
+    if (totalSamples.empty())
+    {
+        std::cerr << "No frames were measured (input is shorter than the warmup)" << std::endl;
+        return 3;
+    }
+
+    if (options.outputPath.empty())
+    {
+        writeReport(std::cout, options, stageSamples, totalSamples, foundCount);
+    }
+    else
+    {
+        std::ofstream out(options.outputPath.c_str());
+        if (!out)
+        {
+            std::cerr << "Output file cannot be written" << std::endl;
+            return 3;
+        }
+
+        writeReport(out, options, stageSamples, totalSamples, foundCount);
+    }
+
+    return 0;
+}
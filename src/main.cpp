@@ -2,6 +2,8 @@
 // File includes:
 #include "ARDrawingContext.hpp"
 #include "ARPipeline.hpp"
+#include "PatternFile.hpp"
+#include "ThreadedVideoProcessor.hpp"
 #include "DebugHelpers.hpp"
 
 ////////////////////////////////////////////////////////////////////
@@ -12,39 +14,79 @@
 
 /**
  * Processes a recorded video or live view from web-camera and allows you to adjust homography refinement and 
- * reprojection threshold in runtime.
+ * reprojection threshold in runtime. Capture, detection and rendering run concurrently (see ThreadedVideoProcessor).
  */
-void processVideo(const cv::Mat& patternImage, CameraCalibration& calibration, cv::VideoCapture& capture);
+void processVideo(const Pattern& pattern, CameraCalibration& calibration, cv::VideoCapture& capture, const std::string& modelPath);
 
 /**
  * Processes single image. The processing goes in a loop.
  * It allows you to control the detection process by adjusting homography refinement switch and 
  * reprojection threshold in runtime.
  */
-void processSingleImage(const cv::Mat& patternImage, CameraCalibration& calibration, const cv::Mat& image);
+void processSingleImage(const Pattern& pattern, CameraCalibration& calibration, const cv::Mat& image, const std::string& modelPath);
+
+/**
+ * Anchors the mesh of the OBJ file to the pattern origin (nothing is added for the empty path).
+ * Returns false if the file can't be read.
+ */
+bool addModelFromFile(ARDrawingContext& drawingCtx, const std::string& modelPath);
 
 /**
  * Performs full detection routine on camera frame and draws the scene using drawing context.
  * In addition, this function draw overlay with debug information on top of the AR window.
  * Returns true if processing loop should be stopped; otherwise - false.
  */
-bool processFrame(const cv::Mat& cameraFrame, ARPipeline& pipeline, ARDrawingContext& drawingCtx);
+bool processFrame(const FrameView& cameraFrame, ARPipeline& pipeline, ARDrawingContext& drawingCtx);
+
+/**
+ * Lines of the overlay with the detector settings.
+ */
+void getOverlayText(const PatternDetector& detector, std::vector<std::string>& lines);
+
+/**
+ * Changes the detector settings according to the pressed key.
+ * Returns true if processing loop should be stopped; otherwise - false.
+ */
+bool handleKey(int keyCode, PatternDetector& detector);
 
 int main(int argc, const char * argv[])
 {
-    // Change this calibration to yours:
-    CameraCalibration calibration(526.58037684199849f, 524.65577209994706f, 318.41744018680112f, 202.96659047014398f);
+    // Change the default calibration to yours (see CameraCalibration::getDefault):
+    CameraCalibration calibration = CameraCalibration::getDefault();
     
     if (argc < 2)
     {
         std::cout << "Input image not specified" << std::endl;
-        std::cout << "Usage: markerless_ar_demo <pattern image> [filepath to recorded video or image]" << std::endl;
+        std::cout << "Usage: markerless_ar_demo <pattern image or pattern file> [filepath to recorded video or image] [OBJ model file]" << std::endl;
+        std::cout << "       markerless_ar_demo --train <pattern image> <output pattern file>" << std::endl;
         return 1;
     }
 
-    // Try to read the pattern:
-    cv::Mat patternImage = cv::imread(argv[1]);
-    if (patternImage.empty())
+    // Build the pattern once and store it in the file for the instant startup:
+    if (std::string(argv[1]) == "--train")
+    {
+        cv::Mat patternImage = argc == 4 ? cv::imread(argv[2]) : cv::Mat();
+        if (patternImage.empty())
+        {
+            std::cout << "Input image cannot be read" << std::endl;
+            return 2;
+        }
+
+        Pattern pattern;
+        PatternDetector().buildPatternFromImage(patternImage, pattern);
+
+        if (!PatternFile::save(argv[3], pattern))
+        {
+            std::cout << "Pattern file cannot be written" << std::endl;
+            return 3;
+        }
+
+        return 0;
+    }
+
+    // Try to read the pattern (trained pattern file is used as is, the image has to be processed):
+    Pattern pattern;
+    if (!PatternFile::loadOrBuild(argv[1], pattern))
     {
         std::cout << "Input image cannot be read" << std::endl;
         return 2;
@@ -52,22 +94,23 @@ int main(int argc, const char * argv[])
 
     if (argc == 2)
     {
-        processVideo(patternImage, calibration, cv::VideoCapture());
+        processVideo(pattern, calibration, cv::VideoCapture(), std::string());
     }
-    else if (argc == 3)
+    else if (argc == 3 || argc == 4)
     {
         std::string input = argv[2];
+        std::string modelPath = argc == 4 ? argv[3] : std::string();
         cv::Mat testImage = cv::imread(input);
         if (!testImage.empty())
         {
-            processSingleImage(patternImage, calibration, testImage);
+            processSingleImage(pattern, calibration, testImage, modelPath);
         }
         else 
         {
             cv::VideoCapture cap;
             if (cap.open(input))
             {
-                processVideo(patternImage, calibration, cap);
+                processVideo(pattern, calibration, cap, modelPath);
             }
         }
     }
@@ -80,7 +123,7 @@ int main(int argc, const char * argv[])
     return 0;
 }
 
-void processVideo(const cv::Mat& patternImage, CameraCalibration& calibration, cv::VideoCapture& capture)
+void processVideo(const Pattern& pattern, CameraCalibration& calibration, cv::VideoCapture& capture, const std::string& modelPath)
 {
 	// Grab first frame to get the frame dimensions
 	cv::Mat currentFrame;  
@@ -95,28 +138,25 @@ void processVideo(const cv::Mat& patternImage, CameraCalibration& calibration, c
 
 	cv::Size frameSize(currentFrame.cols, currentFrame.rows);
 
-    ARPipeline pipeline(patternImage, calibration);
+    ARPipeline pipeline(pattern, calibration);
     ARDrawingContext drawingCtx("Markerless AR", frameSize, calibration);
+    if (!addModelFromFile(drawingCtx, modelPath))
+        return;
 
-    bool shouldQuit = false;
-    do
-    {
-        capture >> currentFrame;
-        if (currentFrame.empty())
-        {
-            shouldQuit = true;
-            continue;
-        }
+    // Full detection runs at its own rate, the pose is propagated on every frame
+    pipeline.setAsyncDetection(true);
 
-        shouldQuit = processFrame(currentFrame, pipeline, drawingCtx);
-    } while (!shouldQuit);
+    ThreadedVideoProcessor processor(capture, pipeline, drawingCtx, getOverlayText, handleKey);
+    processor.run();
 }
 
-void processSingleImage(const cv::Mat& patternImage, CameraCalibration& calibration, const cv::Mat& image)
+void processSingleImage(const Pattern& pattern, CameraCalibration& calibration, const cv::Mat& image, const std::string& modelPath)
 {
     cv::Size frameSize(image.cols, image.rows);
-    ARPipeline pipeline(patternImage, calibration);
+    ARPipeline pipeline(pattern, calibration);
     ARDrawingContext drawingCtx("Markerless AR", frameSize, calibration);
+    if (!addModelFromFile(drawingCtx, modelPath))
+        return;
 
     bool shouldQuit = false;
     do
@@ -125,23 +165,34 @@ void processSingleImage(const cv::Mat& patternImage, CameraCalibration& calibrat
     } while (!shouldQuit);
 }
 
-bool processFrame(const cv::Mat& cameraFrame, ARPipeline& pipeline, ARDrawingContext& drawingCtx)
+bool addModelFromFile(ARDrawingContext& drawingCtx, const std::string& modelPath)
 {
-    // Clone image used for background (we will draw overlay on it)
-    cv::Mat img = cameraFrame.clone();
+    if (modelPath.empty())
+        return true;
 
-    // Draw information:
-    if (pipeline.m_patternDetector.enableHomographyRefinement)
-        cv::putText(img, "Pose refinement: On   ('h' to switch off)", cv::Point(10,15), CV_FONT_HERSHEY_PLAIN, 1, CV_RGB(0,200,0));
-    else
-        cv::putText(img, "Pose refinement: Off  ('h' to switch on)",  cv::Point(10,15), CV_FONT_HERSHEY_PLAIN, 1, CV_RGB(0,200,0));
+    // The mesh is uploaded to the vertex buffers by the first draw and then drawn from them
+    int meshIndex = drawingCtx.getScene().loadMesh(modelPath);
+    if (meshIndex < 0)
+    {
+        std::cout << "Model file cannot be read" << std::endl;
+        return false;
+    }
+
+    drawingCtx.getScene().addModel(SceneLayer::Model(meshIndex));
+    return true;
+}
 
-    cv::putText(img, "RANSAC threshold: " + ToString(pipeline.m_patternDetector.homographyReprojectionThreshold) + "( Use'-'/'+' to adjust)", cv::Point(10, 30), CV_FONT_HERSHEY_PLAIN, 1, CV_RGB(0,200,0));
+bool processFrame(const FrameView& cameraFrame, ARPipeline& pipeline, ARDrawingContext& drawingCtx)
+{
+    // Set a new camera frame (the drawing context keeps its own copy):
+    drawingCtx.updateBackground(cameraFrame);
 
-    // Set a new camera frame:
-    drawingCtx.updateBackground(img);
+    // Draw information (the text is drawn over the scene, the frame is not modified):
+    std::vector<std::string> overlayText;
+    getOverlayText(pipeline.m_patternDetector, overlayText);
+    drawingCtx.setOverlayText(overlayText);
 
-    // Find a pattern and update it's detection status:
+    // Find a pattern and update it's detection status (detection reads the frame in place):
     drawingCtx.isPatternPresent = pipeline.processFrame(cameraFrame);
 
     // Update a pattern pose:
@@ -153,20 +204,57 @@ bool processFrame(const cv::Mat& cameraFrame, ARPipeline& pipeline, ARDrawingCon
     // Read the keyboard input:
     int keyCode = cv::waitKey(5); 
 
+    return handleKey(keyCode, pipeline.m_patternDetector);
+}
+
+void getOverlayText(const PatternDetector& detector, std::vector<std::string>& lines)
+{
+    lines.resize(4);
+
+    if (detector.enableHomographyRefinement)
+        lines[0] = "Pose refinement: On   ('h' to switch off)";
+    else
+        lines[0] = "Pose refinement: Off  ('h' to switch on)";
+
+    lines[1] = "RANSAC threshold: " + ToString(detector.homographyReprojectionThreshold) + "( Use'-'/'+' to adjust)";
+
+    if (detector.enableTracking)
+        lines[2] = "Tracking: On   ('t' to switch off)";
+    else
+        lines[2] = "Tracking: Off  ('t' to switch on)";
+
+    if (detector.homographyRefinementMethod == PatternDetector::DirectRefinement)
+        lines[3] = "Refinement method: Direct   ('d' to switch to features)";
+    else
+        lines[3] = "Refinement method: Features ('d' to switch to direct)";
+}
+
+bool handleKey(int keyCode, PatternDetector& detector)
+{
     bool shouldQuit = false;
     if (keyCode == '+' || keyCode == '=')
     {
-        pipeline.m_patternDetector.homographyReprojectionThreshold += 0.2f;
-        pipeline.m_patternDetector.homographyReprojectionThreshold = std::min(10.0f, pipeline.m_patternDetector.homographyReprojectionThreshold);
+        detector.homographyReprojectionThreshold += 0.2f;
+        detector.homographyReprojectionThreshold = std::min(10.0f, detector.homographyReprojectionThreshold);
     }
     else if (keyCode == '-')
     {
-        pipeline.m_patternDetector.homographyReprojectionThreshold -= 0.2f;
-        pipeline.m_patternDetector.homographyReprojectionThreshold = std::max(0.0f, pipeline.m_patternDetector.homographyReprojectionThreshold);
+        detector.homographyReprojectionThreshold -= 0.2f;
+        detector.homographyReprojectionThreshold = std::max(0.0f, detector.homographyReprojectionThreshold);
     }
     else if (keyCode == 'h')
     {
-        pipeline.m_patternDetector.enableHomographyRefinement = !pipeline.m_patternDetector.enableHomographyRefinement;
+        detector.enableHomographyRefinement = !detector.enableHomographyRefinement;
+    }
+    else if (keyCode == 't')
+    {
+        detector.enableTracking = !detector.enableTracking;
+    }
+    else if (keyCode == 'd')
+    {
+        detector.homographyRefinementMethod = detector.homographyRefinementMethod == PatternDetector::DirectRefinement
+            ? PatternDetector::FeatureRefinement
+            : PatternDetector::DirectRefinement;
     }
     else if (keyCode == 27 || keyCode == 'q')
     {
@@ -175,5 +263,3 @@ bool processFrame(const cv::Mat& cameraFrame, ARPipeline& pipeline, ARDrawingCon
 
     return shouldQuit;
 }
-
-
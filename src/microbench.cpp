@@ -0,0 +1,604 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "PatternDetector.hpp"
+#include "Pattern.hpp"
+#include "GeometryTypes.hpp"
+#include "HammingMatcher.hpp"
+#include "PlanarPoseEstimator.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <opencv2/nonfree/features2d.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+    /**
+     * Gives the benchmarks access to the kernels of the detector.
+     */
+    class DetectorKernels : public PatternDetector
+    {
+    public:
+        DetectorKernels(cv::Ptr<cv::FeatureDetector> detector, cv::Ptr<cv::DescriptorExtractor> extractor,
+            cv::Ptr<cv::DescriptorMatcher> matcher, bool ratioTest = false)
+            : PatternDetector(detector, extractor, matcher, ratioTest)
+        {
+        }
+
+        using PatternDetector::getGray;
+        using PatternDetector::extractFeatures;
+        using PatternDetector::getMatches;
+        using PatternDetector::refineMatchesWithHomography;
+    };
+
+    /**
+     * One measured kernel. prepare() restores the inputs the kernel modifies and isn't measured.
+     */
+    class Kernel
+    {
+    public:
+        explicit Kernel(const std::string& name_)
+            : name(name_)
+        {
+        }
+
+        virtual ~Kernel()
+        {
+        }
+
+        virtual void prepare()
+        {
+        }
+
+        virtual void run() = 0;
+
+        std::string name;
+    };
+
+    struct KernelResult
+    {
+        std::string name;
+        double      medianUs;
+        double      minUs;
+        int         iterations;
+    };
+
+    KernelResult measure(Kernel& kernel, int iterations)
+    {
+        const int warmupIterations = std::max(1, iterations / 10);
+
+        std::vector<double> samples;
+        samples.reserve(iterations);
+
+        for (int i = 0; i < warmupIterations + iterations; i++)
+        {
+            kernel.prepare();
+
+            const int64 start = cv::getTickCount();
+            kernel.run();
+            const double us = (cv::getTickCount() - start) * 1e6 / cv::getTickFrequency();
+
+            if (i >= warmupIterations)
+                samples.push_back(us);
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        KernelResult result;
+        result.name       = kernel.name;
+        result.medianUs   = samples[samples.size() / 2];
+        result.minUs      = samples.front();
+        result.iterations = iterations;
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////
+    // Synthetic inputs (fixed seeds, so every run sees the same data)
+
+    cv::Mat createPatternImage()
+    {
+        cv::RNG rng(0x5eed);
+        cv::Mat image(480, 640, CV_8UC3, cv::Scalar::all(128));
+
+        for (int i = 0; i < 300; i++)
+        {
+            const cv::Point center(rng.uniform(0, image.cols), rng.uniform(0, image.rows));
+            const cv::Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+
+            if (i % 2)
+                cv::circle(image, center, rng.uniform(3, 40), color, -1);
+            else
+                cv::rectangle(image, center, center + cv::Point(rng.uniform(-60, 60), rng.uniform(-60, 60)), color, -1);
+        }
+
+        cv::GaussianBlur(image, image, cv::Size(3, 3), 0);
+        return image;
+    }
+
+    cv::Mat getFrameHomography()
+    {
+        return (cv::Mat_<double>(3, 3) << 0.8, 0.1, 60, -0.05, 0.85, 40, 0.0001, 0.0002, 1);
+    }
+
+    cv::Mat createFrame(const cv::Mat& patternImage)
+    {
+        cv::Mat frame(patternImage.size(), patternImage.type(), cv::Scalar::all(90));
+        cv::warpPerspective(patternImage, frame, getFrameHomography(), frame.size(), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT);
+
+        cv::Mat noise(frame.size(), CV_16SC3);
+        cv::RNG(0xf00d).fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(4));
+        cv::add(frame, noise, frame, cv::noArray(), frame.type());
+        return frame;
+    }
+
+    struct FeaturePair
+    {
+        const char* name;
+        cv::Ptr<cv::FeatureDetector>     detector;
+        cv::Ptr<cv::DescriptorExtractor> extractor;
+        cv::Ptr<cv::DescriptorMatcher>   matcher;
+    };
+
+    std::vector<FeaturePair> getFeaturePairs()
+    {
+        FeaturePair pairs[] =
+        {
+            { "orb_freak",   new cv::ORB(1000),                    new cv::FREAK(false, false), new HammingMatcher(true) },
+            { "orb_orb",     new cv::ORB(1000),                    new cv::ORB(1000),           new HammingMatcher(true) },
+            { "fast_brief",  new cv::FastFeatureDetector(20),      new cv::BriefDescriptorExtractor(32), new HammingMatcher(true) },
+            { "brisk_brisk", new cv::BRISK(),                      new cv::BRISK(),             new HammingMatcher(true) },
+            { "surf_surf",   new cv::SurfFeatureDetector(400),     new cv::SurfDescriptorExtractor(), new cv::BFMatcher(cv::NORM_L2, true) }
+        };
+
+        return std::vector<FeaturePair>(pairs, pairs + sizeof(pairs) / sizeof(pairs[0]));
+    }
+
+    ////////////////////////////////////////////////////////////////////
+    // Kernels
+
+    class GrayKernel : public Kernel
+    {
+    public:
+        GrayKernel(const cv::Mat& frame)
+            : Kernel("getGray")
+            , m_frame(frame)
+        {
+        }
+
+        virtual void run()
+        {
+            DetectorKernels::getGray(m_frame, m_gray);
+        }
+
+    private:
+        cv::Mat m_frame;
+        cv::Mat m_gray;
+    };
+
+    class ExtractFeaturesKernel : public Kernel
+    {
+    public:
+        ExtractFeaturesKernel(const FeaturePair& pair, const cv::Mat& gray, bool tiled)
+            : Kernel(std::string("extractFeatures/") + pair.name + (tiled ? "/tiled" : ""))
+            , m_detector(pair.detector, pair.extractor, pair.matcher)
+            , m_gray(gray)
+        {
+            m_detector.enableTiledExtraction = tiled;
+        }
+
+        virtual void run()
+        {
+            m_detector.extractFeatures(m_gray, m_keypoints, m_descriptors);
+        }
+
+    private:
+        DetectorKernels           m_detector;
+        cv::Mat                   m_gray;
+        std::vector<cv::KeyPoint> m_keypoints;
+        cv::Mat                   m_descriptors;
+    };
+
+    class MatchKernel : public Kernel
+    {
+    public:
+        MatchKernel(const Pattern& pattern, const cv::Mat& gray, bool ratioTest)
+            : Kernel(ratioTest ? "getMatches/ratio_test" : "getMatches/no_ratio_test")
+            , m_detector(new cv::ORB(1000), new cv::FREAK(false, false), new HammingMatcher(true), ratioTest)
+        {
+            m_detector.train(pattern);
+            m_detector.extractFeatures(gray, m_keypoints, m_descriptors);
+
+            // Descriptors are returned in the detector buffer, keep them
+            m_descriptors = m_descriptors.clone();
+        }
+
+        virtual void run()
+        {
+            m_detector.getMatches(m_descriptors, m_matches);
+        }
+
+    private:
+        DetectorKernels           m_detector;
+        std::vector<cv::KeyPoint> m_keypoints;
+        cv::Mat                   m_descriptors;
+        std::vector<cv::DMatch>   m_matches;
+    };
+
+    class HomographyKernel : public Kernel
+    {
+    public:
+        HomographyKernel(float inlierRatio, int count = 500)
+            : Kernel(cv::format("refineMatchesWithHomography/inliers_%d%%", cvRound(inlierRatio * 100)))
+        {
+            cv::RNG rng(0xbeef);
+            const cv::Mat H = getFrameHomography();
+
+            std::vector<cv::Point2f> trainPoints(count), queryPoints;
+            for (int i = 0; i < count; i++)
+                trainPoints[i] = cv::Point2f(rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f));
+
+            cv::perspectiveTransform(trainPoints, queryPoints, H);
+
+            for (int i = 0; i < count; i++)
+            {
+                // Inliers get a small localization noise, outliers are anywhere on the frame
+                if (rng.uniform(0.f, 1.f) < inlierRatio)
+                    queryPoints[i] += cv::Point2f(rng.gaussian(0.5), rng.gaussian(0.5));
+                else
+                    queryPoints[i] = cv::Point2f(rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f));
+
+                m_trainKeypoints.push_back(cv::KeyPoint(trainPoints[i], 7));
+                m_queryKeypoints.push_back(cv::KeyPoint(queryPoints[i], 7));
+                m_allMatches.push_back(cv::DMatch(i, i, 0, rng.uniform(10.f, 100.f)));
+            }
+        }
+
+        virtual void prepare()
+        {
+            // Outliers are removed from the matches in place
+            m_matches = m_allMatches;
+        }
+
+        virtual void run()
+        {
+            DetectorKernels::refineMatchesWithHomography(m_estimator, m_queryKeypoints, m_trainKeypoints, 3, m_matches, m_homography);
+        }
+
+    private:
+        HomographyEstimator       m_estimator;
+        std::vector<cv::KeyPoint> m_queryKeypoints;
+        std::vector<cv::KeyPoint> m_trainKeypoints;
+        std::vector<cv::DMatch>   m_allMatches;
+        std::vector<cv::DMatch>   m_matches;
+        cv::Mat                   m_homography;
+    };
+
+    class PoseKernel : public Kernel
+    {
+    public:
+        PoseKernel(const Pattern& pattern, const CameraCalibration& calibration)
+            : Kernel("computePose")
+            , m_pattern(pattern)
+            , m_calibration(calibration)
+        {
+            m_info.homography = getFrameHomography();
+            cv::perspectiveTransform(pattern.points2d, m_info.points2d, m_info.homography);
+
+            cv::RNG rng(0xcafe);
+            const float width  = static_cast<float>(pattern.size.width);
+            const float height = static_cast<float>(pattern.size.height);
+            for (int i = 0; i < 200; i++)
+                m_info.patternInliers.push_back(cv::Point2f(rng.uniform(0.f, width), rng.uniform(0.f, height)));
+
+            cv::perspectiveTransform(m_info.patternInliers, m_info.frameInliers, m_info.homography);
+        }
+
+        virtual void prepare()
+        {
+            // Always from the closed form solution, not from the previous pose
+            m_info.hasPose = false;
+        }
+
+        virtual void run()
+        {
+            // Estimator keeps its buffers between calls, as in ARPipeline
+            m_estimator.estimate(m_pattern, m_calibration, m_info);
+        }
+
+    private:
+        const Pattern&      m_pattern;
+        CameraCalibration   m_calibration;
+        PatternTrackingInfo m_info;
+        PlanarPoseEstimator m_estimator;
+    };
+
+    /**
+     * Geometry operations are too fast to be timed one by one, a sample is a batch of calls.
+     */
+    const int kGeometryBatch = 1000;
+
+    Transformation createTransformation()
+    {
+        cv::Matx33f R;
+        cv::Rodrigues(cv::Vec3f(0.1f, -0.3f, 0.2f), R);
+
+        Transformation transformation;
+        for (int row = 0; row < 3; row++)
+        {
+            for (int col = 0; col < 3; col++)
+                transformation.r().mat[row][col] = R(row, col);
+        }
+
+        transformation.t().data[0] = 0.5f;
+        transformation.t().data[1] = -0.2f;
+        transformation.t().data[2] = 3.0f;
+        return transformation;
+    }
+
+    class InvertedKernel : public Kernel
+    {
+    public:
+        InvertedKernel()
+            : Kernel(cv::format("Transformation::getInverted/x%d", kGeometryBatch))
+            , m_transformation(createTransformation())
+        {
+        }
+
+        virtual void run()
+        {
+            for (int i = 0; i < kGeometryBatch; i++)
+                m_transformation = m_transformation.getInverted();
+        }
+
+    private:
+        Transformation m_transformation;
+    };
+
+    class Mat44Kernel : public Kernel
+    {
+    public:
+        Mat44Kernel()
+            : Kernel(cv::format("Transformation::getMat44/x%d", kGeometryBatch))
+            , m_transformation(createTransformation())
+            , m_sum(0)
+        {
+        }
+
+        virtual void run()
+        {
+            // Results are accumulated, so the calls can't be optimized away
+            for (int i = 0; i < kGeometryBatch; i++)
+                m_sum += m_transformation.getMat44().data[i % 16];
+        }
+
+    private:
+        Transformation m_transformation;
+        float          m_sum;
+    };
+
+    class InvertedRTKernel : public Kernel
+    {
+    public:
+        InvertedRTKernel()
+            : Kernel(cv::format("Matrix44::getInvertedRT/x%d", kGeometryBatch))
+            , m_matrix(createTransformation().getMat44())
+        {
+        }
+
+        virtual void run()
+        {
+            for (int i = 0; i < kGeometryBatch; i++)
+                m_matrix = m_matrix.getInvertedRT();
+        }
+
+    private:
+        Matrix44 m_matrix;
+    };
+
+    ////////////////////////////////////////////////////////////////////
+    // Baseline
+
+    bool loadBaseline(const std::string& path, std::map<std::string, double>& baseline)
+    {
+        std::ifstream in(path.c_str());
+        if (!in)
+            return false;
+
+        // Lines starting with '#' describe the reference machine
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string name;
+            double medianUs;
+            if (fields >> name >> medianUs)
+                baseline[name] = medianUs;
+        }
+
+        return true;
+    }
+
+    bool saveBaseline(const std::string& path, const std::vector<KernelResult>& results)
+    {
+        std::ofstream out(path.c_str());
+        if (!out)
+            return false;
+
+        out << "# Median kernel times in microseconds (markerless_ar_microbench --save-baseline)" << std::endl;
+        for (size_t i = 0; i < results.size(); i++)
+            out << results[i].name << " " << results[i].medianUs << std::endl;
+
+        return true;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: markerless_ar_microbench [--iterations N] [--filter substring]" << std::endl;
+        std::cout << "       [--save-baseline file] [--check-baseline file [--init-baseline]] [--tolerance fraction]" << std::endl;
+    }
+}
+
+/**
+ * Microbenchmarks of the vision kernels and the geometry types on fixed synthetic inputs.
+ * With --check-baseline the median time of every kernel is compared with the stored one (kernel name and median
+ * in microseconds per line, as written by --save-baseline) and the exit code is non-zero if any kernel is slower
+ * than the baseline by more than the tolerance or isn't in the baseline at all. The baseline of the reference machine
+ * is src/microbench_baseline.txt, checked by ctest (see CMakeLists.txt). With --init-baseline a missing baseline
+ * file is written from this run instead, for recording the baseline of a new machine by hand.
+ */
+int main(int argc, const char * argv[])
+{
+    int         iterations = 50;
+    double      tolerance  = 0.3;
+    std::string filter;
+    std::string saveBaselinePath;
+    std::string checkBaselinePath;
+    bool        initBaseline = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--iterations" && hasValue)
+            iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--filter" && hasValue)
+            filter = argv[++i];
+        else if (arg == "--save-baseline" && hasValue)
+            saveBaselinePath = argv[++i];
+        else if (arg == "--check-baseline" && hasValue)
+            checkBaselinePath = argv[++i];
+        else if (arg == "--tolerance" && hasValue)
+            tolerance = std::atof(argv[++i]);
+        else if (arg == "--init-baseline")
+            initBaseline = true;
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!checkBaselinePath.empty() && !loadBaseline(checkBaselinePath, baseline))
+    {
+        if (!initBaseline)
+        {
+            std::cerr << "Baseline file cannot be read" << std::endl;
+            return 2;
+        }
+
+        // Nothing to compare with, this run becomes the baseline
+        std::cout << "Baseline file " << checkBaselinePath << " doesn't exist, it will be created" << std::endl;
+        if (saveBaselinePath.empty())
+            saveBaselinePath = checkBaselinePath;
+        checkBaselinePath.clear();
+    }
+
+    // Kernels run on one thread, so the timings don't depend on the load of the machine as much
+    cv::setNumThreads(1);
+
+    CameraCalibration calibration = CameraCalibration::getDefault();
+
+    const cv::Mat patternImage = createPatternImage();
+    const cv::Mat frame        = createFrame(patternImage);
+
+    cv::Mat gray;
+    cv::cvtColor(frame, gray, CV_BGR2GRAY);
+
+    Pattern pattern;
+    PatternDetector().buildPatternFromImage(patternImage, pattern);
+
+    std::vector<cv::Ptr<Kernel> > kernels;
+    kernels.push_back(new GrayKernel(frame));
+
+    const std::vector<FeaturePair> pairs = getFeaturePairs();
+    for (size_t i = 0; i < pairs.size(); i++)
+    {
+        kernels.push_back(new ExtractFeaturesKernel(pairs[i], gray, false));
+        kernels.push_back(new ExtractFeaturesKernel(pairs[i], gray, true));
+    }
+
+    kernels.push_back(new MatchKernel(pattern, gray, false));
+    kernels.push_back(new MatchKernel(pattern, gray, true));
+
+    const float inlierRatios[] = { 0.9f, 0.5f, 0.25f };
+    for (size_t i = 0; i < sizeof(inlierRatios) / sizeof(inlierRatios[0]); i++)
+        kernels.push_back(new HomographyKernel(inlierRatios[i]));
+
+    kernels.push_back(new PoseKernel(pattern, calibration));
+    kernels.push_back(new InvertedKernel());
+    kernels.push_back(new Mat44Kernel());
+    kernels.push_back(new InvertedRTKernel());
+
+    if (!checkBaselinePath.empty())
+        std::cout << "Checking against " << checkBaselinePath << " with tolerance " << tolerance * 100 << "%" << std::endl;
+
+    std::vector<KernelResult> results;
+    int regressionsCount = 0;
+    int missingCount     = 0;
+
+    std::cout << std::left << std::setw(48) << "kernel" << std::right << std::setw(12) << "median_us" << std::setw(12) << "min_us"
+              << std::setw(12) << "baseline_us" << std::endl;
+
+    for (size_t i = 0; i < kernels.size(); i++)
+    {
+        if (!filter.empty() && kernels[i]->name.find(filter) == std::string::npos)
+            continue;
+
+        const KernelResult result = measure(*kernels[i], iterations);
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(48) << result.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << result.medianUs << std::setw(12) << result.minUs;
+
+        std::map<std::string, double>::const_iterator reference = baseline.find(result.name);
+        if (reference != baseline.end())
+        {
+            std::cout << std::setw(12) << reference->second;
+            if (result.medianUs > reference->second * (1 + tolerance))
+            {
+                std::cout << "  REGRESSION";
+                regressionsCount++;
+            }
+        }
+        else if (!checkBaselinePath.empty())
+        {
+            // Kernel that was never measured can't regress, so it fails the check until it's recorded
+            std::cout << std::setw(12) << "-" << "  NOT IN BASELINE";
+            missingCount++;
+        }
+
+        std::cout << std::endl;
+    }
+
+    if (!saveBaselinePath.empty() && !saveBaseline(saveBaselinePath, results))
+    {
+        std::cerr << "Baseline file cannot be written" << std::endl;
+        return 2;
+    }
+
+    if (regressionsCount > 0)
+    {
+        std::cerr << regressionsCount << " kernel(s) are slower than the baseline by more than " << tolerance * 100 << "%" << std::endl;
+        return 3;
+    }
+
+    if (missingCount > 0)
+    {
+        std::cerr << missingCount << " kernel(s) have no baseline, record them with --save-baseline on the reference machine" << std::endl;
+        return 4;
+    }
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "ARPipeline.hpp"
+#include "OffscreenRenderer.hpp"
+#include "PatternFile.hpp"
+#include "SpscQueue.hpp"
+#include "DebugHelpers.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    struct RenderOptions
+    {
+        RenderOptions()
+            : fourcc("MJPG")
+            , fps(0)
+            , maxFrames(0)
+            , drawOverlay(true)
+        {
+        }
+
+        std::string patternPath;
+        std::string inputPath;
+        std::string outputPath;
+        std::string fourcc;
+        double      fps;
+        int         maxFrames;
+        bool        drawOverlay;
+    };
+
+    bool parseArguments(int argc, const char * argv[], RenderOptions& options)
+    {
+        std::vector<std::string> positional;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "--fourcc" && hasValue)
+                options.fourcc = argv[++i];
+            else if (arg == "--fps" && hasValue)
+                options.fps = std::atof(argv[++i]);
+            else if (arg == "--frames" && hasValue)
+                options.maxFrames = std::atoi(argv[++i]);
+            else if (arg == "--no-overlay")
+                options.drawOverlay = false;
+            else if (arg.compare(0, 2, "--") == 0)
+                return false;
+            else
+                positional.push_back(arg);
+        }
+
+        if (positional.size() != 3 || options.fourcc.size() != 4)
+            return false;
+
+        options.patternPath = positional[0];
+        options.inputPath   = positional[1];
+        options.outputPath  = positional[2];
+        return true;
+    }
+
+    inline void waitForFrame()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    /**
+     * Encodes the rendered frames on its own thread, so encoding overlaps the detection of the next frames.
+     * Frames come from a fixed pool and are reused: the caller acquires a free frame, fills it and submits it,
+     * the encoder returns it to the pool when it's written. Frames are written in the order of submission.
+     * Each queue has a single producer: only the caller pushes to m_submitted and only the encoder pushes to m_free.
+     */
+    class VideoEncoder
+    {
+    public:
+        VideoEncoder(cv::VideoWriter& writer, size_t framesCount)
+            : m_writer(writer)
+            , m_frames(framesCount)
+            , m_free(framesCount)
+            , m_submitted(framesCount)
+            , m_finished(false)
+        {
+            for (size_t i = 0; i < m_frames.size(); i++)
+                m_free.tryPush(&m_frames[i]);
+
+            m_thread = std::thread(&VideoEncoder::encodeLoop, this);
+        }
+
+        ~VideoEncoder()
+        {
+            finish();
+        }
+
+        /**
+        * Free frame of the pool, waits while all frames are being encoded.
+        */
+        cv::Mat* acquire()
+        {
+            cv::Mat* frame = 0;
+            while (!m_free.tryPop(frame))
+                waitForFrame();
+
+            return frame;
+        }
+
+        void submit(cv::Mat* frame)
+        {
+            m_submitted.tryPush(frame);
+        }
+
+        /**
+        * Give the frame back to the pool without encoding it. The frame goes through the encoder as an empty one,
+        * so the encoder stays the only thread returning frames to the pool.
+        */
+        void release(cv::Mat* frame)
+        {
+            frame->release();
+            m_submitted.tryPush(frame);
+        }
+
+        /**
+        * Write the submitted frames and stop the encoder thread.
+        */
+        void finish()
+        {
+            m_finished = true;
+
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+    private:
+        void encodeLoop()
+        {
+            for (;;)
+            {
+                cv::Mat* frame = 0;
+                if (m_submitted.tryPop(frame))
+                {
+                    // Empty frames were released without encoding
+                    if (!frame->empty())
+                        m_writer.write(*frame);
+
+                    m_free.tryPush(frame);
+                }
+                else if (m_finished)
+                {
+                    // Frames submitted before finish() are visible once the flag is
+                    if (m_submitted.empty())
+                        break;
+                }
+                else
+                {
+                    waitForFrame();
+                }
+            }
+        }
+
+        cv::VideoWriter&     m_writer;
+        std::vector<cv::Mat> m_frames;
+        SpscQueue<cv::Mat*>  m_free;        // Encoder -> caller
+        SpscQueue<cv::Mat*>  m_submitted;   // Caller -> encoder
+        std::atomic<bool>    m_finished;
+        std::thread          m_thread;
+    };
+}
+
+/**
+ * Composites the augmented scene onto the frames of a recorded video and writes the annotated video.
+ * Rendering is done on the CPU (see OffscreenRenderer), so no window, OpenGL or GPU is needed, and frames are
+ * processed as fast as the CPU allows instead of at the display rate. Detection runs in the synchronous mode,
+ * so the result doesn't depend on the processing speed; encoding runs on its own thread.
+ */
+int main(int argc, const char * argv[])
+{
+    CameraCalibration calibration = CameraCalibration::getDefault();
+
+    RenderOptions options;
+    if (!parseArguments(argc, argv, options))
+    {
+        std::cout << "Usage: markerless_ar_render <pattern image or pattern file> <input video> <output video>" << std::endl;
+        std::cout << "       [--fourcc MJPG] [--fps N] [--frames N] [--no-overlay]" << std::endl;
+        return 1;
+    }
+
+    Pattern pattern;
+    if (!PatternFile::loadOrBuild(options.patternPath, pattern))
+    {
+        std::cerr << "Input image cannot be read" << std::endl;
+        return 2;
+    }
+
+    cv::VideoCapture capture;
+    if (!capture.open(options.inputPath))
+    {
+        std::cerr << "Input video cannot be read" << std::endl;
+        return 2;
+    }
+
+    const cv::Size frameSize(static_cast<int>(capture.get(CV_CAP_PROP_FRAME_WIDTH)), static_cast<int>(capture.get(CV_CAP_PROP_FRAME_HEIGHT)));
+
+    // Output keeps the frame rate of the input, which also gives the frame timestamps for the pose filter
+    double fps = options.fps > 0 ? options.fps : capture.get(CV_CAP_PROP_FPS);
+    if (!(fps > 0))
+        fps = 30;
+
+    const std::string& c = options.fourcc;
+    cv::VideoWriter writer(options.outputPath, CV_FOURCC(c[0], c[1], c[2], c[3]), fps, frameSize, true);
+    if (!writer.isOpened())
+    {
+        std::cerr << "Output video cannot be written" << std::endl;
+        return 3;
+    }
+
+    ARPipeline        pipeline(pattern, calibration);
+    OffscreenRenderer renderer(calibration);
+    VideoEncoder      encoder(writer, 4);
+
+    std::vector<std::string> overlayText;
+    size_t framesCount = 0;
+    size_t foundCount  = 0;
+
+    const int64 start = cv::getTickCount();
+
+    while (options.maxFrames <= 0 || framesCount < static_cast<size_t>(options.maxFrames))
+    {
+        cv::Mat* frame = encoder.acquire();
+        if (!capture.read(*frame) || frame->empty() || frame->size() != frameSize)
+        {
+            encoder.release(frame);
+            break;
+        }
+
+        const double timestamp = framesCount / fps;
+        const bool   found     = pipeline.processFrame(*frame, timestamp);
+
+        if (options.drawOverlay)
+        {
+            overlayText.resize(2);
+            overlayText[0] = "Frame: " + ToString(framesCount);
+            overlayText[1] = found ? "Pattern: found" : "Pattern: not found";
+            renderer.setOverlayText(overlayText);
+        }
+
+        renderer.render(*frame, found, pipeline.getPatternLocation());
+        encoder.submit(frame);
+
+        framesCount++;
+        foundCount += found;
+    }
+
+    encoder.finish();
+
+    const double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    const double renderFps = seconds > 0 ? framesCount / seconds : 0;
+
+    std::cout << "Frames: " << framesCount << ", found: " << foundCount << std::endl;
+    std::cout << "Time: " << seconds << " s, " << renderFps << " fps (" << renderFps / fps << "x real time)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////
+// File includes:
+#include "MultiStreamProcessor.hpp"
+#include "PatternFile.hpp"
+
+////////////////////////////////////////////////////////////////////
+// Standard includes:
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+namespace
+{
+    struct ResultWriter
+    {
+        std::mutex    mutex;
+        std::ostream* out;
+    };
+
+    /**
+     * Writes one CSV line per processed frame (called concurrently from the workers).
+     */
+    void writeResult(const StreamResult& result, void* userData)
+    {
+        ResultWriter& writer = *static_cast<ResultWriter*>(userData);
+        const Vector3& t = result.pose.t();
+
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        *writer.out << result.streamIndex << "," << result.frameIndex << "," << result.latency * 1000 << ","
+                    << result.patternFound << "," << t.data[0] << "," << t.data[1] << "," << t.data[2] << std::endl;
+    }
+
+    /**
+     * A number is the index of a camera, anything else is a file or an URL.
+     */
+    cv::Ptr<cv::VideoCapture> openSource(const std::string& source)
+    {
+        cv::Ptr<cv::VideoCapture> capture = new cv::VideoCapture();
+
+        char* end = 0;
+        const long cameraIndex = std::strtol(source.c_str(), &end, 10);
+
+        if (!source.empty() && *end == 0)
+            capture->open(static_cast<int>(cameraIndex));
+        else
+            capture->open(source);
+
+        return capture;
+    }
+}
+
+/**
+ * Processes many camera streams in one process (see MultiStreamProcessor): the pattern is loaded once and the
+ * detection of all streams shares one pool of worker threads. Prints the latency statistics of each stream as JSON
+ * when all streams end, the per-frame results are optionally written as CSV.
+ */
+int main(int argc, const char * argv[])
+{
+    CameraCalibration calibration = CameraCalibration::getDefault();
+
+    std::string patternPath;
+    std::vector<std::string> sources;
+    std::string resultsPath;
+    size_t threadsCount = 0;
+    double maxLatencyMs = 200;
+    bool   lossless     = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--threads" && hasValue)
+            threadsCount = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--max-latency" && hasValue)
+            maxLatencyMs = std::atof(argv[++i]);
+        else if (arg == "--lossless")
+            lossless = true;
+        else if (arg == "--results" && hasValue)
+            resultsPath = argv[++i];
+        else if (patternPath.empty())
+            patternPath = arg;
+        else
+            sources.push_back(arg);
+    }
+
+    if (patternPath.empty() || sources.empty())
+    {
+        std::cout << "Usage: markerless_ar_server <pattern image or pattern file> <camera index or video> [...]" << std::endl;
+        std::cout << "       [--threads N] [--max-latency ms] [--lossless] [--results file]" << std::endl;
+        return 1;
+    }
+
+    Pattern pattern;
+    if (!PatternFile::loadOrBuild(patternPath, pattern))
+    {
+        std::cerr << "Input image cannot be read" << std::endl;
+        return 2;
+    }
+
+    // Streams are processed in parallel by the pool, nested parallel loops of OpenCV would only oversubscribe the cores
+    cv::setNumThreads(1);
+
+    MultiStreamProcessor processor(pattern, calibration, threadsCount);
+    processor.maxLatency = maxLatencyMs / 1000;
+    processor.lossless   = lossless;
+
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        cv::Ptr<cv::VideoCapture> capture = openSource(sources[i]);
+        if (!capture->isOpened())
+        {
+            std::cerr << "Cannot open " << sources[i] << std::endl;
+            return 2;
+        }
+
+        processor.addStream(capture);
+    }
+
+    std::ofstream resultsFile;
+    ResultWriter writer;
+    if (!resultsPath.empty())
+    {
+        resultsFile.open(resultsPath.c_str());
+        if (!resultsFile)
+        {
+            std::cerr << "Results file cannot be written" << std::endl;
+            return 3;
+        }
+
+        resultsFile << "stream,frame,latency_ms,found,tx,ty,tz" << std::endl;
+        writer.out = &resultsFile;
+        processor.setResultCallback(writeResult, &writer);
+    }
+
+    processor.run();
+
+    std::cout << "{" << std::endl;
+    std::cout << "  \"threads\": " << processor.getThreadsCount() << "," << std::endl;
+    std::cout << "  \"streams\": [" << std::endl;
+
+    for (size_t i = 0; i < processor.getStreamsCount(); i++)
+    {
+        const StreamStats stats = processor.getStreamStats(i);
+
+        std::cout << "    { \"source\": \"" << sources[i] << "\", \"captured\": " << stats.capturedCount
+                  << ", \"processed\": " << stats.processedCount << ", \"found\": " << stats.foundCount
+                  << ", \"dropped\": " << stats.droppedCount << ", \"late\": " << stats.lateCount
+                  << ", \"mean_ms\": " << stats.latency.mean * 1000 << ", \"p50_ms\": " << stats.latency.p50 * 1000
+                  << ", \"p95_ms\": " << stats.latency.p95 * 1000 << ", \"p99_ms\": " << stats.latency.p99 * 1000 << " }"
+                  << (i + 1 < processor.getStreamsCount() ? "," : "") << std::endl;
+    }
+
+    std::cout << "  ]" << std::endl;
+    std::cout << "}" << std::endl;
+    return 0;
+}